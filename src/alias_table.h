@@ -0,0 +1,97 @@
+// alias_table.h
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+namespace util {
+
+/*
+ *  Таблица псевдонимов (метод Уолкера - Воуза) для выбора номера
+ *  с вероятностью, пропорциональной его весу. Таблица строится за O(n),
+ *  выбор номера стоит O(1): случайный столбец и одно сравнение
+ */
+class AliasTable {
+public:
+    AliasTable() = default;
+
+    explicit AliasTable(std::span<const double> weights) {
+        double total = 0;
+        for (double weight : weights) {
+            if (weight < 0) {
+                throw std::invalid_argument("Negative alias table weight");
+            }
+            total += weight;
+        }
+        if (weights.empty() || total <= 0) {
+            return;
+        }
+
+        const size_t count = weights.size();
+        probability_.resize(count);
+        alias_.resize(count);
+
+        // Веса масштабируются так, чтобы средний столбец был равен 1.
+        // Неполные столбцы дополняются долей переполненных
+        std::vector<double> scaled(count);
+        std::vector<std::uint32_t> small;
+        std::vector<std::uint32_t> large;
+        for (size_t i = 0; i < count; ++i) {
+            scaled[i] = weights[i] * count / total;
+            (scaled[i] < 1.0 ? small : large).push_back(
+                static_cast<std::uint32_t>(i));
+        }
+
+        while (!small.empty() && !large.empty()) {
+            const std::uint32_t less = small.back();
+            small.pop_back();
+            const std::uint32_t more = large.back();
+
+            probability_[less] = scaled[less];
+            alias_[less] = more;
+
+            scaled[more] -= 1.0 - scaled[less];
+            if (scaled[more] < 1.0) {
+                large.pop_back();
+                small.push_back(more);
+            }
+        }
+
+        // Остатки отличаются от 1 только погрешностью округления
+        for (std::uint32_t i : large) {
+            probability_[i] = 1.0;
+            alias_[i] = i;
+        }
+        for (std::uint32_t i : small) {
+            probability_[i] = 1.0;
+            alias_[i] = i;
+        }
+    }
+
+    // Таблица пуста, если нет ни одного положительного веса
+    bool Empty() const noexcept {
+        return probability_.empty();
+    }
+
+    size_t Size() const noexcept {
+        return probability_.size();
+    }
+
+    template <typename Generator>
+    size_t Sample(Generator& generator) const {
+        std::uniform_int_distribution<size_t> column(0, Size() - 1);
+        std::uniform_real_distribution<double> coin(0.0, 1.0);
+        const size_t i = column(generator);
+        return coin(generator) < probability_[i] ? i : alias_[i];
+    }
+
+private:
+    std::vector<double> probability_;
+    std::vector<std::uint32_t> alias_;
+};
+
+}  // namespace util
@@ -1,6 +1,8 @@
 // api_handler.cpp
 #include "api_handler.h"
 
+#include "binary_format.h"
+
 #include <boost/algorithm/string.hpp>
 
 #include <algorithm>
@@ -21,6 +23,132 @@ constexpr char KEY_lootTypes[] = "lootTypes";
 constexpr char KEY_offices[] = "offices";
 constexpr char KEY_offset_X[] = "offsetX";
 constexpr char KEY_offset_Y[] = "offsetY";
+constexpr char KEY_full[] = "full";
+constexpr char KEY_removedLostObjects[] = "removedLostObjects";
+constexpr char KEY_removedPlayers[] = "removedPlayers";
+constexpr char KEY_tick[] = "tick";
+
+namespace {
+
+object DogStateToJson(const model::SessionSnapshot::DogState& dog) {
+    object player_stats;
+
+    player_stats[KEY_pos] = {dog.position.x, dog.position.y};
+    player_stats[KEY_speed] = {dog.speed.x, dog.speed.y};
+
+    switch (dog.direction) {
+        case model::DIRECTION::NORTH:
+            player_stats[KEY_dir] = KEY_U;
+            break;
+        case model::DIRECTION::SOUTH:
+            player_stats[KEY_dir] = KEY_D;
+            break;
+        case model::DIRECTION::WEST:
+            player_stats[KEY_dir] = KEY_L;
+            break;
+        case model::DIRECTION::EAST:
+            player_stats[KEY_dir] = KEY_R;
+            break;
+        case model::DIRECTION::NONE:
+            player_stats[KEY_dir] = "";
+            break;
+    }
+
+    array bag_array;
+    for (const auto& loot_item : dog.bag) {
+        object loot_stats;
+        loot_stats[KEY_id] = loot_item.id;
+        loot_stats[KEY_type] = loot_item.type;
+        bag_array.push_back(loot_stats);
+    }
+    player_stats[KEY_bag] = bag_array;
+    player_stats[KEY_score] = dog.score;
+
+    return player_stats;
+}
+
+object LootStateToJson(const model::SessionSnapshot::LootState& loot_item) {
+    object loot_stats;
+    loot_stats[KEY_type] = loot_item.type;
+    loot_stats[KEY_pos] = {loot_item.position.x, loot_item.position.y};
+    return loot_stats;
+}
+
+// Без since в ответ попадают все объекты снимка, иначе только
+// изменившиеся после тика since
+object DogsToJson(
+    const model::SessionSnapshot& snapshot,
+    std::optional<std::uint64_t> since)
+{
+    object players_obj_body;
+
+    for (const auto& dog : snapshot.dogs) {
+        if (since && dog.changed_tick <= *since) {
+            continue;
+        }
+        players_obj_body[std::to_string(dog.player_id)] = DogStateToJson(dog);
+    }
+    return players_obj_body;
+}
+
+object LootToJson(
+    const model::SessionSnapshot& snapshot,
+    std::optional<std::uint64_t> since)
+{
+    object loot_obj_body;
+
+    for (const auto& loot_item : snapshot.loot) {
+        if (since && loot_item.changed_tick <= *since) {
+            continue;
+        }
+        loot_obj_body[std::to_string(loot_item.id)] =
+            LootStateToJson(loot_item);
+    }
+    return loot_obj_body;
+}
+
+array RemovalsToJson(
+    const std::shared_ptr<const model::SessionSnapshot::Removals>& removals,
+    std::uint64_t since)
+{
+    array ids;
+    if (removals) {
+        for (const auto& removal : *removals) {
+            if (removal.tick > since) {
+                ids.push_back(removal.id);
+            }
+        }
+    }
+    return ids;
+}
+
+// Полное состояние в формате разностного ответа
+std::string FullSinceToJson(const model::SessionSnapshot& snapshot) {
+    object result;
+    result[KEY_tick] = snapshot.tick;
+    result[KEY_full] = true;
+    result[KEY_players] = DogsToJson(snapshot, std::nullopt);
+    result[KEY_lostObjects] = LootToJson(snapshot, std::nullopt);
+    return serialize(result);
+}
+
+std::string DeltaToJson(
+    const model::SessionSnapshot& snapshot,
+    std::uint64_t since)
+{
+    object result;
+    result[KEY_tick] = snapshot.tick;
+    result[KEY_full] = false;
+    result[KEY_players] = DogsToJson(snapshot, since);
+    result[KEY_lostObjects] = LootToJson(snapshot, since);
+    result[KEY_removedPlayers] =
+        RemovalsToJson(snapshot.removed_players, since);
+    result[KEY_removedLostObjects] =
+        RemovalsToJson(snapshot.removed_loot, since);
+    return serialize(result);
+}
+
+}  // namespace
 
 array RoadsToJson(const model::Map& map) {
     array roads_array;
@@ -82,6 +210,21 @@ array OfficesToJson(const model::Map& map) {
 
 ApiRequestHandler::ApiRequestHandler(model::Game& game)
     : game_(game) {
+    // Карты не меняются после загрузки, поэтому кодируются один раз
+    for (const auto& map : game_.GetMaps()) {
+        binary_maps_.emplace(*map.GetId(),
+            std::make_shared<const std::string>(binary_format::EncodeMap(
+                map,
+                serialize(game_.GetLootTypesStorage().GetLootTypes(
+                    *map.GetId())))));
+    }
+}
+
+std::shared_ptr<const std::string> ApiRequestHandler::BinaryMapBody(
+    const model::Map::Id& map_id) const
+{
+    auto it = binary_maps_.find(*map_id);
+    return it != binary_maps_.end() ? it->second : nullptr;
 }
 
 std::string ApiRequestHandler::MapInfoToJson(const model::Map& map) {
@@ -120,6 +263,173 @@ std::string ApiRequestHandler::MapsListToJson() {
     return serialize(maps_array);
 }
 
+bool ApiRequestHandler::RequiresStrand(std::string_view target) {
+    std::string_view path = target.substr(0, target.find('?'));
+
+    // Карты неизменны после загрузки, состояние сессий читается из
+    // снимков, а действия игроков попадают в очередь сессии
+    return path != API_GAME_ACTION_PATH &&
+           path != API_GAME_STATE_PATH &&
+           path != API_GAME_PLAYERS_PATH &&
+           !path.starts_with(API_MAPS_PATH);
+}
+
+std::shared_ptr<const model::SessionSnapshot> ApiRequestHandler::FindSnapshot(
+    const app::Token& token) const
+{
+    static const auto empty_snapshot =
+        std::make_shared<const model::SessionSnapshot>();
+
+    auto player = game_.GetPlayers().FindPlayerByToken(token);
+    if (!player) {
+        return empty_snapshot;
+    }
+
+    auto snapshot = player.value()->GetSession()->GetSnapshot();
+    return snapshot ? snapshot : empty_snapshot;
+}
+
+std::shared_ptr<const std::string> ApiRequestHandler::StateBody(
+    const model::SessionSnapshot& snapshot)
+{
+    return snapshot.state_body.Get([&snapshot] {
+        object result;
+        result[KEY_players] = DogsToJson(snapshot, std::nullopt);
+        result[KEY_lostObjects] = LootToJson(snapshot, std::nullopt);
+
+        return std::make_shared<const std::string>(serialize(result));
+    });
+}
+
+std::shared_ptr<const std::string> ApiRequestHandler::BinaryStateBody(
+    const model::SessionSnapshot& snapshot)
+{
+    return snapshot.binary_state_body.Get([&snapshot] {
+        return std::make_shared<const std::string>(
+            binary_format::EncodeState(snapshot));
+    });
+}
+
+std::shared_ptr<const std::string> ApiRequestHandler::BinaryVisibleStateBody(
+    const model::SessionSnapshot& snapshot,
+    std::uint32_t player_id)
+{
+    auto visible = snapshot.FindVisible(player_id);
+    if (!visible) {
+        return BinaryStateBody(snapshot);
+    }
+    return std::make_shared<const std::string>(
+        binary_format::EncodeState(snapshot, &*visible));
+}
+
+std::shared_ptr<const std::string> ApiRequestHandler::VisibleStateBody(
+    const model::SessionSnapshot& snapshot,
+    std::uint32_t player_id)
+{
+    auto visible = snapshot.FindVisible(player_id);
+    if (!visible) {
+        return StateBody(snapshot);
+    }
+
+    object players_obj_body;
+    for (size_t index : visible->dogs) {
+        const auto& dog = snapshot.dogs[index];
+        players_obj_body[std::to_string(dog.player_id)] = DogStateToJson(dog);
+    }
+
+    object loot_obj_body;
+    for (size_t index : visible->loot) {
+        const auto& loot_item = snapshot.loot[index];
+        loot_obj_body[std::to_string(loot_item.id)] =
+            LootStateToJson(loot_item);
+    }
+
+    object result;
+    result[KEY_players] = players_obj_body;
+    result[KEY_lostObjects] = loot_obj_body;
+
+    return std::make_shared<const std::string>(serialize(result));
+}
+
+std::shared_ptr<const std::string> ApiRequestHandler::StateSinceBody(
+    const model::SessionSnapshot& snapshot,
+    std::uint64_t since)
+{
+    // Изменения за слишком старый или ещё не наступивший тик
+    // восстановить нельзя, поэтому клиент получает всё состояние
+    if (!snapshot.HasHistorySince(since)) {
+        return FullStateSinceBody(snapshot);
+    }
+
+    // Клиенты, опрашивающие сервер каждый тик, получают общий буфер
+    if (since + 1 == snapshot.tick) {
+        return snapshot.previous_tick_delta_body.Get([&snapshot, since] {
+            return std::make_shared<const std::string>(
+                DeltaToJson(snapshot, since));
+        });
+    }
+
+    return std::make_shared<const std::string>(DeltaToJson(snapshot, since));
+}
+
+std::shared_ptr<const std::string> ApiRequestHandler::FullStateSinceBody(
+    const model::SessionSnapshot& snapshot)
+{
+    return snapshot.full_since_body.Get([&snapshot] {
+        return std::make_shared<const std::string>(FullSinceToJson(snapshot));
+    });
+}
+
+std::optional<std::string> ApiRequestHandler::FindQueryParam(
+    std::string_view target,
+    std::string_view key)
+{
+    size_t query_start = target.find('?');
+    if (query_start == std::string_view::npos) {
+        return std::nullopt;
+    }
+
+    std::string_view query = target.substr(query_start + 1);
+    while (!query.empty()) {
+        size_t param_end = query.find('&');
+        std::string_view param = query.substr(0, param_end);
+
+        size_t eq_pos = param.find('=');
+        if (param.substr(0, eq_pos) == key) {
+            return eq_pos == std::string_view::npos
+                ? std::string{}
+                : std::string(param.substr(eq_pos + 1));
+        }
+
+        if (param_end == std::string_view::npos) {
+            break;
+        }
+        query.remove_prefix(param_end + 1);
+    }
+    return std::nullopt;
+}
+
+std::shared_ptr<const std::string> ApiRequestHandler::PlayersBody(
+    const model::SessionSnapshot& snapshot)
+{
+    auto encode = [&snapshot] {
+        object body;
+
+        for (const auto& dog : snapshot.dogs) {
+            value name{{KEY_name, dog.name}};
+            body.emplace(std::to_string(dog.player_id), name);
+        }
+
+        return std::make_shared<const std::string>(serialize(body));
+    };
+
+    // У пустого снимка нет общего тела состава игроков
+    if (!snapshot.roster_body) {
+        return encode();
+    }
+    return snapshot.roster_body->Get(encode);
+}
+
 bool ApiRequestHandler::IsValidHexToken(const std::string token) {
     if (token.size() != 32) {
         return false;
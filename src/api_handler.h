@@ -5,15 +5,19 @@
 #include "database.h"
 #include "handlers_utils.h"
 #include "model.h"
+#include "my_logger.h"
 
 #include <boost/beast.hpp>
 #include <boost/json.hpp>
+#include <boost/log/utility/manipulators/add_value.hpp>
 
+#include <charconv>
 #include <cmath>
 #include <optional>
 #include <sstream>
 #include <string>
 #include <string_view>
+#include <unordered_map>
 
 namespace http_handler {
 
@@ -43,6 +47,7 @@ constexpr char KEY_playerId[] = "playerId";
 constexpr char KEY_players[] = "players";
 constexpr char KEY_pos[] = "pos";
 constexpr char KEY_score[] = "score";
+constexpr char KEY_since[] = "since";
 constexpr char KEY_speed[] = "speed";
 constexpr char KEY_start[] = "start";
 constexpr char KEY_timeDelta[] = "timeDelta";
@@ -59,21 +64,67 @@ using namespace std::literals;
 
 namespace beast = boost::beast;
 namespace http = beast::http;
+namespace logging = boost::log;
 
 class ApiRequestHandler {
 public:
     explicit ApiRequestHandler(model::Game& game);
 
+    // Запросы, которые не обращаются к изменяемому состоянию игры напрямую,
+    // обрабатываются в потоке ввода-вывода без захвата api_strand
+    static bool RequiresStrand(std::string_view target);
+
     template <typename Body, typename Allocator>
     ServerResponse Handle(
         http::request<Body, http::basic_fields<Allocator>>&& req);
 
+    // Тела кодируются один раз на снимок и разделяются всеми запросами
+    static std::shared_ptr<const std::string> StateBody(
+        const model::SessionSnapshot& snapshot);
+    static std::shared_ptr<const std::string> PlayersBody(
+        const model::SessionSnapshot& snapshot);
+
+    // Состояние в радиусе обзора собаки игрока; кодируется на каждый
+    // запрос, так как у каждого игрока своя область видимости
+    static std::shared_ptr<const std::string> VisibleStateBody(
+        const model::SessionSnapshot& snapshot,
+        std::uint32_t player_id);
+
+    // Разностный ответ: изменения после тика since или, если их нельзя
+    // восстановить, полное состояние с признаком full
+    static std::shared_ptr<const std::string> StateSinceBody(
+        const model::SessionSnapshot& snapshot,
+        std::uint64_t since);
+    static std::shared_ptr<const std::string> FullStateSinceBody(
+        const model::SessionSnapshot& snapshot);
+
+    // Двоичное представление (binary_format), выбираемое заголовком Accept
+    static std::shared_ptr<const std::string> BinaryStateBody(
+        const model::SessionSnapshot& snapshot);
+    static std::shared_ptr<const std::string> BinaryVisibleStateBody(
+        const model::SessionSnapshot& snapshot,
+        std::uint32_t player_id);
+
+    static bool IsValidHexToken(const std::string token);
+    static bool IsValidAction(const std::string action);
+
 private:
     std::string MapInfoToJson(const model::Map& map);
+    std::shared_ptr<const std::string> BinaryMapBody(
+        const model::Map::Id& map_id) const;
+
+    template <typename Body, typename Allocator>
+    static bool AcceptsBinary(
+        const http::request<Body, http::basic_fields<Allocator>>& req);
     std::string MapsListToJson();
 
-    bool IsValidHexToken(const std::string token);
-    bool IsValidAction(const std::string action);
+    // Последний опубликованный снимок сессии игрока с данным токеном
+    std::shared_ptr<const model::SessionSnapshot> FindSnapshot(
+        const app::Token& token) const;
+
+    static std::optional<std::string> FindQueryParam(
+        std::string_view target,
+        std::string_view key);
 
     template <typename Body, typename Allocator, typename Fn>
     ServerResponse ExecuteAuthorized(
@@ -149,6 +200,8 @@ private:
         http::request<Body, http::basic_fields<Allocator>>&& req);
 
     model::Game& game_;
+    std::unordered_map<std::string, std::shared_ptr<const std::string>>
+        binary_maps_;
 };
 
 template <typename Body, typename Allocator>
@@ -256,6 +309,15 @@ ServerResponse ApiRequestHandler::Handle(
     return resp;
 }
 
+template <typename Body, typename Allocator>
+bool ApiRequestHandler::AcceptsBinary(
+    const http::request<Body, http::basic_fields<Allocator>>& req)
+{
+    auto it = req.find(http::field::accept);
+    return it != req.end() &&
+        it->value().find(ContentType::APP_GAME_BINARY) != std::string_view::npos;
+}
+
 template <typename Body, typename Allocator, typename Fn>
 ServerResponse ApiRequestHandler::ExecuteAuthorized(
     http::request<Body, http::basic_fields<Allocator>>&& req, Fn&& action)
@@ -265,7 +327,7 @@ ServerResponse ApiRequestHandler::ExecuteAuthorized(
     if (!token) {
         return std::move(InvalidTokenResponse(std::forward<decltype(req)>(req)));
     }
-    if (!app::Players::FindPlayerByToken(*token)) {
+    if (!game_.GetPlayers().FindPlayerByToken(*token)) {
         return std::move(UnknownTokenResponse(std::forward<decltype(req)>(req)));
     }
     return action(*token);
@@ -322,19 +384,13 @@ ServerResponse ApiRequestHandler::GetPlayersResponse(
     http::request<Body, http::basic_fields<Allocator>>&& req)
 {
     return ExecuteAuthorized(std::forward<decltype(req)>(req),
-        [&req] (const app::Token& token)
+        [this, &req] (const app::Token& token)
     {
-        const auto& players = app::Players::FindPlayersInSession(token);
-        object body;
-
-        for (auto& player : players) {
-            value name{{KEY_name, player->GetName()}};
-            body.emplace(std::to_string(player->GetId()), name);
-        }
+        auto snapshot = FindSnapshot(token);
 
-        return std::move(MakeStringResponse(
+        return std::move(MakeSharedStringResponse(
             http::status::ok,
-            serialize(body),
+            PlayersBody(*snapshot),
             req.version(),
             req.keep_alive(),
             ContentType::APP_JSON,
@@ -361,16 +417,16 @@ ServerResponse ApiRequestHandler::GetRecordsResponse(
             size_t eq_pos = param.find('=');
             if (eq_pos != std::string::npos) {
                 std::string key = param.substr(0, eq_pos);
-                std::string value = param.substr(eq_pos + 1);
+                std::string param_value = param.substr(eq_pos + 1);
                 
                 if (key == "start") {
                     try {
-                        start = std::stoi(value);
+                        start = std::stoi(param_value);
                         if (start < 0) start = 0;
                     } catch (...) {
                         value custom_data{
                             {"parameter"s, key},
-                            {"value", value}, {"target",
+                            {"value", param_value}, {"target",
                             target}};
                         BOOST_LOG_TRIVIAL(warning)
                             << logging::add_value(
@@ -380,7 +436,7 @@ ServerResponse ApiRequestHandler::GetRecordsResponse(
                     }
                 } else if (key == "maxItems") {
                     try {
-                        max_items = std::stoi(value);
+                        max_items = std::stoi(param_value);
                         if (max_items < 0) max_items = 0;
                         if (max_items > MAX_ROWS_NUMBER_IN_RESULT) {
                             return std::move(MakeStringResponse(
@@ -394,7 +450,7 @@ ServerResponse ApiRequestHandler::GetRecordsResponse(
                     } catch (...) {
                         value custom_data{
                             {"parameter"s, key},
-                            {"value", value},
+                            {"value", param_value},
                             {"target", target}};
                         BOOST_LOG_TRIVIAL(warning)
                             << logging::add_value(
@@ -445,79 +501,59 @@ template <typename Body, typename Allocator>
 ServerResponse ApiRequestHandler::GetStateResponse(
     http::request<Body, http::basic_fields<Allocator>>&& req)
 {
+    std::optional<std::uint64_t> since;
+    std::string target = UrlDecode(std::string(req.target()));
+
+    if (auto param = FindQueryParam(target, KEY_since)) {
+        std::uint64_t tick = 0;
+        auto [end, ec] = std::from_chars(
+            param->data(), param->data() + param->size(), tick);
+        if (ec != std::errc{} || end != param->data() + param->size()) {
+            return std::move(MakeStringResponse(
+                http::status::bad_request,
+                R"({"code": "invalidArgument","message": "Invalid since parameter"})",
+                req.version(),
+                req.keep_alive(),
+                ContentType::APP_JSON,
+                {{http::field::cache_control, "no-cache"}}));
+        }
+        since = tick;
+    }
+
     return ExecuteAuthorized(std::forward<decltype(req)>(req),
-        [&req] (const app::Token& token)
+        [this, &req, since] (const app::Token& token)
     {
-        const auto& players = app::Players::FindPlayersInSession(token);
-        object players_obj_body;
-
-        for (auto& player : players) {
-            std::shared_ptr<model::Dog> dog_ptr = player->GetDog();
-            geom::Point2D position = dog_ptr->GetPosition();
-            geom::Vec2D speed = dog_ptr->GetSpeed();
-
-            object player_stats;
-
-            player_stats[KEY_pos] = {position.x, position.y};
-            player_stats[KEY_speed] = {speed.x, speed.y};
-
-            switch (dog_ptr->GetDirection()) {
-                case model::DIRECTION::NORTH:
-                    player_stats[KEY_dir] = KEY_U;
-                    break;
-                case model::DIRECTION::SOUTH:
-                    player_stats[KEY_dir] = KEY_D;
-                    break;
-                case model::DIRECTION::WEST:
-                    player_stats[KEY_dir] = KEY_L;
-                    break;
-                case model::DIRECTION::EAST:
-                    player_stats[KEY_dir] = KEY_R;
-                    break;
-                case model::DIRECTION::NONE:
-                    player_stats[KEY_dir] = "";
-                    break;
-            }
-
-            auto loot = dog_ptr->GetLoot();
-            array bag_array;
-            for (auto& loot_item : loot) {
-                object loot_stats;
-                loot_stats[KEY_id] = loot_item->GetId();
-                loot_stats[KEY_type] = loot_item->GetType();
-                bag_array.push_back(loot_stats);
+        auto snapshot = FindSnapshot(token);
+        // Разностные ответы передаются только в JSON
+        const bool binary = !since && AcceptsBinary(req);
+        std::shared_ptr<const std::string> body;
+
+        if (since) {
+            body = StateSinceBody(*snapshot, *since);
+        } else if (snapshot->view_radius > 0) {
+            auto player = game_.GetPlayers().FindPlayerByToken(token);
+            if (!player) {
+                body = binary ? BinaryStateBody(*snapshot)
+                              : StateBody(*snapshot);
+            } else if (binary) {
+                body = BinaryVisibleStateBody(*snapshot, (*player)->GetId());
+            } else {
+                body = VisibleStateBody(*snapshot, (*player)->GetId());
             }
-            player_stats[KEY_bag] = bag_array;
-            player_stats[KEY_score] = dog_ptr->GetScore();
-
-            players_obj_body[std::to_string(player->GetId())] = player_stats;
-        }
-
-        const auto& loot = app::Players::FindLootInSession(token);
-        object loot_obj_body;
-
-        for (auto& loot_item : loot) {
-            std::uint32_t loot_type = loot_item->GetType();
-            geom::Point2D position = loot_item->GetPosition();
-
-            object loot_stats;
-            loot_stats[KEY_type] = loot_type;
-            loot_stats[KEY_pos] = {position.x, position.y};
-
-            loot_obj_body[std::to_string(loot_item->GetId())] = loot_stats;
+        } else {
+            body = binary ? BinaryStateBody(*snapshot) : StateBody(*snapshot);
         }
 
-        object result;
-        result[KEY_players] = players_obj_body;
-        result[KEY_lostObjects] = loot_obj_body;
-
-        return std::move(MakeStringResponse(
+        return std::move(MakeSharedStringResponse(
             http::status::ok,
-            serialize(result),
+            std::move(body),
             req.version(),
             req.keep_alive(),
-            ContentType::APP_JSON,
-            {{http::field::cache_control, "no-cache"}}));
+            binary ? ContentType::APP_GAME_BINARY : ContentType::APP_JSON,
+            // Тело зависит от заголовка Accept, поэтому кеши не должны
+            // отдавать двоичный ответ клиенту, ждущему JSON
+            {{http::field::cache_control, "no-cache"},
+             {http::field::vary, "Accept"}}));
     });
 }
 
@@ -611,13 +647,24 @@ ServerResponse ApiRequestHandler::MapInfoResponse(
     if (game_.FindMap(map_id) == nullptr) {
         return std::move(MapNotFoundResponse(std::forward<decltype(req)>(req)));
     }
+    if (AcceptsBinary(req)) {
+        return std::move(MakeSharedStringResponse(
+            http::status::ok,
+            BinaryMapBody(map_id),
+            req.version(),
+            req.keep_alive(),
+            ContentType::APP_GAME_BINARY,
+            {{http::field::cache_control, "no-cache"},
+             {http::field::vary, "Accept"}}));
+    }
     return std::move(MakeStringResponse(
         http::status::ok,
         MapInfoToJson(*game_.FindMap(map_id)),
         req.version(),
         req.keep_alive(),
         ContentType::APP_JSON,
-        {{http::field::cache_control, "no-cache"}}));
+        {{http::field::cache_control, "no-cache"},
+         {http::field::vary, "Accept"}}));
 }
 
 template <typename Body, typename Allocator>
@@ -662,7 +709,7 @@ ServerResponse ApiRequestHandler::PlayerActionResponse(
         value action = parse(req.body(), ec);
 
         if (ec || !action.as_object().contains(KEY_move) ||
-            !this->IsValidAction(std::move(
+            !IsValidAction(std::move(
                 action.at(KEY_move).as_string().c_str())))
         {
             return std::move(MakeStringResponse(
@@ -675,7 +722,7 @@ ServerResponse ApiRequestHandler::PlayerActionResponse(
         }
 
         std::shared_ptr<app::Player> player_ptr =
-            app::Players::FindPlayerByToken(token).value();
+            game_.GetPlayers().FindPlayerByToken(token).value();
 
         player_ptr->MakeAction(action.at(KEY_move).as_string().c_str());
 
@@ -721,7 +768,7 @@ ServerResponse ApiRequestHandler::TickResponse(
     std::uint64_t time_delta(req_body.at(KEY_timeDelta).as_int64());
 
     game_.AddTestTime(std::chrono::milliseconds(time_delta));
-    game_.Update(time_delta);
+    game_.FastForward(time_delta);
 
     object body;
 
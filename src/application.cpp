@@ -8,45 +8,41 @@ constexpr char KEY_D[] = "D";
 constexpr char KEY_L[] = "L";
 constexpr char KEY_R[] = "R";
 
-std::uint32_t Player::player_counter_{0};
-std::vector<std::shared_ptr<Player>> Players::players_{};
-
 Player::Player(
     std::shared_ptr<model::GameSession> session,
     std::shared_ptr<model::Dog> dog)
-    : dog_(dog)
-    , session_(session)
-    , token_(PlayerTokens().GenerateToken())
-    , id_(player_counter_++) {
+    : session_(session)
+    , dog_(dog)
+    , dog_id_(dog->GetId())
+    , name_(dog->GetName())
+    , token_(PlayerTokens::GenerateToken()) {
 }
 
 void Player::MakeAction(const std::string move) {
-    const auto speed = session_->GetMap()->GetDogSpeed();
+    model::DIRECTION direction = model::DIRECTION::NONE;
 
     if (move == KEY_U) {
-            dog_->SetSpeed({0, -speed});
-            dog_->SetDirection(model::DIRECTION::NORTH);
+            direction = model::DIRECTION::NORTH;
     } else if (move == KEY_D) {
-            dog_->SetSpeed({0, speed});
-            dog_->SetDirection(model::DIRECTION::SOUTH);
+            direction = model::DIRECTION::SOUTH;
     } else if (move == KEY_L) {
-            dog_->SetSpeed({-speed, 0});
-            dog_->SetDirection(model::DIRECTION::WEST);
+            direction = model::DIRECTION::WEST;
     } else if (move == KEY_R) {
-            dog_->SetSpeed({speed, 0});
-            dog_->SetDirection(model::DIRECTION::EAST);
-    } else {
-            dog_->SetSpeed({0, 0});
-            dog_->SetDirection(model::DIRECTION::NONE);
+            direction = model::DIRECTION::EAST;
     }
-    dog_->SetStatus(model::Dog::DOG_STATUS::ACTIVE);
-    dog_->ResetInactivityTimer();
+
+    // Команда будет применена в начале следующего тика
+    session_->EnqueueCommand({dog_id_, direction});
 }
 
 const std::shared_ptr<model::Dog> Player::GetDog() const {
     return dog_;
 }
 
+std::uint32_t Player::GetDogId() const {
+    return dog_id_;
+}
+
 void Player::SetId(uint32_t id) {
     id_ = id;
 }
@@ -56,7 +52,7 @@ const uint32_t Player::GetId() const {
 }
 
 const std::string Player::GetName() const {
-    return dog_->GetName();
+    return name_;
 }
 
 const std::shared_ptr<model::GameSession> Player::GetSession() const {
@@ -71,83 +67,90 @@ const Token Player::GetToken() const {
     return token_;
 }
 
-std::uint32_t Player::GetPlayerCounter() {
-    return player_counter_;
-}
-
-void Player::SetPlayerCounter(std::uint32_t counter) {
-    player_counter_ = counter;
-}
-
 std::shared_ptr<Player> Players::AddPlayer(
     std::shared_ptr<model::GameSession> session,
     std::shared_ptr<model::Dog> dog)
 {   
-    auto new_player_ptr = std::make_shared<Player>(session, dog);
+    auto new_player_ptr = pool_
+        ? util::MakePooled<Player>(pool_, session, dog)
+        : std::make_shared<Player>(session, dog);
 
+    std::unique_lock lock{mutex_};
+    new_player_ptr->SetId(player_counter_++);
     players_.push_back(new_player_ptr);
+    player_by_token_.emplace(new_player_ptr->GetToken(), new_player_ptr);
+
+    return new_player_ptr;
+}
 
-    return players_.back();
+void Players::SetPool(std::shared_ptr<util::PoolResource> pool) {
+    pool_ = std::move(pool);
 }
 
 void Players::AddPlayer(std::shared_ptr<Player> player) {
+    std::unique_lock lock{mutex_};
     players_.push_back(player);
+    player_by_token_.emplace(player->GetToken(), player);
 }
 
 std::optional<std::shared_ptr<Player>> Players::FindPlayerByToken(
-    const Token& token)
+    const Token& token) const
 {
-    for (auto& player : players_) {
-        if (player->GetToken() == token) {
-            return player;
-        }
+    std::shared_lock lock{mutex_};
+    auto it = player_by_token_.find(token);
+    if (it == player_by_token_.end()) {
+        return std::nullopt;
     }
-    return std::nullopt;
+    return it->second;
 }
 
-std::vector<std::shared_ptr<Player>> Players::FindPlayersInSession(
-    const Token& token)
+Players::PlayerIdsBySession Players::GetPlayerIdsBySession(
+    std::pmr::memory_resource* resource) const
 {
-    std::vector<std::shared_ptr<Player>> players_in_session;
-
-    if (FindPlayerByToken(token)) {
-        auto session = FindPlayerByToken(token).value()->GetSession();
-        for (auto& player : players_) {
-            if (player->GetSession() == session) {
-                players_in_session.push_back(player);
-            }
-        }
-    }
-    return players_in_session;
-}
+    // Вложенные таблицы получают тот же resource
+    PlayerIdsBySession result{resource};
 
-std::list<std::shared_ptr<model::Loot>> Players::FindLootInSession(
-        const Token& token) 
-{
-    if (!FindPlayerByToken(token)) {
-        return {};
+    std::shared_lock lock{mutex_};
+    for (const auto& player : players_) {
+        result[player->GetSession()->GetId()].emplace(
+            player->GetDogId(), player->GetId());
     }
-    auto session = FindPlayerByToken(token).value()->GetSession();
-    return session->GetLoot();
+    return result;
 }
 
-std::vector<std::shared_ptr<Player>>& Players::GetPlayers() {
+const std::vector<std::shared_ptr<Player>>& Players::GetPlayers() const {
     return players_;
 }
 
-void Players::RemovePlayerFromGameByDogId(std::uint32_t dog_id) {
+void Players::RemovePlayerFromGameByDogId(
+    std::uint32_t session_id,
+    std::uint32_t dog_id)
+{
+    std::unique_lock lock{mutex_};
     auto it = std::find_if(players_.begin(), players_.end(),
-        [dog_id](const auto& player) {
-            return player->GetDog()->GetId() == dog_id;
+        [session_id, dog_id](const auto& player) {
+            return player->GetSession()->GetId() == session_id &&
+                   player->GetDogId() == dog_id;
         }
     );
 
     if (it != players_.end()) {
         (*it)->GetSession()->RemoveDog(dog_id);
+        player_by_token_.erase((*it)->GetToken());
         players_.erase(it);
     }
 }
 
+std::uint32_t Players::GetPlayerCounter() const {
+    std::shared_lock lock{mutex_};
+    return player_counter_;
+}
+
+void Players::SetPlayerCounter(std::uint32_t counter) {
+    std::unique_lock lock{mutex_};
+    player_counter_ = counter;
+}
+
 std::shared_ptr<Player> JoinGameUseCase::execute(
     model::Game& game,
     const std::string& user_name,
@@ -166,14 +169,17 @@ std::shared_ptr<Player> JoinGameUseCase::execute(
     }
     
     std::shared_ptr<model::Dog> new_dog_ptr =
-        std::make_shared<model::Dog>(user_name, position);
+        game.MakeDog(user_name, position);
 
     new_dog_ptr->SetJoinTime(game.GetCurrentTime());
 
     std::shared_ptr<model::GameSession> session_ptr =
         game.AddDogToSession(new_dog_ptr, map_id);
     
-    return Players::AddPlayer(session_ptr, new_dog_ptr);
+    auto player = game.GetPlayers().AddPlayer(session_ptr, new_dog_ptr);
+    game.RefreshSnapshot(session_ptr);
+
+    return player;
 }
 
 std::shared_ptr<Player> Application::join_game(
@@ -2,14 +2,15 @@
 #pragma once
 
 #include "model.h"
+#include "random_id.h"
 #include "tagged.h"
 
-#include <iomanip>
 #include <memory>
+#include <memory_resource>
 #include <optional>
-#include <random>
-#include <sstream>
+#include <shared_mutex>
 #include <string>
+#include <unordered_map>
 
 namespace app {
 
@@ -22,29 +23,12 @@ struct TokenTag {};
 
 using Token = util::Tagged<std::string, detail::TokenTag>;
 
+// Токен - 128 случайных бит в виде 32 шестнадцатеричных цифр
 class PlayerTokens {
 public:
-    Token GenerateToken() {
-        uint64_t num1 = generator1_();
-        uint64_t num2 = generator2_();
-
-        std::stringstream ss;
-        ss << std::hex << std::setfill('0') << std::setw(16) << num1
-           << std::setw(16) << num2;
-
-        return Token(ss.str());
+    static Token GenerateToken() {
+        return Token(util::ToHex(util::NewRandomId()));
     }
-
-private:
-    std::random_device random_device_;
-    std::mt19937_64 generator1_{[&] {
-        std::uniform_int_distribution<std::mt19937_64::result_type> dist;
-        return dist(random_device_);
-    }()};
-    std::mt19937_64 generator2_{[&] {
-        std::uniform_int_distribution<std::mt19937_64::result_type> dist;
-        return dist(random_device_);
-    }()};
 };
 
 class Player {
@@ -55,7 +39,11 @@ public:
 
     void MakeAction(const std::string move);
 
+    // Собака - представление записи хранилища сессии и может
+    // использоваться только в тике. Идентификатор и имя собаки не
+    // меняются, поэтому копируются в игрока и доступны из любого потока
     const std::shared_ptr<model::Dog> GetDog() const;
+    std::uint32_t GetDogId() const;
 
     void SetId(uint32_t id);
     const uint32_t GetId() const;
@@ -67,43 +55,61 @@ public:
     void SetToken(Token token);
     const Token GetToken() const;
 
-    static std::uint32_t GetPlayerCounter();
-    static void SetPlayerCounter(std::uint32_t counter);
-
 private:
     std::shared_ptr<model::GameSession> session_;
     std::shared_ptr<model::Dog> dog_;
+    std::uint32_t dog_id_;
+    std::string name_;
     Token token_{"00000000000000000000000000000000"s};
-    uint32_t id_;
-    static std::uint32_t player_counter_;
+    uint32_t id_{0};
 };
 
-
+// Реестр игроков принадлежит model::Game и изменяется только между тиками.
+// Поиск игроков может выполняться из любого потока
 class Players {
 public:
-    Players() = delete;
-
-    static std::shared_ptr<Player> AddPlayer(
+    std::shared_ptr<Player> AddPlayer(
         std::shared_ptr<model::GameSession> session,
         std::shared_ptr<model::Dog> dog);
 
-    static void AddPlayer(std::shared_ptr<Player> player);
+    void AddPlayer(std::shared_ptr<Player> player);
+
+    // Новые игроки создаются в пуле pool
+    void SetPool(std::shared_ptr<util::PoolResource> pool);
+
+    std::optional<std::shared_ptr<Player>> FindPlayerByToken(
+        const Token& token) const;
 
-    static std::optional<std::shared_ptr<Player>> FindPlayerByToken(
-        const Token& token);
+    using PlayerIdsBySession = std::pmr::unordered_map<
+        std::uint32_t,
+        model::GameSession::PlayerIdByDog>;
 
-    static std::vector<std::shared_ptr<Player>> FindPlayersInSession(
-        const Token& token);
+    // Идентификаторы игроков по идентификаторам их собак для каждой
+    // сессии, в памяти resource
+    PlayerIdsBySession GetPlayerIdsBySession(
+        std::pmr::memory_resource* resource =
+            std::pmr::get_default_resource()) const;
 
-    static std::list<std::shared_ptr<model::Loot>> FindLootInSession(
-        const Token& token);
+    // Без блокировки: вызывается только там же, где изменяется реестр
+    const std::vector<std::shared_ptr<Player>>& GetPlayers() const;
 
-    static std::vector<std::shared_ptr<Player>>& GetPlayers();
+    // Идентификаторы собак уникальны только в пределах сессии
+    void RemovePlayerFromGameByDogId(
+        std::uint32_t session_id,
+        std::uint32_t dog_id);
 
-    static void RemovePlayerFromGameByDogId(std::uint32_t dogId);
+    std::uint32_t GetPlayerCounter() const;
+    void SetPlayerCounter(std::uint32_t counter);
 
 private:
-    static std::vector<std::shared_ptr<Player>> players_;
+    using TokenHasher = util::TaggedHasher<Token>;
+
+    mutable std::shared_mutex mutex_;
+    std::shared_ptr<util::PoolResource> pool_;
+    std::vector<std::shared_ptr<Player>> players_;
+    std::unordered_map<Token, std::shared_ptr<Player>, TokenHasher>
+        player_by_token_;
+    std::uint32_t player_counter_{0};
 };
 
 class JoinGameUseCase {
@@ -0,0 +1,280 @@
+// binary_format.cpp
+#include "binary_format.h"
+
+#include <bit>
+
+namespace binary_format {
+
+namespace {
+
+void WriteDog(Writer& writer, const model::SessionSnapshot::DogState& dog) {
+    writer.WriteU32(dog.player_id);
+    writer.WriteF64(dog.position.x);
+    writer.WriteF64(dog.position.y);
+    writer.WriteF64(dog.speed.x);
+    writer.WriteF64(dog.speed.y);
+    writer.WriteU8(static_cast<std::uint8_t>(ToBinary(dog.direction)));
+    writer.WriteU32(dog.score);
+    writer.WriteU32(static_cast<std::uint32_t>(dog.bag.size()));
+    for (const auto& item : dog.bag) {
+        writer.WriteU32(item.id);
+        writer.WriteU32(item.type);
+    }
+}
+
+void WriteLoot(Writer& writer, const model::SessionSnapshot::LootState& loot) {
+    writer.WriteU32(loot.id);
+    writer.WriteU32(loot.type);
+    writer.WriteF64(loot.position.x);
+    writer.WriteF64(loot.position.y);
+}
+
+// Размеры записей без учёта рюкзаков, чтобы выделить память один раз
+constexpr size_t HEADER_SIZE = 8;
+constexpr size_t DOG_RECORD_SIZE = 4 + 8 * 4 + 1 + 4 + 4;
+constexpr size_t BAG_ITEM_SIZE = 8;
+constexpr size_t LOOT_RECORD_SIZE = 4 + 4 + 8 * 2;
+
+}  // namespace
+
+Direction ToBinary(model::DIRECTION direction) {
+    switch (direction) {
+        case model::DIRECTION::NORTH:
+            return Direction::NORTH;
+        case model::DIRECTION::SOUTH:
+            return Direction::SOUTH;
+        case model::DIRECTION::WEST:
+            return Direction::WEST;
+        case model::DIRECTION::EAST:
+            return Direction::EAST;
+        case model::DIRECTION::NONE:
+            break;
+    }
+    return Direction::NONE;
+}
+
+model::DIRECTION FromBinary(Direction direction) {
+    switch (direction) {
+        case Direction::NONE:
+            return model::DIRECTION::NONE;
+        case Direction::NORTH:
+            return model::DIRECTION::NORTH;
+        case Direction::SOUTH:
+            return model::DIRECTION::SOUTH;
+        case Direction::WEST:
+            return model::DIRECTION::WEST;
+        case Direction::EAST:
+            return model::DIRECTION::EAST;
+    }
+    throw std::runtime_error("Invalid binary direction");
+}
+
+Writer::Writer(std::string& out)
+    : out_{out} {
+}
+
+void Writer::WriteU8(std::uint8_t value) {
+    out_.push_back(static_cast<char>(value));
+}
+
+void Writer::WriteU16(std::uint16_t value) {
+    WriteU8(static_cast<std::uint8_t>(value));
+    WriteU8(static_cast<std::uint8_t>(value >> 8));
+}
+
+void Writer::WriteU32(std::uint32_t value) {
+    char bytes[4];
+    for (int i = 0; i < 4; ++i) {
+        bytes[i] = static_cast<char>(value >> (8 * i));
+    }
+    out_.append(bytes, sizeof(bytes));
+}
+
+void Writer::WriteI32(std::int32_t value) {
+    WriteU32(static_cast<std::uint32_t>(value));
+}
+
+void Writer::WriteU64(std::uint64_t value) {
+    char bytes[8];
+    for (int i = 0; i < 8; ++i) {
+        bytes[i] = static_cast<char>(value >> (8 * i));
+    }
+    out_.append(bytes, sizeof(bytes));
+}
+
+void Writer::WriteF64(double value) {
+    WriteU64(std::bit_cast<std::uint64_t>(value));
+}
+
+void Writer::WriteString(std::string_view value) {
+    WriteU32(static_cast<std::uint32_t>(value.size()));
+    out_.append(value);
+}
+
+void Writer::WriteBytes(std::string_view bytes) {
+    out_.append(bytes);
+}
+
+void Writer::WriteHeader(Kind kind) {
+    WriteU32(MAGIC);
+    WriteU16(VERSION);
+    WriteU16(static_cast<std::uint16_t>(kind));
+}
+
+Reader::Reader(std::string_view data)
+    : data_{data} {
+}
+
+std::string_view Reader::Take(size_t size) {
+    if (data_.size() < size) {
+        throw std::out_of_range("Unexpected end of binary data");
+    }
+    std::string_view result = data_.substr(0, size);
+    data_.remove_prefix(size);
+    return result;
+}
+
+std::uint8_t Reader::ReadU8() {
+    return static_cast<std::uint8_t>(Take(1)[0]);
+}
+
+std::uint16_t Reader::ReadU16() {
+    auto bytes = Take(2);
+    return static_cast<std::uint16_t>(
+        static_cast<std::uint8_t>(bytes[0]) |
+        static_cast<std::uint8_t>(bytes[1]) << 8);
+}
+
+std::uint32_t Reader::ReadU32() {
+    auto bytes = Take(4);
+    std::uint32_t value = 0;
+    for (int i = 0; i < 4; ++i) {
+        value |= std::uint32_t{static_cast<std::uint8_t>(bytes[i])} << (8 * i);
+    }
+    return value;
+}
+
+std::int32_t Reader::ReadI32() {
+    return static_cast<std::int32_t>(ReadU32());
+}
+
+std::uint64_t Reader::ReadU64() {
+    auto bytes = Take(8);
+    std::uint64_t value = 0;
+    for (int i = 0; i < 8; ++i) {
+        value |= std::uint64_t{static_cast<std::uint8_t>(bytes[i])} << (8 * i);
+    }
+    return value;
+}
+
+double Reader::ReadF64() {
+    return std::bit_cast<double>(ReadU64());
+}
+
+std::string Reader::ReadString() {
+    std::uint32_t size = ReadU32();
+    return std::string(Take(size));
+}
+
+std::string_view Reader::ReadBytes(size_t size) {
+    return Take(size);
+}
+
+Kind Reader::ReadHeader() {
+    if (ReadU32() != MAGIC) {
+        throw std::runtime_error("Invalid binary message magic");
+    }
+    if (ReadU16() != VERSION) {
+        throw std::runtime_error("Unsupported binary message version");
+    }
+    return static_cast<Kind>(ReadU16());
+}
+
+bool Reader::AtEnd() const noexcept {
+    return data_.empty();
+}
+
+std::string EncodeState(
+    const model::SessionSnapshot& snapshot,
+    const model::SessionSnapshot::Visible* visible)
+{
+    const size_t dog_count =
+        visible ? visible->dogs.size() : snapshot.dogs.size();
+    const size_t loot_count =
+        visible ? visible->loot.size() : snapshot.loot.size();
+
+    std::string out;
+    out.reserve(HEADER_SIZE + 8 +
+        dog_count * (DOG_RECORD_SIZE + BAG_ITEM_SIZE * 3) +
+        loot_count * LOOT_RECORD_SIZE);
+
+    Writer writer{out};
+    writer.WriteHeader(Kind::STATE);
+
+    writer.WriteU32(static_cast<std::uint32_t>(dog_count));
+    if (visible) {
+        for (size_t index : visible->dogs) {
+            WriteDog(writer, snapshot.dogs[index]);
+        }
+    } else {
+        for (const auto& dog : snapshot.dogs) {
+            WriteDog(writer, dog);
+        }
+    }
+
+    writer.WriteU32(static_cast<std::uint32_t>(loot_count));
+    if (visible) {
+        for (size_t index : visible->loot) {
+            WriteLoot(writer, snapshot.loot[index]);
+        }
+    } else {
+        for (const auto& loot : snapshot.loot) {
+            WriteLoot(writer, loot);
+        }
+    }
+
+    return out;
+}
+
+std::string EncodeMap(
+    const model::Map& map,
+    std::string_view loot_types_json)
+{
+    std::string out;
+    Writer writer{out};
+    writer.WriteHeader(Kind::MAP);
+
+    writer.WriteString(*map.GetId());
+    writer.WriteString(map.GetName());
+
+    writer.WriteU32(static_cast<std::uint32_t>(map.GetRoads().size()));
+    for (const auto& road : map.GetRoads()) {
+        writer.WriteI32(road.GetStart().x);
+        writer.WriteI32(road.GetStart().y);
+        writer.WriteI32(road.GetEnd().x);
+        writer.WriteI32(road.GetEnd().y);
+    }
+
+    writer.WriteU32(static_cast<std::uint32_t>(map.GetBuildings().size()));
+    for (const auto& building : map.GetBuildings()) {
+        const auto& bounds = building.GetBounds();
+        writer.WriteI32(bounds.position.x);
+        writer.WriteI32(bounds.position.y);
+        writer.WriteI32(bounds.size.width);
+        writer.WriteI32(bounds.size.height);
+    }
+
+    writer.WriteU32(static_cast<std::uint32_t>(map.GetOffices().size()));
+    for (const auto& office : map.GetOffices()) {
+        writer.WriteString(*office.GetId());
+        writer.WriteI32(office.GetPosition().x);
+        writer.WriteI32(office.GetPosition().y);
+        writer.WriteI32(office.GetOffset().dx);
+        writer.WriteI32(office.GetOffset().dy);
+    }
+
+    writer.WriteString(loot_types_json);
+    return out;
+}
+
+}  // namespace binary_format
@@ -0,0 +1,109 @@
+// binary_format.h
+#pragma once
+
+#include "model.h"
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace binary_format {
+
+/*
+ *  Компактное двоичное представление ответов API.
+ *  Все числа записываются в порядке little-endian, строки - как длина
+ *  (uint32) и байты без завершающего нуля. Каждое сообщение начинается с
+ *  заголовка: MAGIC (uint32), VERSION (uint16), вид сообщения (uint16).
+ *
+ *  Состояние сессии (Kind::STATE):
+ *      uint32 число собак, для каждой:
+ *          uint32 id игрока, f64 x, f64 y, f64 vx, f64 vy,
+ *          uint8 направление (Direction), uint32 счёт,
+ *          uint32 размер рюкзака, для каждого предмета: uint32 id, uint32 тип
+ *      uint32 число потерянных предметов, для каждого:
+ *          uint32 id, uint32 тип, f64 x, f64 y
+ *
+ *  Карта (Kind::MAP):
+ *      string id, string name
+ *      uint32 число дорог, для каждой: int32 x0, y0, x1, y1
+ *      uint32 число зданий, для каждого: int32 x, y, w, h
+ *      uint32 число офисов, для каждого: string id, int32 x, y, dx, dy
+ *      string типы лута в формате JSON
+ */
+
+constexpr std::uint32_t MAGIC = 0x4E494247;  // "GBIN"
+constexpr std::uint16_t VERSION = 1;
+
+enum class Kind : std::uint16_t {
+    STATE = 1,
+    MAP = 2,
+};
+
+enum class Direction : std::uint8_t {
+    NONE = 0,
+    NORTH = 1,
+    SOUTH = 2,
+    WEST = 3,
+    EAST = 4,
+};
+
+class Writer {
+public:
+    explicit Writer(std::string& out);
+
+    void WriteU8(std::uint8_t value);
+    void WriteU16(std::uint16_t value);
+    void WriteU32(std::uint32_t value);
+    void WriteI32(std::int32_t value);
+    void WriteU64(std::uint64_t value);
+    void WriteF64(double value);
+    void WriteString(std::string_view value);
+    void WriteBytes(std::string_view bytes);
+
+    void WriteHeader(Kind kind);
+
+private:
+    std::string& out_;
+};
+
+// При выходе за пределы данных бросает std::out_of_range
+class Reader {
+public:
+    explicit Reader(std::string_view data);
+
+    std::uint8_t ReadU8();
+    std::uint16_t ReadU16();
+    std::uint32_t ReadU32();
+    std::int32_t ReadI32();
+    std::uint64_t ReadU64();
+    double ReadF64();
+    std::string ReadString();
+    std::string_view ReadBytes(size_t size);
+
+    // Проверяет MAGIC и VERSION и возвращает вид сообщения
+    Kind ReadHeader();
+
+    bool AtEnd() const noexcept;
+
+private:
+    std::string_view Take(size_t size);
+
+    std::string_view data_;
+};
+
+Direction ToBinary(model::DIRECTION direction);
+
+// Для неизвестного значения бросает std::runtime_error
+model::DIRECTION FromBinary(Direction direction);
+
+// Если задан visible, записываются только перечисленные в нём объекты
+std::string EncodeState(
+    const model::SessionSnapshot& snapshot,
+    const model::SessionSnapshot::Visible* visible = nullptr);
+
+std::string EncodeMap(
+    const model::Map& map,
+    std::string_view loot_types_json);
+
+}  // namespace binary_format
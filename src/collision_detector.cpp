@@ -2,6 +2,13 @@
 #include "collision_detector.h"
 
 #include <cassert>
+#include <cmath>
+#include <unordered_map>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define COLLISION_DETECTOR_AVX2 1
+#endif
 
 namespace collision_detector {
 
@@ -31,11 +38,16 @@ GathererProvider::GathererProvider()
     , gatherers_{} {
 }
 
+GathererProvider::GathererProvider(std::pmr::memory_resource* resource)
+    : items_{resource}
+    , gatherers_{resource} {
+}
+
 GathererProvider::GathererProvider(
     std::vector<Item> items,
     std::vector<Gatherer> gatherers)
-        : items_(items)
-        , gatherers_(gatherers) {
+        : items_(items.begin(), items.end())
+        , gatherers_(gatherers.begin(), gatherers.end()) {
 }
 
 size_t GathererProvider::ItemsCount() const {
@@ -62,46 +74,340 @@ Gatherer GathererProvider::GetGatherer(size_t idx) const {
     return gatherers_.at(idx);
 }
 
-std::vector<GatheringEvent> FindGatherEvents(
-    const ItemGathererProvider& provider)
+std::span<const Item> GathererProvider::Items() const {
+    return items_;
+}
+
+std::span<const Gatherer> GathererProvider::Gatherers() const {
+    return gatherers_;
+}
+
+// Предмет, попавший в радиус сбора: номер в пакете и результат проверки
+struct BatchHit {
+    std::uint32_t index;
+    double sq_distance;
+    double proj_ratio;
+};
+
+namespace {
+
+// Параметры отрезка собирателя, общие для всех предметов пакета
+struct Segment {
+    double a_x;
+    double a_y;
+    double v_x;
+    double v_y;
+    double v_len2;
+    double width;
+};
+
+Segment MakeSegment(const Gatherer& gatherer) {
+    const double v_x = gatherer.end_pos.x - gatherer.start_pos.x;
+    const double v_y = gatherer.end_pos.y - gatherer.start_pos.y;
+    return {gatherer.start_pos.x, gatherer.start_pos.y,
+            v_x, v_y, v_x * v_x + v_y * v_y, gatherer.width};
+}
+
+// Операции повторяют TryCollectPoint в том же порядке, поэтому результат
+// совпадает с ним до бита
+void CollectScalar(
+    const Segment& seg,
+    const double* xs, const double* ys, const double* widths,
+    size_t begin, size_t end,
+    std::pmr::vector<BatchHit>& hits)
+{
+    for (size_t i = begin; i < end; ++i) {
+        const double u_x = xs[i] - seg.a_x;
+        const double u_y = ys[i] - seg.a_y;
+        const double u_dot_v = u_x * seg.v_x + u_y * seg.v_y;
+        const double u_len2 = u_x * u_x + u_y * u_y;
+        const CollectionResult result{
+            u_len2 - (u_dot_v * u_dot_v) / seg.v_len2,
+            u_dot_v / seg.v_len2};
+        if (result.IsCollected(seg.width + widths[i])) {
+            hits.push_back({static_cast<std::uint32_t>(i),
+                            result.sq_distance, result.proj_ratio});
+        }
+    }
+}
+
+#ifdef COLLISION_DETECTOR_AVX2
+
+// Четыре предмета за итерацию. FMA не используется, чтобы округления
+// не отличались от скалярной версии
+__attribute__((target("avx2")))
+void CollectAvx2(
+    const Segment& seg,
+    const double* xs, const double* ys, const double* widths,
+    size_t begin, size_t end,
+    std::pmr::vector<BatchHit>& hits)
 {
-    std::vector<GatheringEvent> detected_events;
+    const __m256d a_x = _mm256_set1_pd(seg.a_x);
+    const __m256d a_y = _mm256_set1_pd(seg.a_y);
+    const __m256d v_x = _mm256_set1_pd(seg.v_x);
+    const __m256d v_y = _mm256_set1_pd(seg.v_y);
+    const __m256d v_len2 = _mm256_set1_pd(seg.v_len2);
+    const __m256d width = _mm256_set1_pd(seg.width);
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d one = _mm256_set1_pd(1.0);
 
-    static auto eq_pt = [](geom::Point2D p1, geom::Point2D p2) {
-        return p1.x == p2.x && p1.y == p2.y;
-    };
+    size_t i = begin;
+    for (; i + 4 <= end; i += 4) {
+        const __m256d u_x = _mm256_sub_pd(_mm256_loadu_pd(xs + i), a_x);
+        const __m256d u_y = _mm256_sub_pd(_mm256_loadu_pd(ys + i), a_y);
+        const __m256d u_dot_v = _mm256_add_pd(
+            _mm256_mul_pd(u_x, v_x), _mm256_mul_pd(u_y, v_y));
+        const __m256d u_len2 = _mm256_add_pd(
+            _mm256_mul_pd(u_x, u_x), _mm256_mul_pd(u_y, u_y));
+        const __m256d proj_ratio = _mm256_div_pd(u_dot_v, v_len2);
+        const __m256d sq_distance = _mm256_sub_pd(u_len2,
+            _mm256_div_pd(_mm256_mul_pd(u_dot_v, u_dot_v), v_len2));
+        const __m256d radius =
+            _mm256_add_pd(width, _mm256_loadu_pd(widths + i));
 
-    for (size_t g = 0; g < provider.GatherersCount(); ++g) {
-        Gatherer gatherer = provider.GetGatherer(g);
-        if (eq_pt(gatherer.start_pos, gatherer.end_pos)) {
+        const __m256d collected = _mm256_and_pd(
+            _mm256_and_pd(
+                _mm256_cmp_pd(proj_ratio, zero, _CMP_GE_OQ),
+                _mm256_cmp_pd(proj_ratio, one, _CMP_LE_OQ)),
+            _mm256_cmp_pd(sq_distance,
+                _mm256_mul_pd(radius, radius), _CMP_LE_OQ));
+
+        int mask = _mm256_movemask_pd(collected);
+        if (mask == 0) {
             continue;
         }
-        for (size_t i = 0; i < provider.ItemsCount(); ++i) {
-            Item item = provider.GetItem(i);
-            auto collect_result = TryCollectPoint(
-                gatherer.start_pos,
-                gatherer.end_pos,
-                item.position
-            );
-
-            if (collect_result.IsCollected(gatherer.width + item.width)) {
-                GatheringEvent evt{.item_id = i,
-                                   .gatherer_id = g,
-                                   .sq_distance = collect_result.sq_distance,
-                                   .time = collect_result.proj_ratio,
-                                   .item_type_ = item.item_type_};
-                detected_events.push_back(evt);
+
+        alignas(32) double sq[4];
+        alignas(32) double proj[4];
+        _mm256_store_pd(sq, sq_distance);
+        _mm256_store_pd(proj, proj_ratio);
+        for (int lane = 0; lane < 4; ++lane) {
+            if (mask & (1 << lane)) {
+                hits.push_back({static_cast<std::uint32_t>(i + lane),
+                                sq[lane], proj[lane]});
             }
         }
     }
 
+    CollectScalar(seg, xs, ys, widths, i, end, hits);
+}
+
+#endif
+
+using CollectKernel = void (*)(
+    const Segment&,
+    const double*, const double*, const double*,
+    size_t, size_t,
+    std::pmr::vector<BatchHit>&);
+
+// Реализация выбирается один раз по возможностям процессора
+CollectKernel SelectKernel() {
+#ifdef COLLISION_DETECTOR_AVX2
+    if (__builtin_cpu_supports("avx2")) {
+        return CollectAvx2;
+    }
+#endif
+    return CollectScalar;
+}
+
+const CollectKernel collect_kernel = SelectKernel();
+
+}  // namespace
+
+ItemIndex::ItemIndex(std::span<const Item> items, double cell_size,
+                     std::pmr::memory_resource* resource)
+    : cell_size_{cell_size}
+    , xs_{resource}
+    , ys_{resource}
+    , widths_{resource}
+    , item_index_{resource}
+    , item_types_{resource}
+    , cells_{resource} {
+    std::pmr::vector<std::pair<std::uint64_t, std::uint32_t>> order{resource};
+    order.reserve(items.size());
+    item_types_.reserve(items.size());
+    for (size_t i = 0; i < items.size(); ++i) {
+        order.emplace_back(Key(CellOf(items[i].position.x),
+                               CellOf(items[i].position.y)),
+                           static_cast<std::uint32_t>(i));
+        item_types_.push_back(items[i].item_type_);
+        max_item_width_ = std::max(max_item_width_, items[i].width);
+    }
+    std::sort(order.begin(), order.end());
+
+    xs_.reserve(items.size());
+    ys_.reserve(items.size());
+    widths_.reserve(items.size());
+    item_index_.reserve(items.size());
+    cells_.reserve(items.size());
+    for (size_t k = 0; k < order.size(); ++k) {
+        const Item& item = items[order[k].second];
+        xs_.push_back(item.position.x);
+        ys_.push_back(item.position.y);
+        widths_.push_back(item.width);
+        item_index_.push_back(order[k].second);
+
+        auto [it, inserted] = cells_.try_emplace(
+            order[k].first, std::pair<size_t, size_t>{k, k});
+        ++it->second.second;
+    }
+}
+
+size_t ItemIndex::Size() const noexcept {
+    return xs_.size();
+}
+
+GatheringEvents ItemIndex::FindGatherEvents(
+    std::span<const Gatherer> gatherers,
+    std::pmr::memory_resource* resource) const
+{
+    GatheringEvents detected_events{resource};
+    if (xs_.empty()) {
+        return detected_events;
+    }
+
+    // Буфер результатов пакетной проверки общий для всех собирателей
+    std::pmr::vector<BatchHit> hits{resource};
+    for (size_t g = 0; g < gatherers.size(); ++g) {
+        const Gatherer& gatherer = gatherers[g];
+        if (gatherer.start_pos.x == gatherer.end_pos.x &&
+            gatherer.start_pos.y == gatherer.end_pos.y)
+        {
+            continue;
+        }
+        Collect(gatherer, g, hits, detected_events);
+    }
+
+    // События добавляются в том же порядке, что и при полном переборе,
+    // поэтому результат сортировки совпадает с ним и для равных time
     std::sort(detected_events.begin(), detected_events.end(),
               [](const GatheringEvent& e_l, const GatheringEvent& e_r) {
                   return e_l.time < e_r.time;
               });
 
     return detected_events;
+}
+
+void ItemIndex::Collect(
+    const Gatherer& gatherer,
+    size_t gatherer_id,
+    std::pmr::vector<BatchHit>& hits,
+    GatheringEvents& events) const
+{
+    hits.clear();
+
+    const Segment seg = MakeSegment(gatherer);
+    const geom::Point2D& a = gatherer.start_pos;
+    const geom::Point2D& b = gatherer.end_pos;
+
+    // Запас покрывает погрешность вычисления расстояния в TryCollectPoint
+    const double radius = (gatherer.width + max_item_width_) *
+        (1 + GRID_RADIUS_MARGIN) + GRID_RADIUS_MARGIN;
+
+    const std::int64_t x0 = CellOf(std::min(a.x, b.x) - radius);
+    const std::int64_t x1 = CellOf(std::max(a.x, b.x) + radius);
+    const std::int64_t y0 = CellOf(std::min(a.y, b.y) - radius);
+    const std::int64_t y1 = CellOf(std::max(a.y, b.y) + radius);
+
+    // Если ячеек больше, чем предметов, дешевле проверить все предметы
+    const double cells_count =
+        static_cast<double>(x1 - x0 + 1) * static_cast<double>(y1 - y0 + 1);
+    if (cells_count > static_cast<double>(xs_.size())) {
+        collect_kernel(seg, xs_.data(), ys_.data(), widths_.data(),
+            0, xs_.size(), hits);
+    } else {
+        for (std::int64_t x = x0; x <= x1; ++x) {
+            for (std::int64_t y = y0; y <= y1; ++y) {
+                auto it = cells_.find(Key(x, y));
+                if (it != cells_.end()) {
+                    collect_kernel(seg, xs_.data(), ys_.data(),
+                        widths_.data(), it->second.first,
+                        it->second.second, hits);
+                }
+            }
+        }
+    }
+
+    for (BatchHit& hit : hits) {
+        hit.index = item_index_[hit.index];
+    }
+    // Разные ячейки могут давать одинаковый ключ
+    std::sort(hits.begin(), hits.end(),
+        [](const BatchHit& lhs, const BatchHit& rhs) {
+            return lhs.index < rhs.index;
+        });
+    hits.erase(std::unique(hits.begin(), hits.end(),
+        [](const BatchHit& lhs, const BatchHit& rhs) {
+            return lhs.index == rhs.index;
+        }), hits.end());
+
+    for (const BatchHit& hit : hits) {
+        events.push_back({.item_id = hit.index,
+                          .gatherer_id = gatherer_id,
+                          .sq_distance = hit.sq_distance,
+                          .time = hit.proj_ratio,
+                          .item_type_ = item_types_[hit.index]});
+    }
+}
+
+std::int64_t ItemIndex::CellOf(double coord) const {
+    return static_cast<std::int64_t>(std::floor(coord / cell_size_));
+}
+
+std::uint64_t ItemIndex::Key(std::int64_t x, std::int64_t y) {
+    return (static_cast<std::uint64_t>(x) << 32) ^
+           static_cast<std::uint32_t>(y);
+}
+
+GatheringEvents FindGatherEvents(
+    std::span<const Item> items,
+    std::span<const Gatherer> gatherers,
+    std::pmr::memory_resource* resource)
+{
+    double max_gatherer_width = 0;
+    double total_path = 0;
+    for (const Gatherer& gatherer : gatherers) {
+        if (gatherer.start_pos.x != gatherer.end_pos.x ||
+            gatherer.start_pos.y != gatherer.end_pos.y)
+        {
+            max_gatherer_width = std::max(max_gatherer_width, gatherer.width);
+            total_path += std::abs(gatherer.end_pos.x - gatherer.start_pos.x) +
+                          std::abs(gatherer.end_pos.y - gatherer.start_pos.y);
+        }
+    }
+
+    double max_item_width = 0;
+    for (const Item& item : items) {
+        max_item_width = std::max(max_item_width, item.width);
+    }
+
+    // Ячейка не меньше диаметра сбора и средней длины пути за вызов
+    const double cell_size = std::max({
+        2 * (max_gatherer_width + max_item_width),
+        gatherers.empty() ? 0.0 : total_path / gatherers.size(),
+        MIN_GRID_CELL_SIZE});
+
+    return ItemIndex{items, cell_size, resource}.FindGatherEvents(
+        gatherers, resource);
+}
+
+GatheringEvents FindGatherEvents(
+    const ItemGathererProvider& provider)
+{
+    // Каждый объект запрашивается у провайдера ровно один раз
+    std::vector<Item> items;
+    items.reserve(provider.ItemsCount());
+    for (size_t i = 0; i < provider.ItemsCount(); ++i) {
+        items.push_back(provider.GetItem(i));
+    }
+
+    std::vector<Gatherer> gatherers;
+    gatherers.reserve(provider.GatherersCount());
+    for (size_t g = 0; g < provider.GatherersCount(); ++g) {
+        gatherers.push_back(provider.GetGatherer(g));
+    }
 
+    return FindGatherEvents(items, gatherers);
 }
 
-}  // namespace collision_detector
\ No newline at end of file
+}  // namespace collision_detector
\ No newline at end of file
@@ -4,12 +4,21 @@
 #include "geom.h"
 
 #include <algorithm>
+#include <concepts>
 #include <cstdint>
+#include <memory_resource>
+#include <span>
 #include <stdexcept>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace collision_detector {
 
+// Относительный запас радиуса поиска в сетке и минимальный размер ячейки
+constexpr double GRID_RADIUS_MARGIN = 1e-9;
+constexpr double MIN_GRID_CELL_SIZE = 1e-3;
+
 enum ItemType {
     LOOT,
     OFFICE
@@ -65,10 +74,14 @@ struct GatheringEvent {
     ItemType item_type_;
 };
 
+using GatheringEvents = std::pmr::vector<GatheringEvent>;
+
 class GathererProvider: public ItemGathererProvider {
 public:
 
     GathererProvider();
+    // Объекты хранятся в памяти resource, например в арене тика
+    explicit GathererProvider(std::pmr::memory_resource* resource);
     GathererProvider(std::vector<Item> items,
                              std::vector<Gatherer> gatherers);
 
@@ -82,12 +95,85 @@ public:
     void AddGatherer(Gatherer gatherer);
     Gatherer GetGatherer(size_t idx) const override;
 
+    std::span<const Item> Items() const;
+    std::span<const Gatherer> Gatherers() const;
+
 private:
-    std::vector<Item> items_;
-    std::vector<Gatherer> gatherers_;
+    std::pmr::vector<Item> items_;
+    std::pmr::vector<Gatherer> gatherers_;
+};
+
+// Результат пакетной проверки предмета; определён в collision_detector.cpp
+struct BatchHit;
+
+// Неизменяемый набор предметов, разложенный по равномерной сетке.
+// Предметы одной ячейки хранятся непрерывно в массивах координат и ширин
+// (SoA) и проверяются одним пакетом. Для статических объектов (офисов)
+// набор строится один раз, для временных - в памяти resource
+class ItemIndex {
+public:
+    ItemIndex() = default;
+    ItemIndex(std::span<const Item> items, double cell_size,
+              std::pmr::memory_resource* resource =
+                  std::pmr::get_default_resource());
+
+    size_t Size() const noexcept;
+
+    // В item_id событий записывается номер предмета в исходном массиве.
+    // События упорядочены по time, а при равных time - как при полном
+    // переборе собирателей и предметов
+    GatheringEvents FindGatherEvents(
+        std::span<const Gatherer> gatherers,
+        std::pmr::memory_resource* resource =
+            std::pmr::get_default_resource()) const;
+
+private:
+    // Добавляет события собирателя в порядке возрастания номеров предметов.
+    // hits - буфер для промежуточных результатов
+    void Collect(
+        const Gatherer& gatherer,
+        size_t gatherer_id,
+        std::pmr::vector<BatchHit>& hits,
+        GatheringEvents& events) const;
+
+    std::int64_t CellOf(double coord) const;
+    static std::uint64_t Key(std::int64_t x, std::int64_t y);
+
+    double cell_size_ = MIN_GRID_CELL_SIZE;
+    double max_item_width_ = 0;
+    std::pmr::vector<double> xs_;
+    std::pmr::vector<double> ys_;
+    std::pmr::vector<double> widths_;
+    std::pmr::vector<std::uint32_t> item_index_;
+    std::pmr::vector<ItemType> item_types_;
+    // Ключ ячейки -> диапазон [first, second) в массивах
+    std::pmr::unordered_map<std::uint64_t, std::pair<size_t, size_t>> cells_;
+};
+
+// Провайдер, хранящий объекты в непрерывных массивах. Такие провайдеры
+// обходятся без виртуальных вызовов GetItem/GetGatherer
+template <typename Provider>
+concept ContiguousGathererProvider = requires(const Provider& provider) {
+    { provider.Items() } -> std::convertible_to<std::span<const Item>>;
+    { provider.Gatherers() } -> std::convertible_to<std::span<const Gatherer>>;
 };
 
-std::vector<GatheringEvent> FindGatherEvents(
+// Временные данные поиска и результат размещаются в памяти resource
+GatheringEvents FindGatherEvents(
+    std::span<const Item> items,
+    std::span<const Gatherer> gatherers,
+    std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+template <ContiguousGathererProvider Provider>
+GatheringEvents FindGatherEvents(
+    const Provider& provider,
+    std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+{
+    return FindGatherEvents(provider.Items(), provider.Gatherers(), resource);
+}
+
+// Копирует объекты провайдера и вызывает вариант для массивов
+GatheringEvents FindGatherEvents(
     const ItemGathererProvider& provider);
 
-}  // namespace collision_detector
\ No newline at end of file
+}  // namespace collision_detector
\ No newline at end of file
@@ -0,0 +1,118 @@
+// frame_arena.h
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+namespace util {
+
+constexpr size_t DEFAULT_FRAME_ARENA_SIZE = 64 * 1024;
+
+/*
+ *  Память для временных данных одного тика. Выделение сдвигает указатель
+ *  в текущем блоке, освобождение отдельных объектов ничего не делает,
+ *  а Reset() разом возвращает всю память арене. Блоки, взятые у кучи,
+ *  сохраняются между сбросами, поэтому после первых тиков арена больше
+ *  не обращается к куче. Области Scope могут быть вложенными: каждая
+ *  возвращает только память, выделенную за время её жизни
+ */
+class FrameArena final : public std::pmr::memory_resource {
+public:
+    explicit FrameArena(size_t initial_size = DEFAULT_FRAME_ARENA_SIZE)
+        : initial_size_{initial_size} {
+    }
+
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    // Все объекты, размещённые в арене, к этому моменту должны быть
+    // уничтожены
+    void Reset() noexcept {
+        current_ = 0;
+        offset_ = 0;
+    }
+
+    // Суммарный размер блоков арены
+    size_t Capacity() const noexcept {
+        size_t capacity = 0;
+        for (const auto& chunk : chunks_) {
+            capacity += chunk.size;
+        }
+        return capacity;
+    }
+
+    // Арена потока, выполняющего тик сессии
+    static FrameArena& ForThisThread() {
+        thread_local FrameArena arena;
+        return arena;
+    }
+
+    // Возвращает арену к состоянию на момент создания области
+    class Scope {
+    public:
+        explicit Scope(FrameArena& arena) noexcept
+            : arena_{arena}
+            , current_{arena.current_}
+            , offset_{arena.offset_} {
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+        ~Scope() {
+            arena_.current_ = current_;
+            arena_.offset_ = offset_;
+        }
+
+    private:
+        FrameArena& arena_;
+        size_t current_;
+        size_t offset_;
+    };
+
+private:
+    struct Chunk {
+        std::unique_ptr<std::byte[]> data;
+        size_t size;
+    };
+
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        while (current_ < chunks_.size()) {
+            Chunk& chunk = chunks_[current_];
+            void* ptr = chunk.data.get() + offset_;
+            size_t space = chunk.size - offset_;
+            if (std::align(alignment, bytes, ptr, space)) {
+                offset_ = chunk.size - space + bytes;
+                return ptr;
+            }
+            ++current_;
+            offset_ = 0;
+        }
+
+        // Новый блок вдвое больше предыдущего и вмещает запрос
+        // с любым выравниванием
+        const size_t size = std::max(bytes + alignment,
+            chunks_.empty() ? initial_size_ : chunks_.back().size * 2);
+        chunks_.push_back({std::make_unique<std::byte[]>(size), size});
+        return do_allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void*, size_t, size_t) override {
+    }
+
+    bool do_is_equal(
+        const std::pmr::memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    }
+
+    size_t initial_size_;
+    std::vector<Chunk> chunks_;
+    size_t current_ = 0;
+    size_t offset_ = 0;
+};
+
+}  // namespace util
@@ -6,15 +6,6 @@
 
 namespace http_handler {
 
-void AddHeaders(
-    StringResponse& response,
-    const std::map<http::field, std::string>& headers)
-{
-    for(auto &[key, val]: headers) {
-        response.set(key, val);
-    }
-}
-
 StringResponse MakeStringResponse(
     http::status status,
     std::string_view body,
@@ -35,6 +26,26 @@ StringResponse MakeStringResponse(
     return response;
 }
 
+SharedStringResponse MakeSharedStringResponse(
+    http::status status,
+    std::shared_ptr<const std::string> body,
+    unsigned http_version,
+    bool keep_alive,
+    std::string_view content_type,
+    const std::map<http::field, std::string>& extra_headers)
+{
+    SharedStringResponse response(status, http_version);
+
+    response.set(http::field::content_type, content_type);
+    response.content_length(SharedStringBody::size(body));
+    response.body() = std::move(body);
+    response.keep_alive(keep_alive);
+
+    AddHeaders(response, extra_headers);
+
+    return response;
+}
+
 std::string UrlDecode(const std::string& encoded) {
     std::string result;
     result.reserve(encoded.size());
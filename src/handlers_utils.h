@@ -7,6 +7,8 @@
 #include <boost/beast/http/file_body.hpp>
 
 #include <map>
+#include <memory>
+#include <string>
 #include <variant>
 
 namespace http_handler {
@@ -16,21 +18,67 @@ using namespace std::literals;
 namespace beast = boost::beast;
 namespace http = beast::http;
 
+// Тело ответа, разделяющее один неизменяемый буфер между многими ответами
+struct SharedStringBody {
+    using value_type = std::shared_ptr<const std::string>;
+
+    static std::uint64_t size(const value_type& body) {
+        return body ? body->size() : 0;
+    }
+
+    class writer {
+    public:
+        using const_buffers_type = boost::asio::const_buffer;
+
+        template <bool isRequest, class Fields>
+        writer(const http::header<isRequest, Fields>&, const value_type& body)
+            : body_(body) {
+        }
+
+        void init(beast::error_code& ec) {
+            ec = {};
+        }
+
+        boost::optional<std::pair<const_buffers_type, bool>> get(
+            beast::error_code& ec)
+        {
+            ec = {};
+            if (!body_ || body_->empty()) {
+                return boost::none;
+            }
+            return {{const_buffers_type{body_->data(), body_->size()}, false}};
+        }
+
+    private:
+        const value_type& body_;
+    };
+};
+
 using StringResponse = http::response<http::string_body>;
 using FileResponse = http::response<http::file_body>;
-using ServerResponse = std::variant<StringResponse, FileResponse>;
+using SharedStringResponse = http::response<SharedStringBody>;
+using ServerResponse =
+    std::variant<StringResponse, FileResponse, SharedStringResponse>;
 
 struct ContentType {
     ContentType() = delete;
     constexpr static std::string_view TEXT_HTML = "text/html"sv;
     constexpr static std::string_view TEXT_PLAIN = "text/plain"sv;
     constexpr static std::string_view APP_JSON = "application/json"sv;
+    constexpr static std::string_view APP_GAME_BINARY =
+        "application/x-game-binary"sv;
     // При необходимости внутрь ContentType можно добавить и другие типы контента
 };
 
+template <typename Body>
 void AddHeaders(
-    StringResponse& response,
-    const std::map<http::field, std::string>& headers);
+    http::response<Body>& response,
+    const std::map<http::field, std::string>& headers)
+{
+    for(auto &[key, val]: headers) {
+        response.set(key, val);
+    }
+}
 
 StringResponse MakeStringResponse(
     http::status status,
@@ -40,6 +88,14 @@ StringResponse MakeStringResponse(
     std::string_view content_type = ContentType::TEXT_HTML,
     const std::map<http::field, std::string>& extra_headers = {});
 
+SharedStringResponse MakeSharedStringResponse(
+    http::status status,
+    std::shared_ptr<const std::string> body,
+    unsigned http_version,
+    bool keep_alive,
+    std::string_view content_type = ContentType::TEXT_HTML,
+    const std::map<http::field, std::string>& extra_headers = {});
+
 std::string UrlDecode(const std::string& encoded);
 
 } // namespace http_handler
\ No newline at end of file
@@ -70,6 +70,9 @@ void SessionBase::OnRead(
     if (ec) {
         return ReportError(ec, "read"sv);
     }
+    if (websocket::is_upgrade(request_) && AcceptsUpgrade()) {
+        return HandleUpgrade(std::move(request_), std::move(stream_));
+    }
     HandleRequest(std::move(request_), stream_.socket().remote_endpoint());
 }
 
@@ -11,6 +11,7 @@
 #include <boost/asio/strand.hpp>
 #include <boost/beast/core.hpp>
 #include <boost/beast/http.hpp>
+#include <boost/beast/websocket.hpp>
 #include <boost/json.hpp>
 #include <boost/log/utility/manipulators/add_value.hpp>
 
@@ -23,11 +24,17 @@ namespace logging = boost::log;
 namespace net = boost::asio;
 namespace sys = boost::system;
 namespace http = beast::http;
+namespace websocket = beast::websocket;
 
 using tcp = net::ip::tcp;
 
 void ReportError(beast::error_code ec, std::string_view what);
 
+// Обработчик по умолчанию: запросы на смену протокола обрабатываются
+// как обычные HTTP-запросы
+struct NoUpgrade {
+};
+
 class SessionBase {
 public:
     // Запрещаем копирование и присваивание объектов SessionBase и его наследников
@@ -66,6 +73,13 @@ private:
         HttpRequest&& request,
         const tcp::endpoint& remote_endpoint) = 0;
 
+    // После передачи потока обработчику смены протокола
+    // HTTP-сессия больше не читает из него
+    virtual bool AcceptsUpgrade() const = 0;
+    virtual void HandleUpgrade(
+        HttpRequest&& request,
+        beast::tcp_stream&& stream) = 0;
+
     virtual std::shared_ptr<SessionBase> GetSharedThis() = 0;
 
     // tcp_stream содержит внутри себя сокет и добавляет поддержку таймаутов
@@ -74,15 +88,20 @@ private:
     HttpRequest request_;
 };
 
-template <typename RequestHandler>
+template <typename RequestHandler, typename UpgradeHandler = NoUpgrade>
 class Session
     : public SessionBase
-    , public std::enable_shared_from_this<Session<RequestHandler>> {	
+    , public std::enable_shared_from_this<
+        Session<RequestHandler, UpgradeHandler>> {
 public:
-    template <typename Handler>
-    Session(tcp::socket&& socket, Handler&& request_handler)
+    template <typename Handler, typename Upgrade>
+    Session(
+        tcp::socket&& socket,
+        Handler&& request_handler,
+        Upgrade&& upgrade_handler)
         : SessionBase(std::move(socket))
-        , request_handler_(std::forward<Handler>(request_handler)) {
+        , request_handler_(std::forward<Handler>(request_handler))
+        , upgrade_handler_(std::forward<Upgrade>(upgrade_handler)) {
     }
 
 private:
@@ -92,21 +111,30 @@ private:
         HttpRequest&& request,
         const tcp::endpoint& remote_endpoint) override;
 
+    bool AcceptsUpgrade() const override;
+    void HandleUpgrade(
+        HttpRequest&& request,
+        beast::tcp_stream&& stream) override;
+
     RequestHandler request_handler_;
+    UpgradeHandler upgrade_handler_;
 };
 
-template <typename RequestHandler>
-class Listener : public std::enable_shared_from_this<Listener<RequestHandler>> {
+template <typename RequestHandler, typename UpgradeHandler = NoUpgrade>
+class Listener : public std::enable_shared_from_this<
+    Listener<RequestHandler, UpgradeHandler>> {
 public:
-    template <typename Handler>
+    template <typename Handler, typename Upgrade = NoUpgrade>
     Listener(
         net::io_context& ioc,
         const tcp::endpoint& endpoint,
-        Handler&& request_handler)
+        Handler&& request_handler,
+        Upgrade&& upgrade_handler = {})
     : ioc_(ioc)
     // Обработчики асинхронных операций acceptor_ будут вызываться в своём strand
     , acceptor_(net::make_strand(ioc))
     , request_handler_(std::forward<Handler>(request_handler))
+    , upgrade_handler_(std::forward<Upgrade>(upgrade_handler))
 {
     // Открываем acceptor, используя протокол (IPv4 или IPv6), указанный в endpoint
     acceptor_.open(endpoint.protocol());
@@ -135,6 +163,7 @@ private:
     net::io_context& ioc_;
     tcp::acceptor acceptor_;
     RequestHandler request_handler_;
+    UpgradeHandler upgrade_handler_;
 };
 
 template <typename RequestHandler>
@@ -153,6 +182,27 @@ void ServeHttp(
     )->Run();
 }
 
+// Запросы на смену протокола передаются upgrade_handler вместе с потоком
+// соединения: upgrade_handler(request, beast::tcp_stream&&)
+template <typename RequestHandler, typename UpgradeHandler>
+void ServeHttp(
+    net::io_context& ioc,
+    const tcp::endpoint& endpoint,
+    RequestHandler&& handler,
+    UpgradeHandler&& upgrade_handler)
+{
+    using MyListener = Listener<
+        std::decay_t<RequestHandler>,
+        std::decay_t<UpgradeHandler>>;
+
+    std::make_shared<MyListener>(
+        ioc,
+        endpoint,
+        std::forward<RequestHandler>(handler),
+        std::forward<UpgradeHandler>(upgrade_handler)
+    )->Run();
+}
+
 template <typename Body, typename Fields>
 void SessionBase::DoWrite(
     SessionBase* session,
@@ -172,13 +222,29 @@ void SessionBase::DoWrite(
     );
 }
 
-template <class RequestHandler>
-std::shared_ptr<SessionBase> Session<RequestHandler>::GetSharedThis() {
+template <class RequestHandler, class UpgradeHandler>
+std::shared_ptr<SessionBase>
+Session<RequestHandler, UpgradeHandler>::GetSharedThis() {
     return this->shared_from_this();
 }
 
-template <class RequestHandler>
-void Session<RequestHandler>::HandleRequest(
+template <class RequestHandler, class UpgradeHandler>
+bool Session<RequestHandler, UpgradeHandler>::AcceptsUpgrade() const {
+    return !std::is_same_v<UpgradeHandler, NoUpgrade>;
+}
+
+template <class RequestHandler, class UpgradeHandler>
+void Session<RequestHandler, UpgradeHandler>::HandleUpgrade(
+    HttpRequest&& request,
+    beast::tcp_stream&& stream)
+{
+    if constexpr (!std::is_same_v<UpgradeHandler, NoUpgrade>) {
+        upgrade_handler_(std::move(request), std::move(stream));
+    }
+}
+
+template <class RequestHandler, class UpgradeHandler>
+void Session<RequestHandler, UpgradeHandler>::HandleRequest(
     HttpRequest&& request,
     const tcp::endpoint& remote_endpoint)
 {
@@ -194,13 +260,13 @@ void Session<RequestHandler>::HandleRequest(
     );
 }
 
-template <class RequestHandler>
-void Listener<RequestHandler>::Run() {
+template <class RequestHandler, class UpgradeHandler>
+void Listener<RequestHandler, UpgradeHandler>::Run() {
     DoAccept();
 }
 
-template <class RequestHandler>
-void Listener<RequestHandler>::DoAccept() {
+template <class RequestHandler, class UpgradeHandler>
+void Listener<RequestHandler, UpgradeHandler>::DoAccept() {
     acceptor_.async_accept(
         // Передаём последовательный исполнитель, в котором будут вызываться обработчики
         // асинхронных операций сокета
@@ -216,8 +282,11 @@ void Listener<RequestHandler>::DoAccept() {
         beast::bind_front_handler(&Listener::OnAccept, this->shared_from_this()));
 }
 
-template <class RequestHandler>
-void Listener<RequestHandler>::OnAccept(sys::error_code ec, tcp::socket socket) {
+template <class RequestHandler, class UpgradeHandler>
+void Listener<RequestHandler, UpgradeHandler>::OnAccept(
+    sys::error_code ec,
+    tcp::socket socket)
+{
     using namespace std::literals;
 
     if (ec) {
@@ -231,10 +300,12 @@ void Listener<RequestHandler>::OnAccept(sys::error_code ec, tcp::socket socket)
     DoAccept();
 }
 
-template <class RequestHandler>
-void Listener<RequestHandler>::AsyncRunSession(tcp::socket&& socket) {
-    std::make_shared<Session<RequestHandler>>(
-        std::move(socket), request_handler_
+template <class RequestHandler, class UpgradeHandler>
+void Listener<RequestHandler, UpgradeHandler>::AsyncRunSession(
+    tcp::socket&& socket)
+{
+    std::make_shared<Session<RequestHandler, UpgradeHandler>>(
+        std::move(socket), request_handler_, upgrade_handler_
     )->Run();
 }
 
@@ -1,6 +1,7 @@
 // json_loader.cpp
 #include "json_loader.h"
 
+#include <cstdint>
 #include <fstream>
 #include <stdexcept>
 
@@ -18,10 +19,12 @@ constexpr char KEY_bagCapacity[] = "bagCapacity";
 constexpr char KEY_buildings[] = "buildings";
 constexpr char KEY_defaultBagCapacity[] = "defaultBagCapacity";
 constexpr char KEY_defaultDogSpeed[] = "defaultDogSpeed";
+constexpr char KEY_defaultViewRadius[] = "defaultViewRadius";
 constexpr char KEY_dogRetirementTime[] = "dogRetirementTime";
 constexpr char KEY_dogSpeed[] = "dogSpeed";
 constexpr char KEY_id[] = "id";
 constexpr char KEY_lootGeneratorConfig[] = "lootGeneratorConfig";
+constexpr char KEY_lootPerSession[] = "lootPerSession";
 constexpr char KEY_lootTypes[] = "lootTypes";
 constexpr char KEY_maps[] = "maps";
 constexpr char KEY_name[] = "name";
@@ -29,13 +32,38 @@ constexpr char KEY_offices[] = "offices";
 constexpr char KEY_offset_X[] = "offsetX";
 constexpr char KEY_offset_Y[] = "offsetY";
 constexpr char KEY_period[] = "period";
+constexpr char KEY_players[] = "players";
+constexpr char KEY_poolCapacity[] = "poolCapacity";
 constexpr char KEY_probability[] = "probability";        
 constexpr char KEY_roads[] = "roads";
 constexpr char KEY_value[] = "value";
+constexpr char KEY_viewRadius[] = "viewRadius";
 
 using namespace boost::json;
 using namespace std::literals;
 
+namespace {
+
+double GetViewRadius(const value& radius_value) {
+    const double radius = radius_value.is_int64()
+        ? static_cast<double>(radius_value.as_int64())
+        : radius_value.as_double();
+    if (radius < 0) {
+        throw std::invalid_argument("Negative view radius"s);
+    }
+    return radius;
+}
+
+size_t GetPoolCapacity(const value& capacity_value) {
+    const std::int64_t capacity = capacity_value.as_int64();
+    if (capacity < 0) {
+        throw std::invalid_argument("Negative pool capacity"s);
+    }
+    return static_cast<size_t>(capacity);
+}
+
+}  // namespace
+
 model::Game LoadGame(const std::filesystem::path& json_path) {
     // Загрузить содержимое файла json_path, например, в виде строки
     // Распарсить строку как JSON, используя boost::json::parse
@@ -60,6 +88,7 @@ model::Game LoadGame(const std::filesystem::path& json_path) {
         model::Game game;
         double default_dog_speed = model::DEFAULT_DOG_SPEED;
         int default_bag_capacity = model::DEFAULT_BAG_CAPACITY;
+        double default_view_radius = model::DEFAULT_VIEW_RADIUS;
 
         if (json_document.as_object().contains(KEY_defaultDogSpeed)) {
             default_dog_speed =
@@ -76,6 +105,26 @@ model::Game LoadGame(const std::filesystem::path& json_path) {
                 json_document.at(KEY_defaultBagCapacity).as_int64();
         }
 
+        if (json_document.as_object().contains(KEY_defaultViewRadius)) {
+            default_view_radius =
+                GetViewRadius(json_document.at(KEY_defaultViewRadius));
+        }
+
+        if (json_document.as_object().contains(KEY_poolCapacity)) {
+            const auto& pool_capacity =
+                json_document.at(KEY_poolCapacity).as_object();
+            size_t players = model::DEFAULT_PLAYER_POOL_CAPACITY;
+            size_t loot_per_session = model::DEFAULT_LOOT_POOL_CAPACITY;
+            if (pool_capacity.contains(KEY_players)) {
+                players = GetPoolCapacity(pool_capacity.at(KEY_players));
+            }
+            if (pool_capacity.contains(KEY_lootPerSession)) {
+                loot_per_session =
+                    GetPoolCapacity(pool_capacity.at(KEY_lootPerSession));
+            }
+            game.SetPoolCapacity(players, loot_per_session);
+        }
+
         AddLootGeneratorConfig(game, json_document);
 
         auto loot_types_storage_ptr =
@@ -87,6 +136,7 @@ model::Game LoadGame(const std::filesystem::path& json_path) {
 
             double dog_speed = default_dog_speed;
             int bag_capacity = default_bag_capacity;
+            double view_radius = default_view_radius;
 
             if (obj_map.contains(KEY_dogSpeed)) {
                 dog_speed = obj_map.at(KEY_dogSpeed).as_double();
@@ -96,11 +146,16 @@ model::Game LoadGame(const std::filesystem::path& json_path) {
                 bag_capacity = obj_map.at(KEY_bagCapacity).as_int64();
             }
 
+            if (obj_map.contains(KEY_viewRadius)) {
+                view_radius = GetViewRadius(obj_map.at(KEY_viewRadius));
+            }
+
             model::Map::Id id(obj_map[KEY_id].as_string().c_str());
             model::Map new_map(id, obj_map[KEY_name].as_string().c_str());
 
             new_map.SetDogSpeed(dog_speed);
             new_map.SetBagCapacity(bag_capacity);
+            new_map.SetViewRadius(view_radius);
 
             // Добавляем дороги
             AddRoads(new_map, obj_map[KEY_roads].as_array());
@@ -0,0 +1,36 @@
+// lazy_value.h
+#pragma once
+
+#include <mutex>
+#include <optional>
+#include <utility>
+
+namespace util {
+
+/*
+ *  Значение, вычисляемое при первом обращении ровно один раз.
+ *  Конкурентные обращения ждут завершения первого вычисления;
+ *  если вычисление бросило исключение, следующее обращение повторит его
+ */
+template <typename T>
+class Lazy {
+public:
+    Lazy() = default;
+
+    Lazy(const Lazy&) = delete;
+    Lazy& operator=(const Lazy&) = delete;
+
+    template <typename Fn>
+    const T& Get(Fn&& compute) const {
+        std::call_once(once_, [this, &compute] {
+            value_.emplace(std::forward<Fn>(compute)());
+        });
+        return *value_;
+    }
+
+private:
+    mutable std::once_flag once_;
+    mutable std::optional<T> value_;
+};
+
+}  // namespace util
@@ -17,6 +17,8 @@
 #include "json_loader.h"
 #include "my_logger.h"
 #include "request_handler.h"
+#include "state_snapshot.h"
+#include "state_socket.h"
 
 using namespace std::literals;
 using namespace boost::json;
@@ -103,10 +105,14 @@ struct Args {
     std::string config_file_path;
     std::string www_root_path;
     bool randomize_spawn_points;
+    bool analytic_kinematics = false;
+    std::optional<int64_t> fixed_timestep;
+    unsigned max_substeps = 8;
     bool game_test_mode = false;
     std::string state_file_path;
     int64_t save_state_period;
     bool save_state_period_set = false;
+    std::string state_format = "text"s;
 };
 
 [[nodiscard]] std::optional<Args> ParseCommandLine(
@@ -131,12 +137,23 @@ struct Args {
             "set static files root")
         ("randomize-spawn-points",
             "spawn dogs at random positions")
+        ("analytic-kinematics",
+            "compute dog movement analytically between events")
+        ("fixed-timestep",
+            po::value<int64_t>()->value_name("milliseconds"s),
+            "simulate the game in steps of fixed length")
+        ("max-substeps",
+            po::value(&args.max_substeps)->value_name("count"s),
+            "limit fixed steps per tick (8 by default)")
         ("state-file,s",
             po::value(&args.state_file_path)->value_name("file"s),
             "set state file root")
         ("save-state-period",
             po::value(&args.save_state_period)->value_name("milliseconds"s),
-            "set save state period");
+            "set save state period")
+        ("state-format",
+            po::value(&args.state_format)->value_name("text|binary"s),
+            "set save state file format (text by default)");
 
     po::variables_map vm;
     po::store(po::parse_command_line(argc, argv, desc), vm);
@@ -158,6 +175,10 @@ struct Args {
         args.save_state_period_set = true;
     }
     
+    if (args.state_format != "text"s && args.state_format != "binary"s) {
+        throw std::runtime_error("Unknown state file format"s);
+    }
+
     if (vm.count("tick-period"s) == false) {
         args.game_test_mode = true;
     }
@@ -168,6 +189,12 @@ struct Args {
         args.randomize_spawn_points = true;
     }
 
+    args.analytic_kinematics = vm.contains("analytic-kinematics"s);
+
+    if (vm.contains("fixed-timestep"s)) {
+        args.fixed_timestep = vm["fixed-timestep"s].as<int64_t>();
+    }
+
     return args;
 }
 
@@ -200,6 +227,9 @@ int main(int argc, const char* argv[]) {
 
         if (!args.state_file_path.empty()) {
             game.SetSaveFilePath(args.state_file_path);
+            game.SetStateFormat(args.state_format == "binary"s
+                ? serialization::StateFormat::BINARY
+                : serialization::StateFormat::TEXT);
 
             if (std::filesystem::exists(
                 std::filesystem::path(args.state_file_path)))
@@ -215,6 +245,10 @@ int main(int argc, const char* argv[]) {
         }
 
         game.SetDogSpawnMode(args.randomize_spawn_points);
+        game.SetKinematicsMode(args.analytic_kinematics);
+        if (args.fixed_timestep) {
+            game.SetFixedTimestep(*args.fixed_timestep, args.max_substeps);
+        }
         game.SetGameMode(args.game_test_mode);
 
         if (args.save_state_period_set) {
@@ -261,6 +295,20 @@ int main(int argc, const char* argv[]) {
         );
         http_handler::LoggingRequestHandler logging_handler(*handler);
 
+        // Подписчики WebSocket получают состояние по окончании каждого тика,
+        // в том числе выполненного через /api/v1/game/tick
+        auto state_sockets = std::make_shared<http_handler::StateSocketHub>(game);
+        game.SetTickListener([state_sockets](std::uint64_t) {
+            state_sockets->Broadcast();
+        });
+
+        // Сессии обновляются параллельно на рабочих потоках io_context
+        game.SetTickExecutor(
+            [&ioc](std::function<void()> task) {
+                net::post(ioc, std::move(task));
+            },
+            num_threads);
+
         if (!args.game_test_mode) {
             game.SetStartTime(std::chrono::steady_clock::now());
             auto ticker = std::make_shared<Ticker>(api_strand, std::chrono::milliseconds(args.tick_period),
@@ -284,6 +332,10 @@ int main(int argc, const char* argv[]) {
                     remote_endpoint,
                     std::forward<decltype(send)>(send)
                 );
+            },
+            [state_sockets](auto&& req, beast::tcp_stream&& stream) {
+                state_sockets->Upgrade(
+                    std::forward<decltype(req)>(req), std::move(stream));
             }
         );
 
@@ -1,8 +1,7 @@
 // model.cpp
 #include "model.h"
 
-#include <boost/archive/text_oarchive.hpp>
-#include <boost/archive/text_iarchive.hpp>
+#include <boost/iterator/function_output_iterator.hpp>
 #include <boost/json.hpp>
 #include <boost/log/trivial.hpp>
 #include <boost/log/utility/setup/console.hpp>
@@ -13,18 +12,26 @@
 #include "database.h"
 #include "model_serialization.h"
 #include "my_logger.h"
+#include "state_writer.h"
 #include "tagged_uuid.h"
 
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
 #include <iostream>
 #include <filesystem>
-#include <fstream>
+#include <iterator>
+#include <mutex>
 #include <random>
 #include <stdexcept>
+#include <tuple>
+#include <type_traits>
 
 namespace model {
 
 constexpr double MS_IN_SECONDS = 1000.0;
+constexpr double RETIREMENT_TOLERANCE_MS = 1e-6;
 
 using namespace boost::json;
 using namespace std::literals;
@@ -32,13 +39,181 @@ namespace bg = boost::geometry;
 namespace fs = std::filesystem;
 namespace logging = boost::log;
 
-int GetRandomId(int max_id) {
-    static std::random_device rd;
-    static std::mt19937 gen(rd());
-    std::uniform_int_distribution<int> dist(0, max_id);
-    return dist(gen);
+namespace {
+
+// Генератор потока. Устройство случайных чисел читается один раз при
+// первом обращении потока
+std::mt19937_64& ThreadRandom() {
+    thread_local std::mt19937_64 random{std::random_device{}()};
+    return random;
+}
+
+// Выполняет fn(0) ... fn(count - 1), раздавая индексы задачам runner.
+// Вызывающий поток тоже забирает индексы, поэтому выполнение завершится,
+// даже если свободных рабочих потоков нет. Возврат происходит только
+// после обработки всех индексов. Если помощников не будет, индексы
+// обрабатываются по порядку без общего состояния и без обращений к куче
+template <typename Fn>
+void RunInParallel(
+    size_t count,
+    const Game::TaskRunner& runner,
+    unsigned concurrency,
+    Fn&& fn)
+{
+    const size_t helpers = runner
+        ? std::min<size_t>(count, std::max(1u, concurrency)) - 1
+        : 0;
+
+    if (helpers == 0) {
+        std::exception_ptr error;
+        for (size_t i = 0; i < count; ++i) {
+            try {
+                fn(i);
+            } catch (...) {
+                if (!error) {
+                    error = std::current_exception();
+                }
+            }
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+        return;
+    }
+
+    using Function = std::remove_reference_t<Fn>;
+
+    struct State {
+        explicit State(size_t count, Function& fn)
+            : count{count}
+            , fn{&fn} {
+        }
+
+        void Work() {
+            for (size_t i = next.fetch_add(1); i < count;
+                 i = next.fetch_add(1))
+            {
+                try {
+                    (*fn)(i);
+                } catch (...) {
+                    std::lock_guard lock{mutex};
+                    if (!error) {
+                        error = std::current_exception();
+                    }
+                }
+
+                std::lock_guard lock{mutex};
+                if (++done == count) {
+                    cond_var.notify_all();
+                }
+            }
+        }
+
+        const size_t count;
+        Function* fn;
+        std::atomic<size_t> next{0};
+        size_t done = 0;
+        std::exception_ptr error;
+        std::mutex mutex;
+        std::condition_variable cond_var;
+    };
+
+    // Задачи могут начаться уже после возврата из функции, поэтому
+    // состояние живёт в куче, пока на него ссылается хотя бы одна задача
+    auto state = std::make_shared<State>(count, fn);
+
+    for (size_t i = 0; i < helpers; ++i) {
+        runner([state] {
+            state->Work();
+        });
+    }
+
+    state->Work();
+
+    std::unique_lock lock{state->mutex};
+    state->cond_var.wait(lock, [&state] {
+        return state->done == state->count;
+    });
+
+    if (state->error) {
+        std::rethrow_exception(state->error);
+    }
 }
 
+bool IsSameDogState(
+    const SessionSnapshot::DogState& lhs,
+    const SessionSnapshot::DogState& rhs)
+{
+    if (lhs.position.x != rhs.position.x ||
+        lhs.position.y != rhs.position.y ||
+        lhs.speed.x != rhs.speed.x ||
+        lhs.speed.y != rhs.speed.y ||
+        lhs.direction != rhs.direction ||
+        lhs.score != rhs.score ||
+        lhs.bag.size() != rhs.bag.size())
+    {
+        return false;
+    }
+    return std::equal(lhs.bag.begin(), lhs.bag.end(), rhs.bag.begin(),
+        [](const auto& a, const auto& b) {
+            return a.id == b.id;
+        });
+}
+
+// Дописывает удалённые объекты к истории и отбрасывает записи, которые
+// уже не нужны ни одному допустимому значению since
+template <typename Removed>
+std::shared_ptr<const SessionSnapshot::Removals> UpdateRemovals(
+    const std::shared_ptr<const SessionSnapshot::Removals>& history,
+    const Removed& removed,
+    std::uint64_t change_tick,
+    std::uint64_t history_start)
+{
+    bool expired = history && !history->empty() &&
+        history->front().tick <= history_start;
+
+    if (removed.empty() && !expired) {
+        return history ? history
+                       : std::make_shared<const SessionSnapshot::Removals>();
+    }
+
+    auto result = std::make_shared<SessionSnapshot::Removals>();
+    if (history) {
+        std::copy_if(history->begin(), history->end(),
+            std::back_inserter(*result),
+            [history_start](const auto& removal) {
+                return removal.tick > history_start;
+            });
+    }
+    for (const auto& [id, state] : removed) {
+        result->push_back({change_tick, id});
+    }
+    return result;
+}
+
+// Собака с направлением и ненулевой скоростью пытается сдвинуться
+bool HasVelocity(const DogStore::HotArrays& hot, size_t index) {
+    return hot.direction[index] != DIRECTION::NONE &&
+           (std::abs(hot.speed_x[index]) >=
+                std::numeric_limits<double>::epsilon() ||
+            std::abs(hot.speed_y[index]) >=
+                std::numeric_limits<double>::epsilon());
+}
+
+// Полоса дороги: область, в которой Game::IsPointOnRoad считает точку
+// лежащей на дороге
+Box RoadArea(const Road& road) {
+    const Coord min_x = std::min(road.GetStart().x, road.GetEnd().x);
+    const Coord max_x = std::max(road.GetStart().x, road.GetEnd().x);
+    const Coord min_y = std::min(road.GetStart().y, road.GetEnd().y);
+    const Coord max_y = std::max(road.GetStart().y, road.GetEnd().y);
+    return Box{
+        PointBG{min_x - ROAD_HALF_WIDTH, min_y - ROAD_HALF_WIDTH},
+        PointBG{max_x + ROAD_HALF_WIDTH, max_y + ROAD_HALF_WIDTH}};
+}
+
+}  // namespace
+
 Road::Road(HorizontalTag, Point start, Coord end_x) noexcept
     : start_{start}
     , end_{end_x, start.y}
@@ -121,6 +296,139 @@ double Office::GetWidth() const noexcept {
     return width_;
 }
 
+RoadIndex::RoadIndex(const std::vector<Road>& roads) {
+    std::unordered_map<Coord, size_t> row_by_y;
+    std::unordered_map<Coord, size_t> column_by_x;
+
+    for (size_t i = 0; i < roads.size(); ++i) {
+        const Road& road = roads[i];
+        // Дорога нулевой длины считается вертикальной, как и в
+        // Road::BuildBoundingBox
+        const bool vertical = road.IsVertical();
+        const Coord coord = vertical ? road.GetStart().x : road.GetStart().y;
+        const Coord a = vertical ? road.GetStart().y : road.GetStart().x;
+        const Coord b = vertical ? road.GetEnd().y : road.GetEnd().x;
+
+        auto& lines = vertical ? columns_ : rows_;
+        auto& index = vertical ? column_by_x : row_by_y;
+        auto [it, inserted] = index.emplace(coord, lines.size());
+        if (inserted) {
+            lines.push_back(Line{coord, {}});
+        }
+        lines[it->second].spans.push_back(Span{
+            static_cast<double>(std::min(a, b)),
+            static_cast<double>(std::max(a, b)),
+            0,
+            i});
+    }
+
+    SortLines(rows_);
+    SortLines(columns_);
+}
+
+void RoadIndex::SortLines(std::vector<Line>& lines) {
+    std::sort(lines.begin(), lines.end(),
+        [](const Line& lhs, const Line& rhs) {
+            return lhs.coord < rhs.coord;
+        });
+
+    for (Line& line : lines) {
+        std::sort(line.spans.begin(), line.spans.end(),
+            [](const Span& lhs, const Span& rhs) {
+                return lhs.begin < rhs.begin;
+            });
+
+        double max_end = std::numeric_limits<double>::lowest();
+        for (Span& span : line.spans) {
+            max_end = std::max(max_end, span.end);
+            span.max_end = max_end;
+        }
+    }
+}
+
+RoadGraph::RoadGraph(const std::vector<Road>& roads, const RoadIndex& index)
+    : crossings_(roads.size())
+    , span_by_road_(roads.size()) {
+    for (size_t i = 0; i < roads.size(); ++i) {
+        const Box area = RoadArea(roads[i]);
+
+        // Полоса дороги выходит за её габарит не больше чем на
+        // ROAD_HALF_WIDTH, поэтому индекс ищется с таким запасом
+        const PointBG from{
+            bg::get<bg::min_corner, 0>(area) - ROAD_HALF_WIDTH,
+            bg::get<bg::min_corner, 1>(area) - ROAD_HALF_WIDTH};
+        const PointBG to{
+            bg::get<bg::max_corner, 0>(area) + ROAD_HALF_WIDTH,
+            bg::get<bg::max_corner, 1>(area) + ROAD_HALF_WIDTH};
+
+        index.ForEachRoadOnPath(from, to, [&](size_t j) {
+            if (j == i) {
+                return;
+            }
+            const Box other = RoadArea(roads[j]);
+            const double x0 = std::max(bg::get<bg::min_corner, 0>(area),
+                                       bg::get<bg::min_corner, 0>(other));
+            const double x1 = std::min(bg::get<bg::max_corner, 0>(area),
+                                       bg::get<bg::max_corner, 0>(other));
+            const double y0 = std::max(bg::get<bg::min_corner, 1>(area),
+                                       bg::get<bg::min_corner, 1>(other));
+            const double y1 = std::min(bg::get<bg::max_corner, 1>(area),
+                                       bg::get<bg::max_corner, 1>(other));
+            if (x0 <= x1 && y0 <= y1) {
+                crossings_[i].push_back({j, {(x0 + x1) / 2, (y0 + y1) / 2}});
+            }
+        });
+
+        std::sort(crossings_[i].begin(), crossings_[i].end(),
+            [](const Crossing& lhs, const Crossing& rhs) {
+                return lhs.road < rhs.road;
+            });
+    }
+
+    // Дороги нулевой длины считаются вертикальными, как в RoadIndex
+    std::vector<std::tuple<bool, Coord, double, double, size_t>> lines;
+    lines.reserve(roads.size());
+    for (size_t i = 0; i < roads.size(); ++i) {
+        const Box area = RoadArea(roads[i]);
+        const bool horizontal = !roads[i].IsVertical();
+        lines.emplace_back(
+            horizontal,
+            horizontal ? roads[i].GetStart().y : roads[i].GetStart().x,
+            horizontal ? bg::get<bg::min_corner, 0>(area)
+                       : bg::get<bg::min_corner, 1>(area),
+            horizontal ? bg::get<bg::max_corner, 0>(area)
+                       : bg::get<bg::max_corner, 1>(area),
+            i);
+    }
+    std::sort(lines.begin(), lines.end());
+
+    for (const auto& [horizontal, coord, begin, end, road] : lines) {
+        if (spans_.empty() || spans_.back().horizontal != horizontal ||
+            spans_.back().coord != coord || spans_.back().end < begin)
+        {
+            spans_.push_back(Span{horizontal, coord, begin, end, {}});
+        }
+        Span& span = spans_.back();
+        span.end = std::max(span.end, end);
+        span.roads.push_back(road);
+        span_by_road_[road] = spans_.size() - 1;
+    }
+}
+
+const std::vector<RoadGraph::Crossing>& RoadGraph::GetCrossings(
+    size_t road) const
+{
+    return crossings_.at(road);
+}
+
+size_t RoadGraph::GetSpanIndex(size_t road) const {
+    return span_by_road_.at(road);
+}
+
+const std::vector<RoadGraph::Span>& RoadGraph::GetSpans() const noexcept {
+    return spans_;
+}
+
 Map::Map(Id id, std::string name) noexcept
     : id_(std::move(id))
     , name_(std::move(name)) {
@@ -150,6 +458,14 @@ std::uint32_t Map::GetBagCapacity() const {
     return bag_capacity_;
 }
 
+void Map::SetViewRadius(double view_radius) {
+    view_radius_ = view_radius;
+}
+
+double Map::GetViewRadius() const {
+    return view_radius_;
+}
+
 const Map::Id& Map::GetId() const noexcept {
     return id_;
 }
@@ -177,6 +493,27 @@ const Map::Offices& Map::GetOffices() const noexcept {
     return offices_;
 }
 
+void Map::BuildOfficeIndex() {
+    std::vector<collision_detector::Item> items;
+    items.reserve(offices_.size());
+    for (size_t i = 0; i < offices_.size(); ++i) {
+        const Office& office = offices_[i];
+        items.push_back({
+            {static_cast<double>(office.GetPosition().x),
+             static_cast<double>(office.GetPosition().y)},
+            office.GetWidth(),
+            static_cast<std::uint32_t>(i),
+            collision_detector::ItemType::OFFICE
+        });
+    }
+    office_index_ = collision_detector::ItemIndex{
+        items, std::max(OFFICE_GRID_CELL_SIZE, 2 * OFFICE_WIDTH)};
+}
+
+const collision_detector::ItemIndex& Map::GetOfficeIndex() const noexcept {
+    return office_index_;
+}
+
 void Map::AddRoad(const Road& road) {
     roads_.emplace_back(road);
 }
@@ -185,46 +522,71 @@ const Map::Roads& Map::GetRoads() const noexcept {
     return roads_;
 }
 
-void Map::BuildRoadRTree() {
-    for (const Road& road : roads_) {
-        road_rtree_.insert(std::make_pair(
-            road.GetBoundingBox(),
-            road
-        ));
-    }
+void Map::BuildRoadIndex() {
+    road_index_ = RoadIndex{roads_};
 }
 
-Map::RoadRTree Map::GetRoadRTree() const {
-    return road_rtree_;
+const RoadIndex& Map::GetRoadIndex() const noexcept {
+    return road_index_;
 }
 
-Point Map::GetRandomPointOnRoad() const {
-    std::random_device rd;
-    static std::mt19937 gen(rd());
-    int number_of_roads = int(roads_.size()) - 1;
-    std::uniform_int_distribution<int> dist(0, number_of_roads);
-    auto& random_road = roads_[dist(gen)];
+void Map::BuildRoadGraph() {
+    road_graph_ = RoadGraph{roads_, road_index_};
+}
+
+const RoadGraph& Map::GetRoadGraph() const noexcept {
+    return road_graph_;
+}
 
-    int x1 = random_road.GetStart().x;
-    int y1 = random_road.GetStart().y;
-    int x2 = random_road.GetEnd().x;
-    int y2 = random_road.GetEnd().y;
-    if (x1 > x2) {
-        std::swap(x1, x2);
+void Map::BuildSpawnTable() {
+    std::vector<double> weights;
+    weights.reserve(roads_.size());
+    for (const auto& road : roads_) {
+        const Point start = road.GetStart();
+        const Point end = road.GetEnd();
+        weights.push_back(
+            std::abs(end.x - start.x) + std::abs(end.y - start.y) + 1.0);
     }
-    if (y1 > y2) {
-        std::swap(y1, y2);
+    spawn_table_ = util::AliasTable{weights};
+}
+
+Point Map::GetRandomPointOnRoad(std::mt19937_64& random) const {
+    if (spawn_table_.Empty()) {
+        throw std::logic_error("Map "s + *id_ + " has no roads to spawn on"s);
+    }
+    const Road& road = roads_[spawn_table_.Sample(random)];
+
+    const Point start = road.GetStart();
+    const Point end = road.GetEnd();
+    std::uniform_int_distribution<Coord> dist_x(
+        std::min(start.x, end.x), std::max(start.x, end.x));
+    std::uniform_int_distribution<Coord> dist_y(
+        std::min(start.y, end.y), std::max(start.y, end.y));
+
+    // У дороги меняется только одна координата
+    if (road.IsHorizontal()) {
+        return {dist_x(random), start.y};
     }
-    std::uniform_int_distribution<int> dist_x(x1, x2);
-    std::uniform_int_distribution<int> dist_y(y1, y2);
-    int random_x = dist_x(gen);
-    int random_y = dist_y(gen);
+    return {start.x, dist_y(random)};
+}
 
-    return {random_x, random_y};
+Point Map::GetRandomPointOnRoad() const {
+    return GetRandomPointOnRoad(ThreadRandom());
 }
 
 void Map::SetLootTypesCount(int loot_types_count) {
-    loot_types_count_ = loot_types_count;
+    loot_types_count_ = std::max(loot_types_count, 0);
+    if (loot_types_count_ > 0) {
+        loot_type_distribution_ =
+            std::uniform_int_distribution<int>{0, loot_types_count_ - 1};
+    }
+}
+
+int Map::GetRandomLootType(std::mt19937_64& random) const {
+    // Распределение не меняется при выборе, поэтому каждый вызов берёт
+    // свою копию и сессии разных потоков не мешают друг другу
+    auto distribution = loot_type_distribution_;
+    return distribution(random);
 }
 
 int Map::GetLootTypesCount() const {
@@ -243,130 +605,434 @@ std::uint32_t Map::GetLootValue(size_t index) const {
     }
 }
 
-std::uint32_t Dog::dog_counter_{0};
+DogStore::Handle DogStore::Insert(Record record) {
+    Handle handle;
+    if (!free_handles_.empty()) {
+        handle = free_handles_.back();
+        free_handles_.pop_back();
+    } else {
+        handle = static_cast<Handle>(index_by_handle_.size());
+        index_by_handle_.push_back(NO_INDEX);
+    }
+
+    index_by_handle_[handle] = static_cast<std::uint32_t>(Size());
+    handle_by_index_.push_back(handle);
+
+    hot_.x.push_back(record.position.x);
+    hot_.y.push_back(record.position.y);
+    hot_.speed_x.push_back(record.speed.x);
+    hot_.speed_y.push_back(record.speed.y);
+    hot_.direction.push_back(record.direction);
+    hot_.width.push_back(record.width);
+    hot_.idle_since.push_back(Now() - record.inactivity_time);
+    hot_.idle_token.push_back(0);
+    hot_.status.push_back(record.status);
+    hot_.road.push_back(record.road);
+    hot_.motion.emplace_back();
+    cold_.push_back(std::move(record.cold));
+
+    // Новая собака проходит хотя бы один тик перемещения
+    if (handle >= moving_pos_by_handle_.size()) {
+        moving_pos_by_handle_.resize(handle + 1, NO_INDEX);
+    }
+    moving_pos_by_handle_[handle] = static_cast<std::uint32_t>(moving_.size());
+    moving_.push_back(handle);
+
+    return handle;
+}
+
+DogStore::Record DogStore::Extract(Handle handle) {
+    const size_t index = IndexOf(handle);
+    Record record{
+        .position = {hot_.x[index], hot_.y[index]},
+        .speed = {hot_.speed_x[index], hot_.speed_y[index]},
+        .direction = hot_.direction[index],
+        .width = hot_.width[index],
+        .inactivity_time = InactivityTime(index),
+        .status = hot_.status[index],
+        .road = hot_.road[index],
+        .cold = std::move(cold_[index])};
+
+    // На место удаляемой собаки переносится последняя
+    const size_t last = Size() - 1;
+    auto remove = [index, last](auto& column) {
+        if (index != last) {
+            column[index] = std::move(column[last]);
+        }
+        column.pop_back();
+    };
+    remove(hot_.x);
+    remove(hot_.y);
+    remove(hot_.speed_x);
+    remove(hot_.speed_y);
+    remove(hot_.direction);
+    remove(hot_.width);
+    remove(hot_.idle_since);
+    remove(hot_.idle_token);
+    remove(hot_.status);
+    remove(hot_.road);
+    remove(hot_.motion);
+    remove(cold_);
+    remove(handle_by_index_);
+
+    if (index != last) {
+        index_by_handle_[handle_by_index_[index]] =
+            static_cast<std::uint32_t>(index);
+    }
+    index_by_handle_[handle] = NO_INDEX;
+    free_handles_.push_back(handle);
+    RemoveFromMoving(handle);
+
+    return record;
+}
+
+DogStore::Record DogStore::Get(Handle handle) const {
+    const size_t index = IndexOf(handle);
+    return Record{
+        .position = {hot_.x[index], hot_.y[index]},
+        .speed = {hot_.speed_x[index], hot_.speed_y[index]},
+        .direction = hot_.direction[index],
+        .width = hot_.width[index],
+        .inactivity_time = InactivityTime(index),
+        .status = hot_.status[index],
+        .road = hot_.road[index],
+        .cold = cold_[index]};
+}
+
+void DogStore::Assign(Handle handle, Record record) {
+    const size_t index = IndexOf(handle);
+    hot_.x[index] = record.position.x;
+    hot_.y[index] = record.position.y;
+    hot_.speed_x[index] = record.speed.x;
+    hot_.speed_y[index] = record.speed.y;
+    hot_.direction[index] = record.direction;
+    hot_.width[index] = record.width;
+    hot_.idle_since[index] = Now() - record.inactivity_time;
+    hot_.status[index] = record.status;
+    hot_.road[index] = record.road;
+    hot_.motion[index] = DogMotion{};
+    cold_[index] = std::move(record.cold);
+    Wake(index);
+}
+
+size_t DogStore::Size() const noexcept {
+    return handle_by_index_.size();
+}
+
+size_t DogStore::IndexOf(Handle handle) const {
+    if (handle >= index_by_handle_.size() ||
+        index_by_handle_[handle] == NO_INDEX)
+    {
+        throw std::out_of_range("Invalid dog handle");
+    }
+    return index_by_handle_[handle];
+}
+
+DogStore::Handle DogStore::HandleOf(size_t index) const {
+    return handle_by_index_.at(index);
+}
+
+bool DogStore::Contains(Handle handle) const noexcept {
+    return handle < index_by_handle_.size() &&
+           index_by_handle_[handle] != NO_INDEX;
+}
+
+DogStore::HotArrays& DogStore::Hot() noexcept {
+    return hot_;
+}
+
+const DogStore::HotArrays& DogStore::Hot() const noexcept {
+    return hot_;
+}
+
+DogStore::ColdRecord& DogStore::Cold(size_t index) {
+    return cold_.at(index);
+}
+
+const DogStore::ColdRecord& DogStore::Cold(size_t index) const {
+    return cold_.at(index);
+}
+
+double DogStore::Now() const noexcept {
+    return clock_ms_ / MS_IN_SECONDS;
+}
+
+std::int64_t DogStore::NowMs() const noexcept {
+    return clock_ms_;
+}
+
+void DogStore::AdvanceClock(std::int64_t time_delta_ms) noexcept {
+    clock_ms_ += time_delta_ms;
+}
+
+double DogStore::InactivityTime(size_t index) const {
+    return Now() - hot_.idle_since.at(index);
+}
+
+void DogStore::Wake(size_t index) {
+    hot_.idle_token.at(index) = 0;
+
+    const Handle handle = handle_by_index_[index];
+    if (moving_pos_by_handle_[handle] != NO_INDEX) {
+        return;
+    }
+    moving_pos_by_handle_[handle] = static_cast<std::uint32_t>(moving_.size());
+    moving_.push_back(handle);
+}
+
+std::uint64_t DogStore::Park(size_t index) {
+    std::uint64_t& token = hot_.idle_token.at(index);
+    RemoveFromMoving(handle_by_index_[index]);
+    token = next_idle_token_++;
+    return token;
+}
+
+std::optional<std::uint64_t> DogStore::Stall(size_t index) {
+    std::uint64_t& token = hot_.idle_token.at(index);
+    if (token != 0) {
+        return std::nullopt;
+    }
+    token = next_idle_token_++;
+    return token;
+}
+
+bool DogStore::IsParked(size_t index) const {
+    return moving_pos_by_handle_[handle_by_index_.at(index)] == NO_INDEX;
+}
+
+size_t DogStore::MovingCount() const noexcept {
+    return moving_.size();
+}
+
+std::pmr::vector<std::uint32_t> DogStore::MovingIndices(
+    std::pmr::memory_resource* resource) const
+{
+    std::pmr::vector<std::uint32_t> indices{resource};
+    indices.reserve(moving_.size());
+    for (Handle handle : moving_) {
+        indices.push_back(index_by_handle_[handle]);
+    }
+    std::sort(indices.begin(), indices.end());
+    return indices;
+}
+
+void DogStore::RemoveFromMoving(Handle handle) {
+    const std::uint32_t pos = moving_pos_by_handle_[handle];
+    if (pos == NO_INDEX) {
+        return;
+    }
+    moving_[pos] = moving_.back();
+    moving_pos_by_handle_[moving_[pos]] = pos;
+    moving_.pop_back();
+    moving_pos_by_handle_[handle] = NO_INDEX;
+}
+
+void DogStore::Integrate(
+    double dt,
+    std::span<const std::uint32_t> indices,
+    std::pmr::vector<double>& target_x,
+    std::pmr::vector<double>& target_y) const
+{
+    const size_t count = indices.size();
+    target_x.resize(count);
+    target_y.resize(count);
+
+    const double* x = hot_.x.data();
+    const double* y = hot_.y.data();
+    const double* speed_x = hot_.speed_x.data();
+    const double* speed_y = hot_.speed_y.data();
+    double* out_x = target_x.data();
+    double* out_y = target_y.data();
+
+    for (size_t k = 0; k < count; ++k) {
+        const std::uint32_t i = indices[k];
+        out_x[k] = x[i] + speed_x[i] * dt;
+        out_y[k] = y[i] + speed_y[i] * dt;
+    }
+}
 
 Dog::Dog(const std::string dog_name, geom::Point2D position)
-    : dog_name_(dog_name)
-    , position_(position) 
-    , id_(dog_counter_++)
-    , uuid_(util::detail::UUIDToString(util::detail::NewUUID())) {
+    : own_store_{std::make_unique<DogStore>()}
+    , store_{own_store_.get()} {
+    DogStore::Record record;
+    record.position = position;
+    record.cold.name = dog_name;
+    record.cold.uuid = util::detail::UUIDToString(util::detail::NewUUID());
+    handle_ = store_->Insert(std::move(record));
+}
+
+Dog::Dog(const Dog& other)
+    : own_store_{std::make_unique<DogStore>()}
+    , store_{own_store_.get()}
+    , handle_{store_->Insert(other.store_->Get(other.handle_))} {
+}
+
+Dog& Dog::operator=(const Dog& other) {
+    if (this != &other) {
+        store_->Assign(handle_, other.store_->Get(other.handle_));
+    }
+    return *this;
+}
+
+Dog::~Dog() {
+    if (!own_store_) {
+        store_->Extract(handle_);
+    }
+}
+
+void Dog::AttachTo(DogStore& store) {
+    if (store_ == &store) {
+        return;
+    }
+    handle_ = store.Insert(store_->Extract(handle_));
+    store_ = &store;
+    own_store_.reset();
+}
+
+void Dog::Detach() {
+    if (own_store_) {
+        return;
+    }
+    auto own_store = std::make_unique<DogStore>();
+    handle_ = own_store->Insert(store_->Extract(handle_));
+    own_store_ = std::move(own_store);
+    store_ = own_store_.get();
+}
+
+size_t Dog::Index() const {
+    return store_->IndexOf(handle_);
 }
 
 void Dog::SetDirection(const DIRECTION& new_direction) {
-    direction_ = new_direction;
+    const size_t index = Index();
+    store_->Hot().direction[index] = new_direction;
+    store_->Wake(index);
 }
 
 DIRECTION Dog::GetDirection() const {
-    return direction_;
+    return store_->Hot().direction[Index()];
 }
 
 const std::string Dog::GetName() const {
-    return dog_name_;
+    return store_->Cold(Index()).name;
 }
 
 void Dog::SetPosition(geom::Point2D position) {
-    position_ = position;
+    const size_t index = Index();
+    store_->Hot().x[index] = position.x;
+    store_->Hot().y[index] = position.y;
+    store_->Wake(index);
 }
 
 geom::Point2D Dog::GetPosition() const {
-    return position_;
+    const size_t index = Index();
+    return {store_->Hot().x[index], store_->Hot().y[index]};
 }
 
 void Dog::SetSpeed(const geom::Vec2D& new_speed) {
-    speed_ = new_speed;
+    const size_t index = Index();
+    store_->Hot().speed_x[index] = new_speed.x;
+    store_->Hot().speed_y[index] = new_speed.y;
+    store_->Wake(index);
 }
 
 geom::Vec2D Dog::GetSpeed() const {
-    return speed_;
+    const size_t index = Index();
+    return {store_->Hot().speed_x[index], store_->Hot().speed_y[index]};
 }
 
 void Dog::SetWidth(double width) {
-    width_ = width;
+    store_->Hot().width[Index()] = width;
 }
 
 double Dog::GetWidth() const {
-    return width_;
+    return store_->Hot().width[Index()];
 }
 
 void Dog::SetId(std::uint32_t id) {
-    id_ = id;
+    store_->Cold(Index()).id = id;
 }
 
 std::uint32_t Dog::GetId() const {
-    return id_;
+    return store_->Cold(Index()).id;
 }
 
 void Dog::AddLoot(std::shared_ptr<Loot> loot) {
-    bag_.emplace_back(loot);
+    store_->Cold(Index()).bag.emplace_back(loot);
 }
 
-const std::vector<std::shared_ptr<Loot>>& Dog::GetLoot() const {
-    return bag_;
+const LootBag& Dog::GetLoot() const {
+    return store_->Cold(Index()).bag;
 }
 
 std::uint32_t Dog::GetLootCountInBag() const {
-    return bag_.size();
+    return store_->Cold(Index()).bag.size();
 }
 
 void Dog::ReleaseLoot() {
-    for (auto item : bag_) {
-        score_ += item->GetValue();
+    auto& cold = store_->Cold(Index());
+    for (auto item : cold.bag) {
+        cold.score += item->GetValue();
     }
-    bag_.clear();
+    cold.bag.clear();
 }
 
 void Dog::SetScore(std::uint32_t score) {
-    score_ = score;
+    store_->Cold(Index()).score = score;
 }
 
 std::uint32_t Dog::GetScore() const {
-    return score_;
-}
-
-std::uint32_t Dog::GetDogCounter() {
-    return dog_counter_;
-}
-
-void Dog::SetDogCounter(std::uint32_t counter) {
-    dog_counter_ = counter;
+    return store_->Cold(Index()).score;
 }
 
 void Dog::SetJoinTime(std::chrono::milliseconds join_time) {
-    join_time_ = join_time;
+    store_->Cold(Index()).join_time = join_time;
 }
 std::chrono::milliseconds Dog::GetJoinTime() const {
-    return join_time_;
+    return store_->Cold(Index()).join_time;
 }
 
 void Dog::SetStatus(DOG_STATUS status) {
-    status_ = status;
+    store_->Hot().status[Index()] = status;
 }
 
 Dog::DOG_STATUS Dog::GetStatus() const {
-    return status_;
+    return store_->Hot().status[Index()];
 }
 
+// Срок ухода на покой ставится при парковке, поэтому после изменения
+// простоя собака паркуется заново
 void Dog::UpdateInactivityTime(double delta) {
-    inactivity_time_ += delta;
+    const size_t index = Index();
+    store_->Hot().idle_since[index] -= delta;
+    store_->Wake(index);
 }
 
 void Dog::ResetInactivityTimer() {
-    inactivity_time_ = 0.0;
+    const size_t index = Index();
+    store_->Hot().idle_since[index] = store_->Now();
+    store_->Wake(index);
 }
 
 double Dog::GetInactivityTime() const {
-    return inactivity_time_;
+    return store_->InactivityTime(Index());
 }
 
 void Dog::SetUUID(const std::string& uuid) {
-    uuid_ = uuid;
+    store_->Cold(Index()).uuid = uuid;
 }
 
 std::string Dog::GetUUID() {
-    return uuid_;
+    return store_->Cold(Index()).uuid;
 }
 
-std::uint32_t Loot::loot_counter_{0};
+void Dog::SetRoad(std::optional<size_t> road) {
+    store_->Hot().road[Index()] = road;
+}
+
+std::optional<size_t> Dog::GetRoad() const {
+    return store_->Hot().road[Index()];
+}
 
 Loot::Loot(
     const std::uint32_t type,
@@ -375,8 +1041,7 @@ Loot::Loot(
 )
     : type_(type)
     , position_(position)
-    , value_(loot_value)
-    , id_(loot_counter_++) {
+    , value_(loot_value) {
 }
 
 std::uint32_t Loot::GetType() const {
@@ -391,6 +1056,14 @@ void Loot::SetId(std::uint32_t id) {
     id_ = id;
 }
 
+LootKey Loot::GetKey() const {
+    return key_;
+}
+
+void Loot::SetKey(LootKey key) {
+    key_ = key;
+}
+
 geom::Point2D Loot::GetPosition() const {
     return position_;
 }
@@ -407,19 +1080,23 @@ std::uint32_t Loot::GetValue() const {
     return value_;
 }
 
-std::uint32_t Loot::GetLootCounter() {
-    return loot_counter_;
-}
-
-void Loot::SetLootCounter(std::uint32_t counter) {
-    loot_counter_ = counter;
+GameSession::GameSession(
+    const Map* map,
+    std::uint32_t id,
+    size_t loot_pool_capacity)
+    : map_(map)
+    , dog_store_(std::make_unique<DogStore>())
+    , loot_pool_(std::make_shared<util::PoolResource>(
+        util::PoolResource::BytesFor<Loot>(loot_pool_capacity)))
+    , session_id_(id)
+    , random_(ThreadRandom()()) {
 }
 
-std::uint32_t GameSession::session_counter_{0};
-
-GameSession::GameSession(const Map* map)
-    : map_(map)
-    , session_id_(session_counter_++) {
+GameSession::~GameSession() {
+    // Собаки могут пережить сессию, например в объектах игроков
+    for (auto& dog : dogs_) {
+        dog->Detach();
+    }
 }
 
 void GameSession::SetId(std::uint32_t id) {
@@ -430,7 +1107,11 @@ std::uint32_t GameSession::GetId() const {
 }
 
 void GameSession::AddDog(std::shared_ptr<model::Dog> dog) {
+    dog->AttachTo(*dog_store_);
+    dog_store_->Cold(dog_store_->Size() - 1).bag.reserve(
+        map_->GetBagCapacity());
     dogs_.push_back(dog);
+    ++roster_version_;
 }
 
 std::vector<std::shared_ptr<Dog>>& GameSession::GetDogs() {
@@ -441,6 +1122,10 @@ const std::vector<std::shared_ptr<Dog>>& GameSession::GetDogs() const {
     return dogs_;
 }
 
+DogStore& GameSession::GetDogStore() {
+    return *dog_store_;
+}
+
 std::shared_ptr<Dog> GameSession::GetDogById(std::uint32_t dog_id) const {
     auto it = std::find_if(dogs_.begin(), dogs_.end(), 
     [dog_id](const std::shared_ptr<Dog>& dog_ptr) {
@@ -454,57 +1139,345 @@ std::shared_ptr<Dog> GameSession::GetDogById(std::uint32_t dog_id) const {
     return nullptr;
 }
 
+std::shared_ptr<Loot> GameSession::MakeLoot(
+    std::uint32_t type,
+    geom::Point2D position,
+    std::uint32_t value)
+{
+    return util::MakePooled<Loot>(loot_pool_, type, position, value);
+}
+
 void GameSession::AddLoot(std::shared_ptr<model::Loot> loot) {
-    loot_.emplace_back(loot);
+    Loot& added = *loot;
+    added.SetKey(loot_.Insert(std::move(loot)));
 }
 
-std::list<std::shared_ptr<Loot>> GameSession::GetLoot() const {
-    return loot_;
+std::span<const std::shared_ptr<Loot>> GameSession::GetLoot() const {
+    return loot_.Values();
 }
 
 const Map* GameSession::GetMap() const {
     return map_;
 }
 
-std::shared_ptr<Loot> GameSession::GatherLoot(size_t loot_id) {
-    auto it = std::find_if(loot_.begin(), loot_.end(), 
-    [loot_id](const std::shared_ptr<Loot>& loot) {
-        return loot->GetId() == loot_id;
+std::shared_ptr<Loot> GameSession::FindLoot(LootKey key) const {
+    const auto* loot = loot_.Find(key);
+    return loot ? *loot : nullptr;
+}
+
+std::shared_ptr<Loot> GameSession::GatherLoot(LootKey key) {
+    if (!loot_.Contains(key)) {
+        throw std::invalid_argument("Loot not found"s);
+    }
+
+    return loot_.Erase(key);
+}
+
+std::uint32_t GameSession::NextDogId() {
+    return dog_counter_++;
+}
+
+std::uint32_t GameSession::GetDogCounter() const {
+    return dog_counter_;
+}
+
+void GameSession::SetDogCounter(std::uint32_t counter) {
+    dog_counter_ = counter;
+}
+
+std::uint32_t GameSession::NextLootId() {
+    return loot_counter_++;
+}
+
+std::uint32_t GameSession::GetLootCounter() const {
+    return loot_counter_;
+}
+
+void GameSession::SetLootCounter(std::uint32_t counter) {
+    loot_counter_ = counter;
+}
+
+void GameSession::SetLootGenerator(loot_gen::LootGenerator generator) {
+    loot_generator_.emplace(std::move(generator));
+}
+
+loot_gen::LootGenerator& GameSession::GetLootGenerator() {
+    if (loot_generator_) {
+        return *loot_generator_;
+    }
+    throw std::runtime_error("Loot generator is not set");
+}
+
+void GameSession::RemoveDog(std::uint32_t dog_id) {
+    auto it = std::find_if(
+            dogs_.begin(), 
+            dogs_.end(),
+            [dog_id](const std::shared_ptr<Dog>& dog) {
+                return dog && dog->GetId() == dog_id;
+            }
+        );
+
+        if (it != dogs_.end()) {
+            // Хранилище переносит на место собаки последнюю запись,
+            // и список собак повторяет это перемещение
+            (*it)->Detach();
+            *it = std::move(dogs_.back());
+            dogs_.pop_back();
+            ++roster_version_;
+        }
+}
+
+void GameSession::EnqueueCommand(DogCommand command) {
+    pending_commands_.Push(command);
+}
+
+std::pmr::vector<std::uint32_t> GameSession::ApplyPendingCommands(
+    std::pmr::memory_resource* resource)
+{
+    std::pmr::vector<std::uint32_t> commanded_dogs{resource};
+    if (pending_commands_.Empty()) {
+        return commanded_dogs;
+    }
+
+    std::pmr::unordered_map<std::uint32_t, DIRECTION> last_commands{
+        resource};
+    pending_commands_.DrainNewestFirst([&last_commands](DogCommand&& command) {
+        last_commands.emplace(command.dog_id, command.direction);
+    });
+
+    const double speed = map_->GetDogSpeed();
+
+    for (auto& dog : dogs_) {
+        auto it = last_commands.find(dog->GetId());
+        if (it == last_commands.end()) {
+            continue;
+        }
+
+        switch (it->second) {
+            case DIRECTION::NORTH:
+                dog->SetSpeed({0, -speed});
+                break;
+            case DIRECTION::SOUTH:
+                dog->SetSpeed({0, speed});
+                break;
+            case DIRECTION::WEST:
+                dog->SetSpeed({-speed, 0});
+                break;
+            case DIRECTION::EAST:
+                dog->SetSpeed({speed, 0});
+                break;
+            case DIRECTION::NONE:
+                dog->SetSpeed({0, 0});
+                break;
+        }
+        dog->SetDirection(it->second);
+        dog->SetStatus(Dog::DOG_STATUS::ACTIVE);
+        dog->ResetInactivityTimer();
+        commanded_dogs.push_back(dog->GetId());
+    }
+
+    return commanded_dogs;
+}
+
+SessionKinematics& GameSession::GetKinematics() {
+    return kinematics_;
+}
+
+RetirementWheel& GameSession::GetRetirementWheel() {
+    return retirement_wheel_;
+}
+
+std::mt19937_64& GameSession::GetRandom() {
+    return random_;
+}
+
+void SessionKinematics::Schedule(KinematicEvent event) {
+    event.seq = next_seq++;
+    events.push(event);
+}
+
+std::optional<SessionSnapshot::Visible> SessionSnapshot::FindVisible(
+    std::uint32_t player_id) const
+{
+    const auto& index = entity_index_.Get([this] {
+        EntityIndex result;
+        std::vector<EntityRTree::value_type> entities;
+        entities.reserve(dogs.size() + loot.size());
+
+        for (size_t i = 0; i < dogs.size(); ++i) {
+            entities.push_back({
+                PointBG{dogs[i].position.x, dogs[i].position.y},
+                {EntityKind::DOG, i}});
+            result.dog_by_player.emplace(dogs[i].player_id, i);
+        }
+        for (size_t i = 0; i < loot.size(); ++i) {
+            entities.push_back({
+                PointBG{loot[i].position.x, loot[i].position.y},
+                {EntityKind::LOOT, i}});
+        }
+
+        // Пакетная загрузка строит дерево лучше, чем вставка по одному
+        result.entities = EntityRTree(entities.begin(), entities.end());
+        return result;
     });
 
-    if (it == loot_.end()) {
-        throw std::invalid_argument("Loot with id "s + std::to_string(loot_id) +
-            " not found"s);
+    auto it = index.dog_by_player.find(player_id);
+    if (it == index.dog_by_player.end()) {
+        return std::nullopt;
+    }
+
+    const geom::Point2D center = dogs[it->second].position;
+    const PointBG center_bg{center.x, center.y};
+    const Box area{
+        PointBG{center.x - view_radius, center.y - view_radius},
+        PointBG{center.x + view_radius, center.y + view_radius}};
+
+    Visible visible;
+    index.entities.query(
+        bgi::intersects(area) &&
+        bgi::satisfies([&](const EntityRTree::value_type& entity) {
+            return bg::comparable_distance(entity.first, center_bg) <=
+                   view_radius * view_radius;
+        }),
+        boost::make_function_output_iterator(
+            [&visible](const EntityRTree::value_type& entity) {
+                auto [kind, index] = entity.second;
+                if (kind == EntityKind::DOG) {
+                    visible.dogs.push_back(index);
+                } else {
+                    visible.loot.push_back(index);
+                }
+            }));
+
+    // Порядок объектов в ответе не зависит от устройства индекса
+    std::sort(visible.dogs.begin(), visible.dogs.end());
+    std::sort(visible.loot.begin(), visible.loot.end());
+    return visible;
+}
+
+bool SessionSnapshot::HasHistorySince(std::uint64_t since) const {
+    return history_start <= since && since <= tick;
+}
+
+void GameSession::PublishSnapshot(
+    const PlayerIdByDog& player_ids,
+    std::uint64_t tick,
+    std::uint64_t change_tick)
+{
+    auto previous = GetSnapshot();
+    auto snapshot = std::make_shared<SessionSnapshot>();
+    snapshot->tick = tick;
+    snapshot->view_radius = map_->GetViewRadius();
+    snapshot->dogs.reserve(dogs_.size());
+    snapshot->loot.reserve(loot_.Size());
+
+    if (!first_published_tick_) {
+        first_published_tick_ = tick;
     }
+    snapshot->history_start = std::max(*first_published_tick_,
+        tick > STATE_HISTORY_TICKS ? tick - STATE_HISTORY_TICKS : 0);
+
+    // Объект считается изменённым, если его нет в предыдущем снимке
+    // или его состояние отличается от сохранённого там
+    std::unordered_map<std::uint32_t, const SessionSnapshot::DogState*>
+        previous_dogs;
+    std::unordered_map<std::uint32_t, const SessionSnapshot::LootState*>
+        previous_loot;
+    if (previous) {
+        previous_dogs.reserve(previous->dogs.size());
+        for (const auto& dog : previous->dogs) {
+            previous_dogs.emplace(dog.player_id, &dog);
+        }
+        previous_loot.reserve(previous->loot.size());
+        for (const auto& item : previous->loot) {
+            previous_loot.emplace(item.id, &item);
+        }
+    }
+
+    for (const auto& dog : dogs_) {
+        auto it = player_ids.find(dog->GetId());
+        if (it == player_ids.end()) {
+            continue;
+        }
 
-    std::shared_ptr<Loot> result = *it;
+        SessionSnapshot::DogState dog_state{
+            .player_id = it->second,
+            .name = dog->GetName(),
+            .position = dog->GetPosition(),
+            .speed = dog->GetSpeed(),
+            .direction = dog->GetDirection(),
+            .bag = {},
+            .score = dog->GetScore(),
+            .changed_tick = change_tick};
+
+        dog_state.bag.reserve(dog->GetLoot().size());
+        for (const auto& item : dog->GetLoot()) {
+            dog_state.bag.push_back(
+                {item->GetId(), item->GetType(), item->GetPosition()});
+        }
+
+        auto prev = previous_dogs.find(dog_state.player_id);
+        if (prev != previous_dogs.end()) {
+            if (IsSameDogState(*prev->second, dog_state)) {
+                dog_state.changed_tick = prev->second->changed_tick;
+            }
+            previous_dogs.erase(prev);
+        }
+        snapshot->dogs.push_back(std::move(dog_state));
+    }
+
+    for (const auto& item : loot_.Values()) {
+        SessionSnapshot::LootState loot_state{
+            item->GetId(), item->GetType(), item->GetPosition(), change_tick};
+
+        auto prev = previous_loot.find(loot_state.id);
+        if (prev != previous_loot.end()) {
+            loot_state.changed_tick = prev->second->changed_tick;
+            previous_loot.erase(prev);
+        }
+        snapshot->loot.push_back(loot_state);
+    }
 
-    loot_.erase(it);
+    // В предыдущем снимке остались только исчезнувшие объекты
+    snapshot->removed_players = UpdateRemovals(
+        previous ? previous->removed_players : nullptr,
+        previous_dogs, change_tick, snapshot->history_start);
+    snapshot->removed_loot = UpdateRemovals(
+        previous ? previous->removed_loot : nullptr,
+        previous_loot, change_tick, snapshot->history_start);
+
+    snapshot->roster_version = roster_version_;
+    // Игрок регистрируется после добавления собаки, поэтому при той же
+    // версии состав мог пополниться
+    if (previous && previous->roster_version == roster_version_ &&
+        previous->dogs.size() == snapshot->dogs.size())
+    {
+        snapshot->roster_body = previous->roster_body;
+    } else {
+        snapshot->roster_body =
+            std::make_shared<const SessionSnapshot::EncodedBody>();
+    }
 
-    return result;
+    std::atomic_store_explicit(
+        &snapshot_,
+        std::shared_ptr<const SessionSnapshot>(std::move(snapshot)),
+        std::memory_order_release);
 }
 
-std::uint32_t GameSession::GetSessionCounter() {
-    return session_counter_;
+std::shared_ptr<const SessionSnapshot> GameSession::GetSnapshot() const {
+    return std::atomic_load_explicit(&snapshot_, std::memory_order_acquire);
 }
 
-void GameSession::SetSessionCounter(std::uint32_t counter) {
-    session_counter_ = counter;
+Game::Game()
+    : players_(std::make_unique<app::Players>()) {
+    SetPoolCapacity(DEFAULT_PLAYER_POOL_CAPACITY, DEFAULT_LOOT_POOL_CAPACITY);
 }
 
-void GameSession::RemoveDog(std::uint32_t dog_id) {
-    auto it = std::find_if(
-            dogs_.begin(), 
-            dogs_.end(),
-            [dog_id](const std::shared_ptr<Dog>& dog) {
-                return dog && dog->GetId() == dog_id;
-            }
-        );
+Game::Game(Game&&) noexcept = default;
 
-        if (it != dogs_.end()) {
-            dogs_.erase(it);
-        }
-}
+Game& Game::operator=(Game&&) noexcept = default;
+
+Game::~Game() = default;
 
 void Game::AddMap(Map map) {
     const size_t index = maps_.size();
@@ -515,7 +1488,10 @@ void Game::AddMap(Map map) {
                                     " already exists"s);
     } else {
         try {
-            map.BuildRoadRTree();
+            map.BuildRoadIndex();
+            map.BuildRoadGraph();
+            map.BuildOfficeIndex();
+            map.BuildSpawnTable();
             maps_.emplace_back(std::move(map));
         } catch (...) {
             map_id_to_index_.erase(it);
@@ -549,6 +1525,14 @@ std::shared_ptr<GameSession> Game::FindSessionById(
     return nullptr;
 }
 
+app::Players& Game::GetPlayers() {
+    return *players_;
+}
+
+const app::Players& Game::GetPlayers() const {
+    return *players_;
+}
+
 void Game::SetGameMode(bool test_mode) {
     if (test_mode) {
         game_mode_ = TEST;
@@ -569,6 +1553,14 @@ void Game::SetDogSpawnMode(bool random_spawn) {
     }
 }
 
+void Game::SetKinematicsMode(bool analytic) {
+    kinematics_mode_ = analytic ? ANALYTIC : FIXED_STEP;
+}
+
+Game::KINEMATICS_MODE Game::GetKinematicsMode() const {
+    return kinematics_mode_;
+}
+
 Game::SPAWN_MODE Game::GetDogSpawnMode() const {
     return dog_spawn_mode_;
 }
@@ -578,17 +1570,50 @@ void Game::SetSaveFilePath(const std::string& path) {
     save_file_path_ = path;
 }
 
+void Game::SetStateFormat(serialization::StateFormat format) {
+    // Писатель создаётся заново при следующем сохранении
+    state_writer_.reset();
+    state_format_ = format;
+}
+
+serialization::StateFormat Game::GetStateFormat() const {
+    return state_format_;
+}
+
+void Game::SetPoolCapacity(size_t players, size_t loot_per_session) {
+    player_pool_ = std::make_shared<util::PoolResource>(
+        util::PoolResource::BytesFor<Dog>(players) +
+        util::PoolResource::BytesFor<app::Player>(players));
+    players_->SetPool(player_pool_);
+    loot_pool_capacity_ = loot_per_session;
+}
+
+size_t Game::GetLootPoolCapacity() const {
+    return loot_pool_capacity_;
+}
+
+std::shared_ptr<Dog> Game::MakeDog(
+    const std::string& name,
+    geom::Point2D position)
+{
+    return util::MakePooled<Dog>(player_pool_, name, position);
+}
+
 std::shared_ptr<GameSession> Game::AddDogToSession(
     std::shared_ptr<model::Dog> dog,
     const model::Map::Id& map_id)
 {
     if (!sessions_.contains(map_id)) {
-        auto session_ptr = std::make_shared<GameSession>(FindMap(map_id));
+        auto session_ptr = std::make_shared<GameSession>(
+            FindMap(map_id), session_counter_++, loot_pool_capacity_);
+        session_ptr->SetLootGenerator(GetLootGenerator());
         sessions_[map_id] = session_ptr;
     }
 
-    sessions_[map_id]->AddDog(dog);
-    return sessions_[map_id];
+    auto& session = sessions_[map_id];
+    dog->SetId(session->NextDogId());
+    session->AddDog(dog);
+    return session;
 }
 
 void Game::SetLootGenerator(std::unique_ptr<loot_gen::LootGenerator> generator)
@@ -628,187 +1653,297 @@ void Game::SetSavePeriod(int64_t period) {
     save_enabled_ = true;
 }
 
+void Game::SetTickExecutor(TaskRunner runner, unsigned concurrency) {
+    tick_runner_ = std::move(runner);
+    tick_concurrency_ = concurrency;
+}
+
+void Game::SetTickListener(TickListener listener) {
+    tick_listener_ = std::move(listener);
+}
+
+void Game::SetFixedTimestep(std::int64_t step, unsigned max_substeps) {
+    if (step <= 0 || max_substeps == 0) {
+        throw std::invalid_argument("Invalid fixed timestep");
+    }
+    fixed_step_ = step;
+    max_substeps_ = max_substeps;
+    pending_step_time_ = 0;
+}
+
+std::optional<std::int64_t> Game::GetFixedTimestep() const {
+    return fixed_step_;
+}
+
 void Game::Update(std::int64_t time_delta) {
-    try {
-        for (auto& session : sessions_) {
-            collision_detector::GathererProvider gatherer_provider;
+    if (!fixed_step_) {
+        RunTick(time_delta, 1);
+        return;
+    }
+
+    const std::int64_t step = *fixed_step_;
+    pending_step_time_ += time_delta;
+    std::uint64_t substeps = pending_step_time_ / step;
+    if (substeps > max_substeps_) {
+        // Отставание сверх предела не догоняется: иначе медленный тик
+        // порождал бы ещё более медленные
+        substeps = max_substeps_;
+        pending_step_time_ %= step;
+    } else {
+        pending_step_time_ -= substeps * step;
+    }
+    if (substeps > 0) {
+        RunTick(step, substeps);
+    }
+}
+
+void Game::FastForward(std::int64_t time_delta) {
+    if (!fixed_step_) {
+        RunTick(time_delta, 1);
+        return;
+    }
 
-            UpdateDogsPosition(session.second, time_delta, gatherer_provider);
-            UpdateLoot(session.second, time_delta);
+    const std::int64_t step = *fixed_step_;
+    pending_step_time_ += time_delta;
+    const std::uint64_t substeps = pending_step_time_ / step;
+    pending_step_time_ -= substeps * step;
+    if (substeps > 0) {
+        RunTick(step, substeps);
+    }
+}
 
-            AddLootToGathererProvider(session.second, gatherer_provider);
-            AddOfficesToGathererProvider(session.second, gatherer_provider);
+void Game::RunTick(std::int64_t step, std::uint64_t substeps) {
+    try {
+        // Служебные данные тика размещаются в арене вызывающего потока.
+        // Сессия, обновляемая в этом же потоке, открывает в ней вложенную
+        // область и не затирает их
+        util::FrameArena& frame = util::FrameArena::ForThisThread();
+        util::FrameArena::Scope frame_scope{frame};
+
+        std::pmr::vector<std::shared_ptr<GameSession>> sessions{&frame};
+        sessions.reserve(sessions_.size());
+        for (auto& [map_id, session] : sessions_) {
+            sessions.push_back(session);
+        }
 
-            GatherLoot(session.second, std::move(gatherer_provider));
+        // Сессии не разделяют изменяемого состояния, поэтому обновляются
+        // параллельно. Общие для всех сессий данные (игроки, сохранение)
+        // изменяются только после того, как обновятся все сессии
+        auto player_ids_by_session = players_->GetPlayerIdsBySession(&frame);
+        std::pmr::vector<GameSession::PlayerIdByDog> player_ids{&frame};
+        player_ids.reserve(sessions.size());
+        for (const auto& session : sessions) {
+            player_ids.push_back(
+                std::move(player_ids_by_session[session->GetId()]));
+        }
 
-            RemoveInactiveDogs(session.second);
+        const std::uint64_t tick = ++tick_;
+
+        // Пустой вектор не обращается к куче, поэтому память выделяется,
+        // только если какая-то собака ушла на покой
+        std::pmr::vector<std::vector<std::uint32_t>> retired_dogs(
+            sessions.size(), &frame);
+        RunInParallel(sessions.size(), tick_runner_, tick_concurrency_,
+            [&](size_t i) {
+                retired_dogs[i] = UpdateSession(
+                    sessions[i], step, substeps, tick, player_ids[i]);
+            });
+
+        for (size_t i = 0; i < sessions.size(); ++i) {
+            for (std::uint32_t dog_id : retired_dogs[i]) {
+                players_->RemovePlayerFromGameByDogId(
+                    sessions[i]->GetId(), dog_id);
+            }
         }
 
-        save_test_timer_ += std::chrono::milliseconds(time_delta);
+        save_test_timer_ += std::chrono::milliseconds(step * substeps);
 
         if (save_enabled_ && save_test_timer_ >= save_interval_) {
-            SaveState();
+            if (!state_writer_) {
+                state_writer_ = std::make_unique<serialization::StateWriter>(
+                    save_file_path_, GetStateFormat());
+            }
+            state_writer_->Submit(CaptureState());
             save_test_timer_ = std::chrono::milliseconds(0);
         }
+
+        if (tick_listener_) {
+            tick_listener_(tick);
+        }
     } catch (const std::exception& e) {
-        std::cerr << "Error in Game::Update: " << e.what() << std::endl;
+        std::cerr << "Error in Game::RunTick: " << e.what() << std::endl;
         throw;
     }
 }
 
-void Game::SaveState() const {
-    fs::path final_save_path(save_file_path_);
-    fs::path temp_save_path;
-
-    if (!final_save_path.parent_path().empty() &&
-        !fs::exists(final_save_path.parent_path()))
-    {
-        try {
-            fs::create_directories(final_save_path.parent_path());
-        }
-        catch (const fs::filesystem_error& e) {
-            std::cerr << "Failed to create directory: " << e.what() << "\n";
-            throw;
-        }
-    }
+std::uint64_t Game::GetTick() const {
+    return tick_;
+}
 
-    try {
-        temp_save_path = final_save_path.parent_path() / 
-                        (final_save_path.filename().string() + ".tmp");
-    }
-    catch (const fs::filesystem_error&) {
-        temp_save_path = final_save_path.string() + ".tmp";
+std::vector<std::uint32_t> Game::UpdateSession(
+    std::shared_ptr<GameSession>& session,
+    std::int64_t step,
+    std::uint64_t substeps,
+    std::uint64_t tick,
+    const GameSession::PlayerIdByDog& player_ids)
+{
+    auto retired_dogs = Simulate(session, step);
+    for (std::uint64_t i = 1; i < substeps; ++i) {
+        auto retired = Simulate(session, step);
+        retired_dogs.insert(retired_dogs.end(), retired.begin(), retired.end());
     }
+    session->PublishSnapshot(player_ids, tick, tick);
 
-    try {
-        std::ofstream ofs(temp_save_path, std::ios::binary | std::ios::trunc);
-        if (!ofs.is_open()) {
-            throw std::runtime_error("Cannot open temporary file for writing: "
-                                     + temp_save_path.string());
-        }
+    return retired_dogs;
+}
 
-        boost::archive::text_oarchive oa{ofs};
+std::vector<std::uint32_t> Game::Simulate(
+    std::shared_ptr<GameSession>& session,
+    std::int64_t time_delta)
+{
+    util::FrameArena& frame = util::FrameArena::ForThisThread();
+    util::FrameArena::Scope frame_scope{frame};
 
-        oa << std::string("sessions");
+    DogStore& dogs = session->GetDogStore();
+    auto commanded_dogs = session->ApplyPendingCommands(&frame);
+    dogs.AdvanceClock(time_delta);
 
-        size_t sessions_count = sessions_.size();
-        oa << sessions_count;
+    // Припаркованные собаки стоят до команды, а лут появляется, только
+    // когда его меньше, чем собак. Генератор лута лишь учитывает время
+    if (dogs.MovingCount() == 0 &&
+        session->GetLoot().size() >= session->GetDogs().size())
+    {
+        UpdateLoot(session, time_delta, &frame);
+        session->GetKinematics().now = dogs.Now();
+        return RemoveInactiveDogs(session);
+    }
 
-        std::vector<serialization::GameSessionRepr> session_reprs;
+    if (kinematics_mode_ == ANALYTIC) {
+        PlanDogMotions(*session, commanded_dogs, &frame);
+        ProcessKinematicEvents(*session, &frame);
+        ScheduleLootContacts(
+            *session, UpdateLoot(session, time_delta, &frame), &frame);
+    } else {
+        const auto moving = dogs.MovingIndices(&frame);
+        collision_detector::GathererProvider gatherer_provider{&frame};
 
-        for (auto session : sessions_) {
-            session_reprs.emplace_back(*session.second);
-        }
-        oa << session_reprs;
+        UpdateDogsPosition(
+            session, time_delta, moving, gatherer_provider, &frame);
+        UpdateLoot(session, time_delta, &frame);
 
-        oa << std::string("players");
-        size_t players_count = app::Players::GetPlayers().size();
-        oa << players_count;
+        AddLootToGathererProvider(session, gatherer_provider);
 
-        
-        for (auto player : app::Players::GetPlayers()) {
-            serialization::PlayerRepr player_repr{*player};
-            oa << player_repr;
-        }
+        GatherLoot(session, std::move(gatherer_provider), moving, &frame);
+    }
 
-        ofs.close();
+    return RemoveInactiveDogs(session);
+}
 
-        fs::rename(temp_save_path, final_save_path);
+serialization::GameStateRepr Game::CaptureState() const {
+    std::vector<std::shared_ptr<GameSession>> sessions;
+    sessions.reserve(sessions_.size());
+    for (const auto& [map_id, session] : sessions_) {
+        sessions.push_back(session);
+    }
 
-        value custom_data{final_save_path.string()};
-        BOOST_LOG_TRIVIAL(info)
-            << logging::add_value(my_logger::additional_data, custom_data)
-            << "game state successfully saved"sv;
+    serialization::GameStateRepr state;
+    state.sessions.resize(sessions.size());
+    RunInParallel(sessions.size(), tick_runner_, tick_concurrency_,
+        [&](size_t i) {
+            state.sessions[i] = serialization::GameSessionRepr{*sessions[i]};
+        });
 
+    state.players.reserve(players_->GetPlayers().size());
+    for (const auto& player : players_->GetPlayers()) {
+        state.players.emplace_back(*player);
     }
-    catch (const std::exception& e) {
-        try {
-            if (fs::exists(temp_save_path)) {
-                fs::remove(temp_save_path);
-            }
-        }
-        catch (...) {
-            // Игнорируем ошибки при удалении временного файла
-        }
-        
-        std::cerr << "Failed to save game state: " << e.what() << "\n";
-        throw;
+
+    state.tick = tick_;
+    state.pending_step_time = pending_step_time_;
+
+    return state;
+}
+
+void Game::SaveState() {
+    if (state_writer_) {
+        state_writer_->Flush();
     }
+    serialization::WriteStateFile(
+        save_file_path_, CaptureState(), GetStateFormat());
 }
 
 void Game::LoadState() {
     fs::path save_file_path(save_file_path_);
 
     try {
-        std::ifstream ifs(save_file_path);
-        if (!ifs.is_open()) {
-            throw std::runtime_error("Cannot open save file: "
-                                     + save_file_path.string());
-        }
-
-        boost::archive::text_iarchive ia{ifs};
-
-        sessions_.clear();
+        // Файл разбирается и проверяется целиком до изменения игры:
+        // сессии и игроки восстанавливаются во временные контейнеры и
+        // заменяют текущие, только если все ссылки между ними верны
+        serialization::GameStateRepr state =
+            serialization::ReadStateFile(save_file_path);
+
+        decltype(sessions_) sessions;
+        std::unordered_map<std::uint32_t, std::shared_ptr<GameSession>>
+            session_by_id;
+        std::uint32_t session_counter = session_counter_;
+        for (const auto& s_repr : state.sessions) {
+            if (!FindMap(Map::Id{s_repr.GetMapId()})) {
+                throw std::runtime_error("Unknown map in save file: "
+                                         + s_repr.GetMapId());
+            }
 
-        std::string s_string;
-        ia >> s_string;
+            auto session = std::make_shared<GameSession>(
+                s_repr.Restore(*this));
+            session->SetLootGenerator(GetLootGenerator());
+            const std::uint32_t session_id = session->GetId();
+            if (!session_by_id.emplace(session_id, session).second ||
+                !sessions.emplace(session->GetMap()->GetId(), session).second)
+            {
+                throw std::runtime_error("Duplicate session in save file: "
+                                         + std::to_string(session_id));
+            }
+            session_counter = std::max(session_counter, session_id + 1);
+        }
 
-        size_t sessions_count = 0;
-        ia >> sessions_count;
+        std::vector<std::shared_ptr<app::Player>> players;
+        players.reserve(state.players.size());
+        std::uint32_t player_counter = players_->GetPlayerCounter();
+        for (const auto& repr : state.players) {
+            auto it = session_by_id.find(repr.GetSessionId());
+            auto player = std::make_shared<app::Player>(repr.Restore(
+                it != session_by_id.end() ? it->second : nullptr));
+            player_counter = std::max(player_counter, player->GetId() + 1);
+            players.push_back(std::move(player));
+        }
 
-        std::vector<serialization::GameSessionRepr> session_reprs;
-        ia >> session_reprs;
-        
-        for (auto s_repr : session_reprs) {
-            try {
-                auto session = s_repr.Restore(*this);
-                sessions_[session.GetMap()->GetId()] =
-                    std::make_shared<GameSession>(session);
-
-                value custom_data{session.GetId()};
-                BOOST_LOG_TRIVIAL(info)
-                    << logging::add_value(
-                        my_logger::additional_data,
-                        custom_data
-                    )
-                    << "session successfully loaded"sv;
-            }
-            catch (const boost::archive::archive_exception& e) {
-                std::cerr <<
-                    "Warning: Failed to load session from archive: " <<
-                    e.what() << "\n";
-                break;
-            }
+        sessions_ = std::move(sessions);
+        session_counter_ = session_counter;
+        tick_ = state.tick;
+        // Накопленное время относится к шагу, с которым оно записано;
+        // при другом шаге от него остаётся не больше одного шага
+        pending_step_time_ = fixed_step_
+            ? std::clamp<std::int64_t>(
+                state.pending_step_time, 0, *fixed_step_ - 1)
+            : 0;
+        for (const auto& [map_id, session] : sessions_) {
+            value custom_data{session->GetId()};
+            BOOST_LOG_TRIVIAL(info)
+                << logging::add_value(my_logger::additional_data, custom_data)
+                << "session successfully loaded"sv;
         }
 
-        std::string p_string;
-        ia >> p_string;
-        size_t players_count = 0;
-        ia >> players_count;
-        
-        for (size_t i = 0; i < players_count; ++i) {
-            try {
-                serialization::PlayerRepr repr;
-                ia >> repr;
-                app::Player player = repr.Restore(*this);
-                app::Players::AddPlayer(std::make_shared<app::Player>(player));
-
-                value custom_data{player.GetId()};
-                BOOST_LOG_TRIVIAL(info)
-                    << logging::add_value(
-                        my_logger::additional_data,
-                        custom_data)
-                    << "player successfully loaded"sv;
-            }
-            catch (const boost::archive::archive_exception& e) {
-                std::cerr <<
-                    "Warning: Failed to load player from archive: " <<
-                    e.what() << "\n";
-                break;
-            }
+        for (auto& player : players) {
+            value custom_data{player->GetId()};
+            players_->AddPlayer(std::move(player));
+            BOOST_LOG_TRIVIAL(info)
+                << logging::add_value(my_logger::additional_data, custom_data)
+                << "player successfully loaded"sv;
         }
+        players_->SetPlayerCounter(player_counter);
 
-        ifs.close();
+        for (const auto& [map_id, session] : sessions_) {
+            RefreshSnapshot(session);
+        }
 
         value custom_data{save_file_path.string()};
         BOOST_LOG_TRIVIAL(info)
@@ -821,6 +1956,13 @@ void Game::LoadState() {
     }
 }
 
+void Game::RefreshSnapshot(const std::shared_ptr<GameSession>& session) const {
+    auto player_ids = players_->GetPlayerIdsBySession();
+    // Снимок публикуется между тиками, поэтому изменения относятся к
+    // следующему тику: клиенты, уже получившие текущий, их не пропустят
+    session->PublishSnapshot(player_ids[session->GetId()], tick_, tick_ + 1);
+}
+
 void Game::SetDogRetirementTime(double retirement_time_seconds) {
     dog_retirement_time_seconds_ = retirement_time_seconds;
 }
@@ -863,136 +2005,225 @@ std::chrono::milliseconds Game::GetRealTime() {
         std::chrono::steady_clock::now() - start_time_);
 }
 
-void Game::RemoveInactiveDogs(std::shared_ptr<GameSession>& session) {
+std::vector<std::uint32_t> Game::RemoveInactiveDogs(
+    std::shared_ptr<GameSession>& session)
+{
+    DogStore& store = session->GetDogStore();
+    const DogStore::HotArrays& hot = store.Hot();
+
+    // Срок действителен, если собака не двигалась с момента парковки
+    std::vector<size_t> expired;
+    session->GetRetirementWheel().Advance(store.NowMs(),
+        [&](const DogRetirement& retirement) {
+            if (!store.Contains(retirement.dog)) {
+                return;
+            }
+            const size_t index = store.IndexOf(retirement.dog);
+            if (hot.idle_token[index] == retirement.token) {
+                expired.push_back(index);
+            }
+        });
+    std::sort(expired.begin(), expired.end());
+
     auto& dogs = session->GetDogs();
+    std::vector<std::uint32_t> retired_dog_ids;
+    for (size_t index : expired) {
+        auto& dog = dogs[index];
+        // Без базы данных (например, в тестах) рекорды не сохраняются
+        if (pool_) {
+            database::Database::SaveRecord(pool_,
+                database::PlayerRecord{
+                    dog->GetUUID(),
+                    dog->GetName(),
+                    dog->GetScore(),
+                    static_cast<std::uint64_t>(
+                        (GetCurrentTime() - dog->GetJoinTime()).count())
+                }
+            );
+        }
 
-    std::vector<std::shared_ptr<Dog>> inactive_dogs;
-    std::copy_if(dogs.begin(), dogs.end(), std::back_inserter(inactive_dogs),
-        [this](const auto& dog) {
-            return dog->GetInactivityTime() >= GetDogRetirementTime();
-        });
+        retired_dog_ids.push_back(dog->GetId());
+    }
 
-    for (auto& dog : inactive_dogs) {
-        database::Database::SaveRecord(GetDBConnectionPool(),
-            database::PlayerRecord{
-                dog->GetUUID(),
-                dog->GetName(),
-                dog->GetScore(),
-                static_cast<std::uint64_t>(
-                    (GetCurrentTime() - dog->GetJoinTime()).count())
-            }
-        );
-        
-        app::Players::RemovePlayerFromGameByDogId(dog->GetId());
+    for (auto id : retired_dog_ids) {
+        session->RemoveDog(id);
     }
 
-    dogs.erase(
-        std::remove_if(dogs.begin(), dogs.end(),
-            [this](const auto& dog) {
-                return dog->GetInactivityTime() >= GetDogRetirementTime();
-            }),
-        dogs.end()
-    );
+    return retired_dog_ids;
 }
 
 void Game::UpdateDogsPosition(
         std::shared_ptr<GameSession>& session,
         std::int64_t time_delta_ms,
-        collision_detector::GathererProvider& gatherer_provider)
+        std::span<const std::uint32_t> moving,
+        collision_detector::GathererProvider& gatherer_provider,
+        std::pmr::memory_resource* frame)
 {
     const Map* map = session->GetMap();
     double time_delta_s = time_delta_ms / MS_IN_SECONDS;
 
-    for (std::shared_ptr<Dog>& dog : session->GetDogs()) {
-        auto old_position = dog->GetPosition();
+    DogStore& dogs = session->GetDogStore();
+    DogStore::HotArrays& hot = dogs.Hot();
+
+    // Целевые точки считаются одним проходом по массивам,
+    // затем для каждой собаки проверяются дороги
+    std::pmr::vector<double> target_x{frame};
+    std::pmr::vector<double> target_y{frame};
+    dogs.Integrate(time_delta_s, moving, target_x, target_y);
+
+    for (size_t k = 0; k < moving.size(); ++k) {
+        const size_t i = moving[k];
+        const geom::Point2D old_position{hot.x[i], hot.y[i]};
         auto new_dog_position = CalculateNewDogPosition(
-            dog,
-            time_delta_s,
-            map->GetRoadRTree());
+            dogs,
+            i,
+            PointBG{target_x[k], target_y[k]},
+            *map);
 
-        dog->SetPosition({
-            bg::get<0>(new_dog_position),
-            bg::get<1>(new_dog_position)});
+        hot.x[i] = bg::get<0>(new_dog_position);
+        hot.y[i] = bg::get<1>(new_dog_position);
 
         gatherer_provider.AddGatherer({
             {old_position.x, old_position.y},
-            {bg::get<0>(new_dog_position), bg::get<1>(new_dog_position)},
-            dog->GetWidth(),
-            dog->GetId()});
-
-        if (old_position.x == bg::get<0>(new_dog_position) && 
-            old_position.y == bg::get<1>(new_dog_position))
-        {
-            dog->SetStatus(Dog::DOG_STATUS::INACTIVE);
-            dog->UpdateInactivityTime(time_delta_s);
+            {hot.x[i], hot.y[i]},
+            hot.width[i],
+            dogs.Cold(i).id});
+
+        // Собака без скорости не сдвинется без команды и паркуется.
+        // Собака со скоростью, не дотянувшаяся за тик до дороги, может
+        // дотянуться за более длинный тик, поэтому продолжает движение,
+        // а срок ухода на покой отсчитывается с начала простоя
+        if (old_position.x == hot.x[i] && old_position.y == hot.y[i]) {
+            if (!HasVelocity(hot, i)) {
+                ParkDog(*session, i, hot.idle_since[i]);
+            } else if (auto token = dogs.Stall(i)) {
+                hot.status[i] = DogStatus::INACTIVE;
+                ScheduleRetirement(*session, i, *token);
+            }
         } else {
-            dog->SetStatus(Dog::DOG_STATUS::ACTIVE);
-            dog->ResetInactivityTimer();
+            hot.status[i] = DogStatus::ACTIVE;
+            hot.idle_since[i] = dogs.Now();
+            dogs.Wake(i);
         }
     }
 }
 
-PointBG Game::CalculateNewDogPosition(
-    std::shared_ptr<Dog>& dog,
-    double time_delta_s,
-    const Map::RoadRTree& roads)
+void Game::ParkDog(
+    GameSession& session,
+    size_t index,
+    double idle_since) const
 {
-    const PointBG current_pos{dog->GetPosition().x, dog->GetPosition().y};
-    const geom::Vec2D speed = dog->GetSpeed();
-    const DIRECTION dir = dog->GetDirection();
+    DogStore& dogs = session.GetDogStore();
+    DogStore::HotArrays& hot = dogs.Hot();
+    hot.status[index] = DogStatus::INACTIVE;
+    hot.idle_since[index] = idle_since;
+    ScheduleRetirement(session, index, dogs.Park(index));
+}
 
-    if (dir == DIRECTION::NONE || 
-        (std::abs(speed.x) < std::numeric_limits<double>::epsilon() &&
-        std::abs(speed.y) < std::numeric_limits<double>::epsilon()))
-    {
-        return current_pos;
-    }
+void Game::ScheduleRetirement(
+    GameSession& session,
+    size_t index,
+    std::uint64_t token) const
+{
+    DogStore& dogs = session.GetDogStore();
 
-    PointBG target_pos = current_pos;
-    bg::set<0>(target_pos, bg::get<0>(current_pos) + speed.x * time_delta_s);
-    bg::set<1>(target_pos, bg::get<1>(current_pos) + speed.y * time_delta_s);
+    // Собака уходит на покой на первом тике, к концу которого простой
+    // достиг GetDogRetirementTime(). Допуск поглощает погрешность сложения
+    const double deadline_ms =
+        (dogs.Hot().idle_since[index] + GetDogRetirementTime()) *
+        MS_IN_SECONDS;
+    session.GetRetirementWheel().Schedule(
+        static_cast<RetirementWheel::Time>(
+            std::max(0.0, std::ceil(deadline_ms - RETIREMENT_TOLERANCE_MS))),
+        DogRetirement{dogs.HandleOf(index), token});
+}
 
-    Segment movement{current_pos, target_pos};
-    std::vector<std::pair<Box, Road>> relevant_roads;
-    roads.query(
-        bgi::satisfies([&](const std::pair<Box, Road>& item) {
-            return bg::intersects(movement, item.first) || 
-                   bg::within(current_pos, item.first);
-        }),
-        std::back_inserter(relevant_roads));
+PointBG Game::CalculateNewDogPosition(
+    DogStore& dogs,
+    size_t index,
+    const PointBG& target_pos,
+    const Map& map)
+{
+    DogStore::HotArrays& hot = dogs.Hot();
+    const PointBG current_pos{hot.x[index], hot.y[index]};
+    const DIRECTION dir = hot.direction[index];
 
-    if (relevant_roads.empty()) {
+    if (!HasVelocity(hot, index)) {
         return current_pos;
     }
 
-    bool can_move_to_target = std::any_of(
-        relevant_roads.begin(), 
-        relevant_roads.end(),
-        [&target_pos, this](const auto& road) {
-            return IsPointOnRoad(target_pos, road.second);
-        });
-
-    if (can_move_to_target) {
-        return target_pos;
+    // Дорога участвует в перемещении, если её габарит пересекает путь
+    Segment movement{current_pos, target_pos};
+    const Map::Roads& roads = map.GetRoads();
+    auto is_on_path = [&](const Road& road) {
+        return bg::intersects(movement, road.GetBoundingBox()) ||
+               bg::within(current_pos, road.GetBoundingBox());
+    };
+    auto leads_to_target = [&](size_t road_index) {
+        const Road& road = roads[road_index];
+        return is_on_path(road) && IsPointOnRoad(target_pos, road);
+    };
+
+    // Обычно собака остаётся на своей дороге или переходит на соседнюю.
+    // Если ни одна из них не ведёт к цели, дороги ищутся по индексу
+    std::optional<size_t>& current_road = hot.road[index];
+    if (auto road = current_road; road && *road < roads.size()) {
+        if (leads_to_target(*road)) {
+            return target_pos;
+        }
+        for (const auto& crossing : map.GetRoadGraph().GetCrossings(*road)) {
+            if (leads_to_target(crossing.road)) {
+                current_road = crossing.road;
+                return target_pos;
+            }
+        }
     }
 
+    bool has_relevant_roads = false;
+    std::optional<size_t> target_road;
+    std::optional<size_t> stop_road;
     PointBG stop_pos = current_pos;
     double max_distance = std::numeric_limits<double>::min();
 
-    for (const auto& [box, road] : relevant_roads) {
-        if (IsPointOnRoad(current_pos, road)) {
-            PointBG candidate = FindStopPoint(current_pos, target_pos, road, dir);
+    map.GetRoadIndex().ForEachRoadOnPath(current_pos, target_pos,
+        [&](size_t road_index) {
+            const Road& road = roads[road_index];
+            if (target_road || !is_on_path(road)) {
+                return;
+            }
+            has_relevant_roads = true;
+            if (IsPointOnRoad(target_pos, road)) {
+                target_road = road_index;
+                return;
+            }
+            if (IsPointOnRoad(current_pos, road)) {
+                PointBG candidate =
+                    FindStopPoint(current_pos, target_pos, road, dir);
 
-            double dist = bg::distance(current_pos, candidate);
+                double dist = bg::distance(current_pos, candidate);
 
-            if (dist > max_distance) {
-                max_distance = dist;
-                stop_pos = candidate;
+                if (dist > max_distance) {
+                    max_distance = dist;
+                    stop_pos = candidate;
+                    stop_road = road_index;
+                }
             }
-        }
+        });
+
+    if (!has_relevant_roads) {
+        return current_pos;
+    }
+
+    if (target_road) {
+        current_road = target_road;
+        return target_pos;
     }
 
-    dog->SetSpeed({0, 0});
+    if (stop_road) {
+        current_road = stop_road;
+    }
+    hot.speed_x[index] = 0;
+    hot.speed_y[index] = 0;
     return stop_pos;
 }
 
@@ -1047,11 +2278,287 @@ PointBG Game::FindStopPoint(const PointBG& from, const PointBG& to,
     return from;
 }
 
-void Game::UpdateLoot(
+void Game::PlanDogMotions(
+    GameSession& session,
+    std::span<const std::uint32_t> commanded_dogs,
+    std::pmr::memory_resource* frame)
+{
+    DogStore& dogs = session.GetDogStore();
+    DogStore::HotArrays& hot = dogs.Hot();
+    // Команды будят собак, поэтому все они среди движущихся
+    const auto moving = dogs.MovingIndices(frame);
+
+    if (!commanded_dogs.empty()) {
+        std::pmr::vector<std::uint32_t> ids{
+            commanded_dogs.begin(), commanded_dogs.end(), frame};
+        std::sort(ids.begin(), ids.end());
+        for (const std::uint32_t i : moving) {
+            if (std::binary_search(ids.begin(), ids.end(), dogs.Cold(i).id)) {
+                hot.motion[i].plan = 0;
+            }
+        }
+    }
+
+    for (const std::uint32_t i : moving) {
+        if (hot.motion[i].plan == 0) {
+            PlanDogMotion(session, i, session.GetLoot(), frame);
+        }
+    }
+}
+
+void Game::PlanDogMotion(
+    GameSession& session,
+    size_t index,
+    std::span<const std::shared_ptr<Loot>> loot,
+    std::pmr::memory_resource* frame)
+{
+    SessionKinematics& kinematics = session.GetKinematics();
+    DogStore& dogs = session.GetDogStore();
+    DogStore::HotArrays& hot = dogs.Hot();
+    DogMotion& motion = hot.motion[index];
+
+    motion.origin = {hot.x[index], hot.y[index]};
+    motion.target = motion.origin;
+    motion.velocity = {0.0, 0.0};
+    motion.start = kinematics.now;
+    motion.plan = kinematics.next_plan++;
+
+    const geom::Vec2D speed{hot.speed_x[index], hot.speed_y[index]};
+    const double speed_value = std::abs(speed.x) + std::abs(speed.y);
+    const DIRECTION dir = hot.direction[index];
+
+    // Стоящая собака простаивает столько же, сколько до построения плана
+    if (dir == DIRECTION::NONE ||
+        speed_value < std::numeric_limits<double>::epsilon())
+    {
+        motion.stop = hot.idle_since[index];
+        return;
+    }
+
+    const PointBG target = FindReachablePoint(
+        *session.GetMap(),
+        PointBG{motion.origin.x, motion.origin.y},
+        dir);
+    motion.target = {bg::get<0>(target), bg::get<1>(target)};
+
+    const double distance = std::abs(motion.target.x - motion.origin.x) +
+                            std::abs(motion.target.y - motion.origin.y);
+    if (distance == 0) {
+        motion.stop = kinematics.now;
+        hot.speed_x[index] = 0;
+        hot.speed_y[index] = 0;
+        return;
+    }
+
+    motion.velocity = speed;
+    motion.stop = kinematics.now + distance / speed_value;
+
+    const DogStore::Handle handle = dogs.HandleOf(index);
+    kinematics.Schedule({
+        .time = motion.stop,
+        .kind = KinematicEvent::Kind::STOP,
+        .dog = handle,
+        .plan = motion.plan});
+
+    const collision_detector::Gatherer gatherer{
+        motion.origin,
+        motion.target,
+        hot.width[index],
+        0};
+    const auto office_events = session.GetMap()->GetOfficeIndex()
+        .FindGatherEvents(std::span{&gatherer, 1}, frame);
+    for (const auto& event : office_events) {
+        kinematics.Schedule({
+            .time = motion.start + event.time * (motion.stop - motion.start),
+            .kind = KinematicEvent::Kind::OFFICE,
+            .dog = handle,
+            .plan = motion.plan,
+            .item = static_cast<std::uint32_t>(event.item_id)});
+    }
+
+    for (const auto& item : loot) {
+        ScheduleLootContact(session, index, *item);
+    }
+}
+
+PointBG Game::FindReachablePoint(
+    const Map& map,
+    const PointBG& pos,
+    DIRECTION dir) const
+{
+    const bool horizontal =
+        dir == DIRECTION::EAST || dir == DIRECTION::WEST;
+    const bool forward =
+        dir == DIRECTION::EAST || dir == DIRECTION::SOUTH;
+    const double across = horizontal ? bg::get<1>(pos) : bg::get<0>(pos);
+    auto point_at = [&](double along) {
+        return horizontal ? PointBG{along, across} : PointBG{across, along};
+    };
+
+    // Полосы дорог, содержащие достигнутую точку, продлевают путь до
+    // своего края. Путь заканчивается, когда край больше не сдвигается
+    const Map::Roads& roads = map.GetRoads();
+    double reached = horizontal ? bg::get<0>(pos) : bg::get<1>(pos);
+    while (true) {
+        const PointBG point = point_at(reached);
+        double next = reached;
+
+        map.GetRoadIndex().ForEachRoadOnPath(
+            PointBG{bg::get<0>(point) - ROAD_HALF_WIDTH,
+                    bg::get<1>(point) - ROAD_HALF_WIDTH},
+            PointBG{bg::get<0>(point) + ROAD_HALF_WIDTH,
+                    bg::get<1>(point) + ROAD_HALF_WIDTH},
+            [&](size_t road_index) {
+                const Road& road = roads[road_index];
+                if (!IsPointOnRoad(point, road)) {
+                    return;
+                }
+                const Box area = RoadArea(road);
+                const double edge = forward
+                    ? (horizontal ? bg::get<bg::max_corner, 0>(area)
+                                  : bg::get<bg::max_corner, 1>(area))
+                    : (horizontal ? bg::get<bg::min_corner, 0>(area)
+                                  : bg::get<bg::min_corner, 1>(area));
+                next = forward ? std::max(next, edge) : std::min(next, edge);
+            });
+
+        if (next == reached) {
+            return point;
+        }
+        reached = next;
+    }
+}
+
+void Game::ScheduleLootContact(
+    GameSession& session,
+    size_t index,
+    const Loot& loot) const
+{
+    SessionKinematics& kinematics = session.GetKinematics();
+    DogStore& dogs = session.GetDogStore();
+    const DogMotion& motion = dogs.Hot().motion[index];
+
+    const auto result = collision_detector::TryCollectPoint(
+        motion.origin, motion.target, loot.GetPosition());
+    if (!result.IsCollected(dogs.Hot().width[index] + loot.GetWidth())) {
+        return;
+    }
+
+    const double time =
+        motion.start + result.proj_ratio * (motion.stop - motion.start);
+    if (time < kinematics.now) {
+        return;
+    }
+
+    kinematics.Schedule({
+        .time = time,
+        .kind = KinematicEvent::Kind::LOOT,
+        .dog = dogs.HandleOf(index),
+        .plan = motion.plan,
+        .loot = loot.GetKey()});
+}
+
+void Game::ScheduleLootContacts(
+    GameSession& session,
+    std::span<const std::shared_ptr<Loot>> new_loot,
+    std::pmr::memory_resource* frame) const
+{
+    if (new_loot.empty()) {
+        return;
+    }
+
+    DogStore& dogs = session.GetDogStore();
+    const DogStore::HotArrays& hot = dogs.Hot();
+    for (const std::uint32_t i : dogs.MovingIndices(frame)) {
+        if (hot.motion[i].velocity.x == 0 && hot.motion[i].velocity.y == 0) {
+            continue;
+        }
+        for (const auto& loot : new_loot) {
+            ScheduleLootContact(session, i, *loot);
+        }
+    }
+}
+
+void Game::ProcessKinematicEvents(
+    GameSession& session,
+    std::pmr::memory_resource* frame) const
+{
+    SessionKinematics& kinematics = session.GetKinematics();
+    DogStore& dogs = session.GetDogStore();
+    DogStore::HotArrays& hot = dogs.Hot();
+    const double until = dogs.Now();
+    const std::uint32_t bag_capacity = session.GetMap()->GetBagCapacity();
+
+    while (!kinematics.events.empty() &&
+           kinematics.events.top().time <= until)
+    {
+        const KinematicEvent event = kinematics.events.top();
+        kinematics.events.pop();
+
+        if (!dogs.Contains(event.dog)) {
+            continue;
+        }
+        const size_t index = dogs.IndexOf(event.dog);
+        DogMotion& motion = hot.motion[index];
+        if (motion.plan != event.plan) {
+            continue;
+        }
+
+        auto& dog = session.GetDogs()[index];
+        switch (event.kind) {
+            case KinematicEvent::Kind::LOOT:
+                if (dog->GetLootCountInBag() < bag_capacity &&
+                    session.FindLoot(event.loot))
+                {
+                    dog->AddLoot(session.GatherLoot(event.loot));
+                }
+                break;
+            case KinematicEvent::Kind::OFFICE:
+                dog->ReleaseLoot();
+                break;
+            case KinematicEvent::Kind::STOP:
+                motion.velocity = {0.0, 0.0};
+                hot.x[index] = motion.target.x;
+                hot.y[index] = motion.target.y;
+                hot.speed_x[index] = 0;
+                hot.speed_y[index] = 0;
+                break;
+        }
+    }
+
+    kinematics.now = until;
+
+    // Положения на конец тика; остановившиеся собаки паркуются
+    for (const std::uint32_t i : dogs.MovingIndices(frame)) {
+        const DogMotion& motion = hot.motion[i];
+        if (motion.velocity.x == 0 && motion.velocity.y == 0) {
+            ParkDog(session, i, motion.stop);
+            continue;
+        }
+
+        const double elapsed = until - motion.start;
+        hot.x[i] = std::clamp(motion.origin.x + motion.velocity.x * elapsed,
+            std::min(motion.origin.x, motion.target.x),
+            std::max(motion.origin.x, motion.target.x));
+        hot.y[i] = std::clamp(motion.origin.y + motion.velocity.y * elapsed,
+            std::min(motion.origin.y, motion.target.y),
+            std::max(motion.origin.y, motion.target.y));
+        hot.status[i] = DogStatus::ACTIVE;
+        hot.idle_since[i] = until;
+    }
+}
+
+std::pmr::vector<std::shared_ptr<Loot>> Game::UpdateLoot(
     std::shared_ptr<GameSession>& session,
-    std::int64_t time_delta)
+    std::int64_t time_delta,
+    std::pmr::memory_resource* frame)
 {
     const Map* map = session->GetMap();
+    std::pmr::vector<std::shared_ptr<Loot>> new_loot{frame};
+    if (map->GetLootTypesCount() == 0) {
+        return new_loot;
+    }
+
     auto time_delta_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
         std::chrono::duration<double>(time_delta)
     );
@@ -1059,22 +2566,29 @@ void Game::UpdateLoot(
     unsigned loot_count = session->GetLoot().size();
     unsigned looter_count = session->GetDogs().size();
 
-    unsigned new_loot_generated = loot_generator_->Generate(
+    unsigned new_loot_generated = session->GetLootGenerator().Generate(
         time_delta_ms,
         loot_count,
         looter_count
     );
 
+    new_loot.reserve(new_loot_generated);
+
+    std::mt19937_64& random = session->GetRandom();
     for (unsigned i = 0; i < new_loot_generated; ++i) {
-        Point point = map->GetRandomPointOnRoad();
+        Point point = map->GetRandomPointOnRoad(random);
         geom::Point2D position = {point.x * 1.0, point.y * 1.0};
-        int loot_type = GetRandomId(map->GetLootTypesCount() - 1);
+        int loot_type = map->GetRandomLootType(random);
 
         std::uint32_t value = map->GetLootValue(loot_type);
 
-        auto loot = std::make_shared<model::Loot>(loot_type, position, value);
+        auto loot = session->MakeLoot(loot_type, position, value);
+        loot->SetId(session->NextLootId());
         session->AddLoot(loot);
+        new_loot.push_back(std::move(loot));
     }
+
+    return new_loot;
 }
 
 void Game::AddLootToGathererProvider(
@@ -1093,70 +2607,58 @@ void Game::AddLootToGathererProvider(
     }
 }
 
-void Game::AddOfficesToGathererProvider(
-    std::shared_ptr<GameSession>& session,
-    collision_detector::GathererProvider& gatherer_provider) const
-{
-    auto office_list = session->GetMap()->GetOffices();
-    for (auto office : office_list) {
-        auto position = office.GetPosition();
-        std::string office_id = *office.GetId();
-        gatherer_provider.AddItem({
-            {static_cast<double>(position.x), static_cast<double>(position.y)},
-            office.GetWidth(),
-            static_cast<std::uint32_t>(std::stoul(office_id.substr(1))),
-            collision_detector::ItemType::OFFICE
-        });
-    }
-}
 void Game::GatherLoot(
         std::shared_ptr<GameSession>& session,
-        collision_detector::GathererProvider&& gatherer_provider) const
+        collision_detector::GathererProvider&& gatherer_provider,
+        std::span<const std::uint32_t> gatherer_dogs,
+        std::pmr::memory_resource* frame) const
 {
-    auto collision_events = FindGatherEvents(gatherer_provider);
-    std::vector<uint32_t> collected_loot_id;
+    auto loot_events = FindGatherEvents(gatherer_provider, frame);
+    auto office_events = session->GetMap()->GetOfficeIndex().FindGatherEvents(
+        gatherer_provider.Gatherers(), frame);
+
+    // При равных time предмет сначала подбирается, затем сдаётся в офис
+    collision_detector::GatheringEvents collision_events{frame};
+    collision_events.reserve(loot_events.size() + office_events.size());
+    std::merge(
+        loot_events.begin(), loot_events.end(),
+        office_events.begin(), office_events.end(),
+        std::back_inserter(collision_events),
+        [](const auto& lhs, const auto& rhs) {
+            return lhs.time < rhs.time;
+        });
 
-    auto existing_loot = session->GetLoot();
-    std::vector<uint32_t> existing_loot_ids;
-    for (const auto& loot : existing_loot) {
-        existing_loot_ids.push_back(loot->GetId());
-    }
+    // item_id событий лута - номер предмета в провайдере, совпадающий с
+    // номером лута в GetLoot(). Подобранный лут удаляется из сессии после
+    // прохода, поэтому номера остаются действительными до его конца
+    const auto loot = session->GetLoot();
+    const std::uint32_t bag_capacity = session->GetMap()->GetBagCapacity();
+    auto& dogs = session->GetDogs();
 
-    for (auto& event : collision_events) {
-        if (event.item_type_ != collision_detector::ItemType::OFFICE) {
-            if (std::find(
-                existing_loot_ids.begin(),
-                existing_loot_ids.end(),
-                event.item_id) == existing_loot_ids.end())
-            {
-                continue;
-            }
-        }
+    std::pmr::vector<bool> collected(loot.size(), false, frame);
+    std::pmr::vector<LootKey> collected_loot{frame};
 
-        auto dog = session->GetDogs()[event.gatherer_id];
+    for (const auto& event : collision_events) {
+        auto& dog = dogs[gatherer_dogs[event.gatherer_id]];
 
-        bool already_collected = std::find(
-            collected_loot_id.begin(),
-            collected_loot_id.end(),
-            event.item_id
-        ) != collected_loot_id.end();
-        
         if (event.item_type_ == collision_detector::ItemType::OFFICE) {
             dog->ReleaseLoot();
-        } else {
-            if (dog != nullptr && !already_collected) {
-                std::uint32_t bag_capacity = session->GetMap()->GetBagCapacity();
-                std::uint32_t loot_count_in_bag = dog->GetLootCountInBag();
-
-                if (loot_count_in_bag < bag_capacity) {
-                    auto loot = session->GatherLoot(event.item_id);
-                    if (loot) {
-                        dog->AddLoot(loot);
-                        collected_loot_id.push_back(event.item_id);
-                    }
-                }
-            }
+            continue;
+        }
+
+        if (event.item_id >= loot.size() || collected[event.item_id] ||
+            dog->GetLootCountInBag() >= bag_capacity)
+        {
+            continue;
         }
+
+        collected[event.item_id] = true;
+        dog->AddLoot(loot[event.item_id]);
+        collected_loot.push_back(loot[event.item_id]->GetKey());
+    }
+
+    for (LootKey key : collected_loot) {
+        session->GatherLoot(key);
     }
 }
 
@@ -6,31 +6,67 @@
 #include <boost/geometry/geometries/box.hpp>
 #include <boost/geometry/geometries/segment.hpp>
 #include <boost/geometry/index/rtree.hpp>
+#include <boost/container/small_vector.hpp>
 
+#include "alias_table.h"
 #include "collision_detector.h"
 #include "database.h"
 #include "extra_data.h"
+#include "frame_arena.h"
+#include "lazy_value.h"
 #include "loot_generator.h"
+#include "mpsc_queue.h"
+#include "object_pool.h"
+#include "slot_map.h"
 #include "tagged.h"
+#include "timing_wheel.h"
 
 #include <algorithm>
+#include <chrono>
+#include <functional>
 #include <limits>
 #include <list>
 #include <memory>
 #include <optional>
+#include <queue>
+#include <random>
 #include <string>
+#include <tuple>
 #include <unordered_map>
 #include <vector>
 
+namespace app {
+class Players;
+}  // namespace app
+
+namespace serialization {
+struct GameStateRepr;
+class StateWriter;
+enum class StateFormat;
+}  // namespace serialization
+
 namespace model {
 
 static const double DEFAULT_DOG_SPEED = 1.0;
 static const double DEFAULT_RETIREMENT_TIME = 60.0;
 static const std::uint32_t DEFAULT_BAG_CAPACITY = 3;
+// Число объектов, под которые заранее выделяется память: собак и игроков
+// на игру, лута на сессию
+static const size_t DEFAULT_PLAYER_POOL_CAPACITY = 256;
+static const size_t DEFAULT_LOOT_POOL_CAPACITY = 256;
+// Нулевой радиус обзора означает, что игрок видит всю карту
+static const double DEFAULT_VIEW_RADIUS = 0.0;
 const double DOG_WIDTH = 0.6;
 const double LOOT_WIDTH = 0.0;
 const double OFFICE_WIDTH = 0.5;
+// Размер ячейки сетки, по которой раскладываются офисы карты
+const double OFFICE_GRID_CELL_SIZE = 8.0;
 const double ROAD_HALF_WIDTH = 0.4;
+// Запас поиска в RoadIndex: bg::intersects сравнивает координаты
+// с допуском, поэтому индекс возвращает дороги с небольшим запасом
+const double ROAD_INDEX_MARGIN = 1e-6;
+// Глубина истории изменений, по которой строятся разностные ответы
+const std::uint64_t STATE_HISTORY_TICKS = 100;
 
 using Dimension = int;
 using Coord = Dimension;
@@ -131,13 +167,133 @@ private:
     double width_ = OFFICE_WIDTH;
 };
 
+// Индекс дорог для перемещения собак. Дороги параллельны осям, поэтому
+// горизонтальные группируются по строкам (y), вертикальные - по столбцам
+// (x), а внутри строки или столбца габариты дорог упорядочены по началу.
+// Поиск дорог, габарит которых (Road::GetBoundingBox) может пересекать
+// отрезок пути, сводится к двоичному поиску строки, столбца и отрезка
+// в них
+class RoadIndex {
+public:
+    RoadIndex() = default;
+    explicit RoadIndex(const std::vector<Road>& roads);
+
+    // Вызывает fn(номер дороги) для каждой дороги, габарит которой
+    // пересекает прямоугольник с углами from и to, расширенный
+    // на ROAD_INDEX_MARGIN
+    template <typename Fn>
+    void ForEachRoadOnPath(const PointBG& from, const PointBG& to,
+                           Fn&& fn) const {
+        const double x0 =
+            std::min(bg::get<0>(from), bg::get<0>(to)) - ROAD_INDEX_MARGIN;
+        const double x1 =
+            std::max(bg::get<0>(from), bg::get<0>(to)) + ROAD_INDEX_MARGIN;
+        const double y0 =
+            std::min(bg::get<1>(from), bg::get<1>(to)) - ROAD_INDEX_MARGIN;
+        const double y1 =
+            std::max(bg::get<1>(from), bg::get<1>(to)) + ROAD_INDEX_MARGIN;
+
+        VisitLines(rows_, y0, y1, x0, x1, fn);
+        VisitLines(columns_, x0, x1, y0, y1, fn);
+    }
+
+private:
+    // Габарит дороги вдоль её оси
+    struct Span {
+        double begin;
+        double end;
+        // Наибольший end среди этого и предыдущих отрезков линии
+        double max_end;
+        size_t road;
+    };
+
+    struct Line {
+        Coord coord;
+        std::vector<Span> spans;
+    };
+
+    static void SortLines(std::vector<Line>& lines);
+
+    template <typename Fn>
+    static void VisitLines(
+        const std::vector<Line>& lines,
+        double across_min, double across_max,
+        double along_min, double along_max,
+        Fn& fn)
+    {
+        auto line = std::partition_point(lines.begin(), lines.end(),
+            [across_min](const Line& l) {
+                return l.coord + ROAD_HALF_WIDTH < across_min;
+            });
+
+        for (; line != lines.end() &&
+               line->coord - ROAD_HALF_WIDTH <= across_max; ++line)
+        {
+            const auto& spans = line->spans;
+            auto it = std::partition_point(spans.begin(), spans.end(),
+                [along_max](const Span& span) {
+                    return span.begin <= along_max;
+                });
+
+            while (it != spans.begin()) {
+                --it;
+                if (it->max_end < along_min) {
+                    break;
+                }
+                if (it->end >= along_min) {
+                    fn(it->road);
+                }
+            }
+        }
+    }
+
+    std::vector<Line> rows_;
+    std::vector<Line> columns_;
+};
+
+// Граф дорог карты. Вершины - дороги, рёбра - перекрёстки: пары дорог,
+// полосы которых (габарит с запасом ROAD_HALF_WIDTH по обеим осям)
+// пересекаются. Дороги одной строки или столбца, полосы которых
+// перекрываются, объединены в участки (Span), вдоль которых можно
+// двигаться без остановки. Граф строится при загрузке карты и
+// используется при перемещении собак, ботами и при поиске пути
+class RoadGraph {
+public:
+    struct Crossing {
+        size_t road;
+        // Центр пересечения полос
+        geom::Point2D point;
+    };
+
+    struct Span {
+        bool horizontal;
+        Coord coord;
+        // Границы полосы участка вдоль его оси
+        double begin;
+        double end;
+        std::vector<size_t> roads;
+    };
+
+    RoadGraph() = default;
+    RoadGraph(const std::vector<Road>& roads, const RoadIndex& index);
+
+    const std::vector<Crossing>& GetCrossings(size_t road) const;
+
+    size_t GetSpanIndex(size_t road) const;
+    const std::vector<Span>& GetSpans() const noexcept;
+
+private:
+    std::vector<std::vector<Crossing>> crossings_;
+    std::vector<size_t> span_by_road_;
+    std::vector<Span> spans_;
+};
+
 class Map {
 public:
     using Id = util::Tagged<std::string, Map>;
     using Roads = std::vector<Road>;
     using Buildings = std::vector<Building>;
     using Offices = std::vector<Office>;
-    using RoadRTree = bgi::rtree<std::pair<Box, Road>, bgi::rstar<16>>;
 
     Map(Id id, std::string name) noexcept;
 
@@ -149,24 +305,46 @@ public:
 
     void SetBagCapacity(std::uint32_t bag_capacity);
     std::uint32_t GetBagCapacity() const;
+
+    void SetViewRadius(double view_radius);
+    double GetViewRadius() const;
     
     const Id& GetId() const noexcept;
 
     void AddOffice(Office office);
     const Offices& GetOffices() const noexcept;
 
+    // Офисы неподвижны, поэтому набор для проверки столкновений строится
+    // один раз. item_id событий - номер офиса в GetOffices()
+    void BuildOfficeIndex();
+    const collision_detector::ItemIndex& GetOfficeIndex() const noexcept;
+
     const std::string& GetName() const noexcept;
 
     void AddRoad(const Road& road);
     const Roads& GetRoads() const noexcept;
 
-    void BuildRoadRTree();
-    RoadRTree GetRoadRTree() const;
+    void BuildRoadIndex();
+    const RoadIndex& GetRoadIndex() const noexcept;
 
+    // Вызывается после BuildRoadIndex
+    void BuildRoadGraph();
+    const RoadGraph& GetRoadGraph() const noexcept;
+
+    // Таблица выбора дороги для появления лута и собак. Вес дороги -
+    // число её целых точек, поэтому точки равновероятны на всех дорогах
+    void BuildSpawnTable();
+
+    // Случайная целая точка дорог. Вызывается после BuildSpawnTable
+    Point GetRandomPointOnRoad(std::mt19937_64& random) const;
+    // То же с генератором вызывающего потока
     Point GetRandomPointOnRoad() const;
 
+    // Распределение типов лута строится один раз при задании их числа
     void SetLootTypesCount(int loot_types_count);
     int GetLootTypesCount() const;
+    // Равновероятный тип лута. Вызывается, только если типы лута есть
+    int GetRandomLootType(std::mt19937_64& random) const;
 
     void AddLootValue(std::uint32_t value);
     std::uint32_t GetLootValue(size_t index) const;
@@ -180,14 +358,24 @@ private:
     Roads roads_;
     Buildings buildings_;
     double dog_speed_;
-    std::uint32_t bag_capacity_;
+    std::uint32_t bag_capacity_{DEFAULT_BAG_CAPACITY};
+    double view_radius_{DEFAULT_VIEW_RADIUS};
     OfficeIdToIndex warehouse_id_to_index_;
     Offices offices_;
-    RoadRTree road_rtree_;
-    int loot_types_count_;
+    collision_detector::ItemIndex office_index_;
+    RoadIndex road_index_;
+    RoadGraph road_graph_;
+    util::AliasTable spawn_table_;
+    int loot_types_count_{0};
+    std::uniform_int_distribution<int> loot_type_distribution_;
     std::vector<std::uint32_t> loot_value_;
 };
 
+class Loot;
+
+// Ключ лута в хранилище сессии
+using LootKey = util::SlotMap<std::shared_ptr<Loot>>::Key;
+
 class Loot {
 public:
     Loot(
@@ -199,6 +387,10 @@ public:
 
     std::uint32_t GetId() const;
     void SetId(std::uint32_t id);
+
+    // Ключ назначается сессией при добавлении лута на карту
+    LootKey GetKey() const;
+    void SetKey(LootKey key);
     
     geom::Point2D GetPosition() const;
 
@@ -207,27 +399,175 @@ public:
 
     std::uint32_t GetValue() const;
 
-    static std::uint32_t GetLootCounter();
-    static void SetLootCounter(std::uint32_t counter);
-
 private:
     std::uint32_t type_;
-    std::uint32_t id_;
+    std::uint32_t id_{0};
+    LootKey key_{};
     geom::Point2D position_;
     double width_ = LOOT_WIDTH;
     std::uint32_t value_;
-    static std::uint32_t loot_counter_;
 };
 
-class Dog {
+// Рюкзак вместимостью не больше DEFAULT_BAG_CAPACITY не обращается к куче;
+// для карт с большей вместимостью память выделяется один раз при входе
+using LootBag =
+    boost::container::small_vector<std::shared_ptr<Loot>, DEFAULT_BAG_CAPACITY>;
+
+enum class DogStatus {
+    ACTIVE,
+    INACTIVE,
+};
+
+class Dog;
+
+// Движение собаки в аналитическом режиме (Game::ANALYTIC): с момента
+// start собака равномерно движется из origin со скоростью velocity и
+// в момент stop останавливается в target
+struct DogMotion {
+    geom::Point2D origin;
+    geom::Point2D target;
+    geom::Vec2D velocity{0.0, 0.0};
+    double start{0};
+    double stop{0};
+    // Номер плана движения в сессии; 0 - план не построен
+    std::uint64_t plan{0};
+};
+
+// Хранилище собак в виде массивов компонентов (SoA). Часто изменяемые
+// на тике данные лежат в плотных массивах и обходятся подряд без
+// обращения к объектам Dog, а редко используемые (имя, UUID, счёт,
+// рюкзак) хранятся отдельно. Записи идут в порядке добавления собак,
+// а на место удалённой записи переносится последняя. Собака адресуется
+// дескриптором, который не меняется при удалении других собак
+class DogStore {
 public:
-    enum class DOG_STATUS {
-        ACTIVE,
-        INACTIVE,
+    using Handle = std::uint32_t;
+
+    // i-й элемент каждого массива относится к i-й собаке
+    struct HotArrays {
+        std::vector<double> x;
+        std::vector<double> y;
+        std::vector<double> speed_x;
+        std::vector<double> speed_y;
+        std::vector<DIRECTION> direction;
+        std::vector<double> width;
+        // Момент по часам хранилища, с которого собака стоит на месте
+        std::vector<double> idle_since;
+        // Номер стоянки стоящей собаки; 0 - собака движется
+        std::vector<std::uint64_t> idle_token;
+        std::vector<DogStatus> status;
+        // Подсказка для перемещения, см. Dog::GetRoad
+        std::vector<std::optional<size_t>> road;
+        // Не переносится между хранилищами: план строится заново
+        std::vector<DogMotion> motion;
+    };
+
+    struct ColdRecord {
+        std::uint32_t id{0};
+        std::string name;
+        std::string uuid;
+        std::uint32_t score{0};
+        std::chrono::milliseconds join_time{0};
+        LootBag bag;
     };
 
+    // Все компоненты одной собаки; используется при переносе собаки
+    // между хранилищами
+    struct Record {
+        geom::Point2D position;
+        geom::Vec2D speed{0.0, 0.0};
+        DIRECTION direction{NORTH};
+        double width = DOG_WIDTH;
+        double inactivity_time{0};
+        DogStatus status{};
+        std::optional<size_t> road;
+        ColdRecord cold;
+    };
+
+    DogStore() = default;
+
+    DogStore(const DogStore&) = delete;
+    DogStore& operator=(const DogStore&) = delete;
+
+    Handle Insert(Record record);
+    Record Extract(Handle handle);
+    Record Get(Handle handle) const;
+    void Assign(Handle handle, Record record);
+
+    size_t Size() const noexcept;
+    size_t IndexOf(Handle handle) const;
+    Handle HandleOf(size_t index) const;
+    bool Contains(Handle handle) const noexcept;
+
+    HotArrays& Hot() noexcept;
+    const HotArrays& Hot() const noexcept;
+
+    ColdRecord& Cold(size_t index);
+    const ColdRecord& Cold(size_t index) const;
+
+    // Часы хранилища - время сессии от её первого тика. Простой собаки
+    // равен разности показаний часов и её idle_since
+    double Now() const noexcept;
+    std::int64_t NowMs() const noexcept;
+    void AdvanceClock(std::int64_t time_delta_ms) noexcept;
+    double InactivityTime(size_t index) const;
+
+    // Собака, не сдвинувшаяся за тик, паркуется, и проходы перемещения
+    // и сбора её не видят, пока команда или изменение через Dog её не
+    // разбудят. Park возвращает номер стоянки, по которому отличают
+    // устаревшие сроки ухода на покой. Stall даёт номер стоянки собаке,
+    // которая остаётся среди движущихся, если у неё его ещё нет
+    void Wake(size_t index);
+    std::uint64_t Park(size_t index);
+    std::optional<std::uint64_t> Stall(size_t index);
+    bool IsParked(size_t index) const;
+    size_t MovingCount() const noexcept;
+
+    // Номера движущихся собак в порядке хранилища
+    std::pmr::vector<std::uint32_t> MovingIndices(
+        std::pmr::memory_resource* resource) const;
+
+    // Целевые положения собак с номерами indices: position + speed * dt.
+    // k-й элемент результата относится к собаке indices[k]
+    void Integrate(
+        double dt,
+        std::span<const std::uint32_t> indices,
+        std::pmr::vector<double>& target_x,
+        std::pmr::vector<double>& target_y) const;
+
+private:
+    void RemoveFromMoving(Handle handle);
+
+    static constexpr std::uint32_t NO_INDEX =
+        std::numeric_limits<std::uint32_t>::max();
+
+    HotArrays hot_;
+    std::vector<ColdRecord> cold_;
+    std::vector<Handle> handle_by_index_;
+    std::vector<std::uint32_t> index_by_handle_;
+    std::vector<Handle> free_handles_;
+    std::vector<Handle> moving_;
+    // Позиция собаки в moving_ или NO_INDEX
+    std::vector<std::uint32_t> moving_pos_by_handle_;
+    std::uint64_t next_idle_token_{1};
+    std::int64_t clock_ms_{0};
+};
+
+// Собака - представление записи в DogStore. Пока собака не добавлена
+// в сессию, её компоненты хранятся в собственном хранилище из одной записи.
+// Тик и вход игроков переносят записи хранилища, поэтому собаку можно
+// использовать только в тике или в api_strand, но не из потоков запросов
+class Dog {
+public:
+    using DOG_STATUS = DogStatus;
+
     Dog(const std::string dog_name, geom::Point2D position);
 
+    // Копия не связана с сессией исходной собаки
+    Dog(const Dog& other);
+    Dog& operator=(const Dog& other);
+    ~Dog();
+
     void SetDirection(const DIRECTION& new_direction);
     DIRECTION GetDirection() const;
 
@@ -246,7 +586,7 @@ public:
     std::uint32_t GetId() const;
 
     void AddLoot(std::shared_ptr<Loot> loot);
-    const std::vector<std::shared_ptr<Loot>>& GetLoot() const;
+    const LootBag& GetLoot() const;
     std::uint32_t GetLootCountInBag() const;
 
     void ReleaseLoot();
@@ -254,9 +594,6 @@ public:
     void SetScore(std::uint32_t score);
     std::uint32_t GetScore() const;
 
-    static std::uint32_t GetDogCounter();
-    static void SetDogCounter(std::uint32_t counter);
-
     void SetJoinTime(std::chrono::milliseconds join_time);
     std::chrono::milliseconds GetJoinTime() const;
 
@@ -270,58 +607,279 @@ public:
     void SetUUID(const std::string& uuid);;
     std::string GetUUID();
 
+    // Номер дороги карты, на которой собака оказалась после последнего
+    // перемещения. Используется только как подсказка: перед применением
+    // положение собаки на дороге проверяется заново
+    void SetRoad(std::optional<size_t> road);
+    std::optional<size_t> GetRoad() const;
+
+    // Переносит компоненты собаки в хранилище сессии и обратно
+    void AttachTo(DogStore& store);
+    void Detach();
+
 private:
-    std::uint32_t id_;
-    std::string dog_name_;
-    geom::Point2D position_;
-    geom::Vec2D speed_{0.0, 0.0};
-    DIRECTION direction_{NORTH};
-    std::vector<std::shared_ptr<Loot>> bag_;
-    double width_ = DOG_WIDTH;
-    std::uint32_t score_ = 0;
-    static std::uint32_t dog_counter_;
-    std::chrono::milliseconds join_time_;
-    double inactivity_time_{0};
-    DOG_STATUS status_{};
-    std::string uuid_;
+    size_t Index() const;
+
+    std::unique_ptr<DogStore> own_store_;
+    DogStore* store_;
+    DogStore::Handle handle_;
+};
+
+// Неизменяемый снимок состояния сессии на конец тика.
+// Публикуется целиком, поэтому читатели всегда видят состояние одного тика
+struct SessionSnapshot {
+    // changed_tick - тик, на котором объект появился или изменился
+    struct LootState {
+        std::uint32_t id;
+        std::uint32_t type;
+        geom::Point2D position;
+        std::uint64_t changed_tick{0};
+    };
+
+    struct DogState {
+        std::uint32_t player_id;
+        std::string name;
+        geom::Point2D position;
+        geom::Vec2D speed;
+        DIRECTION direction;
+        std::vector<LootState> bag;
+        std::uint32_t score;
+        std::uint64_t changed_tick{0};
+    };
+
+    struct Removal {
+        std::uint64_t tick;
+        std::uint32_t id;
+    };
+    using Removals = std::vector<Removal>;
+
+    using EncodedBody = util::Lazy<std::shared_ptr<const std::string>>;
+
+    std::uint64_t tick{0};
+    std::vector<DogState> dogs;
+    std::vector<LootState> loot;
+
+    // Изменения после тика since можно восстановить по снимку, только
+    // если history_start <= since <= tick, см. HasHistorySince
+    std::uint64_t history_start{0};
+    std::shared_ptr<const Removals> removed_players;
+    std::shared_ptr<const Removals> removed_loot;
+
+    // Тела ответов кодируются при первом запросе и отдаются всем
+    // читателям снимка. Состав игроков меняется только при входе и
+    // выходе, поэтому его тело переходит в следующие снимки
+    EncodedBody state_body;
+    EncodedBody binary_state_body;
+    EncodedBody full_since_body;
+    EncodedBody previous_tick_delta_body;
+    std::uint64_t roster_version{0};
+    std::shared_ptr<const EncodedBody> roster_body;
+
+    // Индексы в dogs и loot объектов, видимых игроку
+    struct Visible {
+        std::vector<size_t> dogs;
+        std::vector<size_t> loot;
+    };
+
+    double view_radius{DEFAULT_VIEW_RADIUS};
+
+    // Объекты в радиусе view_radius от собаки игрока. Пространственный
+    // индекс строится при первом запросе и используется до конца тика
+    std::optional<Visible> FindVisible(std::uint32_t player_id) const;
+
+    // Объекты с changed_tick > since и записи об удалении с tick > since
+    // составляют все изменения после тика since
+    bool HasHistorySince(std::uint64_t since) const;
+
+private:
+    enum class EntityKind {
+        DOG,
+        LOOT,
+    };
+    using EntityRTree = bgi::rtree<
+        std::pair<PointBG, std::pair<EntityKind, size_t>>,
+        bgi::quadratic<16>>;
+
+    struct EntityIndex {
+        EntityRTree entities;
+        std::unordered_map<std::uint32_t, size_t> dog_by_player;
+    };
+
+    util::Lazy<EntityIndex> entity_index_;
+};
+
+// Событие аналитического режима. Событие действительно, пока собака
+// остаётся в сессии и движется по плану plan
+struct KinematicEvent {
+    // При равном времени лут подбирается до сдачи в офис, а сдача
+    // происходит до остановки
+    enum class Kind {
+        LOOT,
+        OFFICE,
+        STOP
+    };
+
+    double time;
+    Kind kind;
+    DogStore::Handle dog;
+    std::uint64_t plan;
+    // Ключ лута в сессии
+    LootKey loot{};
+    // Номер офиса в Map::GetOffices()
+    std::uint32_t item{0};
+    std::uint64_t seq{0};
+
+    bool operator>(const KinematicEvent& other) const {
+        return std::tie(time, kind, seq) >
+               std::tie(other.time, other.kind, other.seq);
+    }
+};
+
+// Время и очередь событий сессии в аналитическом режиме. Время
+// отсчитывается в секундах от первого тика сессии
+struct SessionKinematics {
+    void Schedule(KinematicEvent event);
+
+    double now{0};
+    std::uint64_t next_plan{1};
+    std::uint64_t next_seq{0};
+    std::priority_queue<
+        KinematicEvent,
+        std::vector<KinematicEvent>,
+        std::greater<KinematicEvent>> events;
+};
+
+// Срок ухода на покой припаркованной собаки. Срок действителен, пока
+// собака стоит на стоянке token
+struct DogRetirement {
+    DogStore::Handle dog;
+    std::uint64_t token;
+};
+
+// Сроки отсчитываются в миллисекундах по часам DogStore сессии
+using RetirementWheel = util::TimingWheel<DogRetirement>;
+
+// Команда управления собакой, полученная от игрока
+struct DogCommand {
+    std::uint32_t dog_id;
+    DIRECTION direction;
 };
 
 class GameSession {
 public:
-    GameSession(const Map* map_);
+    // Лут сессии создаётся в её пуле на loot_pool_capacity предметов
+    GameSession(
+        const Map* map_,
+        std::uint32_t id,
+        size_t loot_pool_capacity = DEFAULT_LOOT_POOL_CAPACITY);
+    GameSession(GameSession&&) = default;
+    ~GameSession();
 
     void SetId(std::uint32_t id);
     std::uint32_t GetId() const;
 
+    // Собаки сессии хранят компоненты в её DogStore в том же порядке,
+    // что и в GetDogs()
     void AddDog(std::shared_ptr<Dog> dog);
     std::vector<std::shared_ptr<Dog>>& GetDogs();
     const std::vector<std::shared_ptr<Dog>>& GetDogs() const;
     std::shared_ptr<Dog> GetDogById(std::uint32_t id) const;
+    DogStore& GetDogStore();
+
+    // Лут создаётся в пуле сессии
+    std::shared_ptr<Loot> MakeLoot(
+        std::uint32_t type,
+        geom::Point2D position,
+        std::uint32_t value);
 
+    // Лут на карте хранится плотно; представление GetLoot() действительно
+    // до следующего добавления или подбора лута. Лут ищется и подбирается
+    // по ключу, который AddLoot записывает в него
     void AddLoot(std::shared_ptr<Loot> loot);
-    std::list<std::shared_ptr<Loot>> GetLoot() const;
+    std::span<const std::shared_ptr<Loot>> GetLoot() const;
+    std::shared_ptr<Loot> FindLoot(LootKey key) const;
 
     const Map* GetMap() const;
 
-    std::shared_ptr<Loot> GatherLoot(size_t loot_id);
+    std::shared_ptr<Loot> GatherLoot(LootKey key);
+
+    // Идентификаторы собак и лута уникальны в пределах сессии, поэтому
+    // сессии можно обновлять параллельно, не разделяя общих счётчиков
+    std::uint32_t NextDogId();
+    std::uint32_t GetDogCounter() const;
+    void SetDogCounter(std::uint32_t counter);
 
-    static std::uint32_t GetSessionCounter();
-    static void SetSessionCounter(std::uint32_t counter);
+    std::uint32_t NextLootId();
+    std::uint32_t GetLootCounter() const;
+    void SetLootCounter(std::uint32_t counter);
+
+    void SetLootGenerator(loot_gen::LootGenerator generator);
+    loot_gen::LootGenerator& GetLootGenerator();
 
     void RemoveDog(std::uint32_t dog_id);
 
+    // Может вызываться из любого потока без синхронизации с тиком
+    void EnqueueCommand(DogCommand command);
+
+    // Применяет накопленные команды; для каждой собаки учитывается
+    // только последняя из них. Возвращает идентификаторы собак,
+    // получивших команды, в памяти resource
+    std::pmr::vector<std::uint32_t> ApplyPendingCommands(
+        std::pmr::memory_resource* resource =
+            std::pmr::get_default_resource());
+
+    SessionKinematics& GetKinematics();
+    RetirementWheel& GetRetirementWheel();
+
+    // Генератор случайных чисел сессии; используется только в её тике
+    std::mt19937_64& GetRandom();
+
+    using PlayerIdByDog =
+        std::pmr::unordered_map<std::uint32_t, std::uint32_t>;
+
+    // Снимок заменяется атомарно; ранее выданные снимки остаются
+    // действительными, пока на них есть ссылки. Изменения относительно
+    // предыдущего снимка помечаются тиком change_tick
+    void PublishSnapshot(
+        const PlayerIdByDog& player_ids,
+        std::uint64_t tick,
+        std::uint64_t change_tick);
+    std::shared_ptr<const SessionSnapshot> GetSnapshot() const;
+
 private:
     const Map* map_;
+    // Собаки ссылаются на хранилище, поэтому при перемещении сессии
+    // его адрес не меняется
+    std::unique_ptr<DogStore> dog_store_;
     std::vector<std::shared_ptr<Dog>> dogs_;
-    std::list<std::shared_ptr<Loot>> loot_;
+    std::shared_ptr<util::PoolResource> loot_pool_;
+    util::SlotMap<std::shared_ptr<Loot>> loot_;
     std::uint32_t session_id_;
-    static std::uint32_t session_counter_;
+    std::uint32_t dog_counter_{0};
+    std::uint32_t loot_counter_{0};
+    std::uint64_t roster_version_{0};
+    std::optional<std::uint64_t> first_published_tick_;
+    std::optional<loot_gen::LootGenerator> loot_generator_;
+    util::MpscQueue<DogCommand> pending_commands_;
+    std::shared_ptr<const SessionSnapshot> snapshot_;
+    SessionKinematics kinematics_;
+    RetirementWheel retirement_wheel_;
+    std::mt19937_64 random_;
 };
 
 class Game {
 public:
     using MapIdHasher = util::TaggedHasher<Map::Id>;
     using Maps = std::vector<Map>;
+    // Функция, отправляющая задачу на выполнение в пул рабочих потоков
+    using TaskRunner = std::function<void(std::function<void()>)>;
+    // Вызывается в конце каждого тика, когда снимки всех сессий обновлены
+    using TickListener = std::function<void(std::uint64_t tick)>;
+
+    Game();
+    Game(Game&&) noexcept;
+    Game& operator=(Game&&) noexcept;
+    ~Game();
     
     enum GAME_MODE {
         NORMAL,
@@ -333,20 +891,52 @@ public:
         FIX
     };
 
+    // FIXED_STEP - собаки перемещаются шагами длиной в тик.
+    // ANALYTIC - положение собаки вычисляется по её плану движения,
+    // а остановки и столкновения заранее рассчитываются как события.
+    // В этом режиме собака доезжает до края полосы дороги, даже если
+    // за один тик проехала бы дальше, а новый лут доступен начиная
+    // со следующего тика
+    enum KINEMATICS_MODE {
+        FIXED_STEP,
+        ANALYTIC
+    };
+
     void AddMap(Map map);
     const Map* FindMap(const Map::Id& id) const noexcept;
     const Maps& GetMaps() const noexcept;
 
     std::shared_ptr<GameSession> FindSessionById(std::uint32_t session_id) const;
 
+    app::Players& GetPlayers();
+    const app::Players& GetPlayers() const;
+
     void SetGameMode(bool test_mode);
     GAME_MODE GetGameMode() const;
 
     void SetDogSpawnMode(bool spawn_mode);
     SPAWN_MODE GetDogSpawnMode() const;
 
+    void SetKinematicsMode(bool analytic);
+    KINEMATICS_MODE GetKinematicsMode() const;
+
     void SetSaveFilePath(const std::string& path);
 
+    // Формат, в котором сохраняется состояние. Загружается файл любого
+    // формата
+    void SetStateFormat(serialization::StateFormat format);
+    serialization::StateFormat GetStateFormat() const;
+
+    // Память пулов выделяется и заполняется сразу, чтобы вход игроков
+    // и появление лута не обращались к общей куче
+    void SetPoolCapacity(size_t players, size_t loot_per_session);
+    size_t GetLootPoolCapacity() const;
+
+    // Собака создаётся в пуле игры
+    std::shared_ptr<Dog> MakeDog(
+        const std::string& name,
+        geom::Point2D position);
+
     std::shared_ptr<GameSession> AddDogToSession(
         std::shared_ptr<model::Dog> dog,
         const model::Map::Id& map_id);
@@ -359,12 +949,44 @@ public:
 
     void SetSavePeriod(int64_t period);
 
+    // Без исполнителя сессии обновляются последовательно в вызывающем потоке
+    void SetTickExecutor(TaskRunner runner, unsigned concurrency);
+
+    void SetTickListener(TickListener listener);
+
+    // Моделирование шагами фиксированной длины step мс. Update выполняет
+    // не больше max_substeps шагов за вызов, остаток времени переносится
+    // на следующий вызов. Без фиксированного шага тик равен time_delta
+    void SetFixedTimestep(std::int64_t step, unsigned max_substeps);
+    std::optional<std::int64_t> GetFixedTimestep() const;
+
     void Update(std::int64_t time_delta);
 
-    void SaveState() const;
+    // Продвигает игру на time_delta за один тик без ограничения числа
+    // шагов. Снимки, сохранение и слушатель тика обрабатываются один раз
+    void FastForward(std::int64_t time_delta);
+
+    // Продвигает моделирование сессии на time_delta, не публикуя снимок.
+    // Временные данные размещаются в арене потока и освобождаются до
+    // возврата. Возвращает идентификаторы собак, ушедших на покой.
+    // Если в сессии никто не движется и лут появиться не может, тик
+    // сводится к ходу часов и уходу собак на покой
+    std::vector<std::uint32_t> Simulate(
+        std::shared_ptr<GameSession>& session,
+        std::int64_t time_delta);
+
+    // Номер последнего выполненного тика; монотонно растёт с запуска
+    std::uint64_t GetTick() const;
+
+    // Записывает состояние синхронно, дождавшись окончания фоновой
+    // записи. Периодические сохранения в тике пишутся в фоне
+    void SaveState();
 
     void LoadState();
 
+    // Публикует снимок сессии вне тика, например после входа игрока
+    void RefreshSnapshot(const std::shared_ptr<GameSession>& session) const;
+
     void SetDogRetirementTime(double retirement_time_seconds);
     double GetDogRetirementTime() const;
 
@@ -379,15 +1001,42 @@ public:
 private:
     using MapIdToIndex = std::unordered_map<Map::Id, size_t, MapIdHasher>;
 
+    // Выполняет substeps шагов длиной step во всех сессиях и публикует
+    // их снимки
+    void RunTick(std::int64_t step, std::uint64_t substeps);
+
+    std::vector<std::uint32_t> UpdateSession(
+        std::shared_ptr<GameSession>& session,
+        std::int64_t step,
+        std::uint64_t substeps,
+        std::uint64_t tick,
+        const GameSession::PlayerIdByDog& player_ids);
+
+    // Перемещает движущиеся собаки moving; k-й собиратель провайдера -
+    // собака moving[k]. frame - память временных данных тика
     void UpdateDogsPosition(
         std::shared_ptr<GameSession>& session,
         std::int64_t time_delta,
-        collision_detector::GathererProvider& gatherer_provider);
-
+        std::span<const std::uint32_t> moving,
+        collision_detector::GathererProvider& gatherer_provider,
+        std::pmr::memory_resource* frame);
+
+    // Паркует собаку, стоящую с момента idle_since, и ставит срок её
+    // ухода на покой
+    void ParkDog(GameSession& session, size_t index, double idle_since) const;
+    // Ставит срок ухода на покой собаки, стоящей с idle_since, для стоянки
+    // с номером token
+    void ScheduleRetirement(
+        GameSession& session,
+        size_t index,
+        std::uint64_t token) const;
+
+    // Положение index-й собаки хранилища после перемещения к target_pos
     PointBG CalculateNewDogPosition(
-        std::shared_ptr<Dog>& dog,
-        double time_delta,
-        const Map::RoadRTree& roads);
+        DogStore& dogs,
+        size_t index,
+        const PointBG& target_pos,
+        const Map& map);
 
     PointBG GetStopPointForDirection(
         const PointBG& pos,
@@ -399,23 +1048,67 @@ private:
     PointBG FindStopPoint(const PointBG& from, const PointBG& to, 
                             const Road& road, DIRECTION dir) const;
 
-    void UpdateLoot(
+    // Возвращает лут, появившийся за тик. frame - память временных
+    // данных тика
+    std::pmr::vector<std::shared_ptr<Loot>> UpdateLoot(
         std::shared_ptr<GameSession>& session,
-        std::int64_t time_delta);
+        std::int64_t time_delta,
+        std::pmr::memory_resource* frame);
+
+    // Строит планы движения собак, получивших команды или ещё не
+    // имеющих плана, и планирует их события
+    void PlanDogMotions(
+        GameSession& session,
+        std::span<const std::uint32_t> commanded_dogs,
+        std::pmr::memory_resource* frame);
+
+    void PlanDogMotion(
+        GameSession& session,
+        size_t index,
+        std::span<const std::shared_ptr<Loot>> loot,
+        std::pmr::memory_resource* frame);
+
+    // Дальняя точка полосы дорог, до которой собака доедет из pos,
+    // двигаясь в направлении dir без остановки
+    PointBG FindReachablePoint(
+        const Map& map,
+        const PointBG& pos,
+        DIRECTION dir) const;
 
-    void AddLootToGathererProvider(
-        std::shared_ptr<GameSession>& session,
-        collision_detector::GathererProvider& gatherer_provider) const;
+    void ScheduleLootContact(
+        GameSession& session,
+        size_t index,
+        const Loot& loot) const;
+
+    // Проверяет новый лут на оставшихся путях движущихся собак
+    void ScheduleLootContacts(
+        GameSession& session,
+        std::span<const std::shared_ptr<Loot>> new_loot,
+        std::pmr::memory_resource* frame) const;
 
-    void AddOfficesToGathererProvider(
+    // Обрабатывает события до текущего показания часов DogStore и
+    // вычисляет положения собак на конец тика
+    void ProcessKinematicEvents(
+        GameSession& session,
+        std::pmr::memory_resource* frame) const;
+
+    void AddLootToGathererProvider(
         std::shared_ptr<GameSession>& session,
         collision_detector::GathererProvider& gatherer_provider) const;
 
+    // gatherer_dogs[k] - номер собаки k-го собирателя провайдера
     void GatherLoot(
         std::shared_ptr<GameSession>& session,
-        collision_detector::GathererProvider&& gatherer_provider) const;
+        collision_detector::GathererProvider&& gatherer_provider,
+        std::span<const std::uint32_t> gatherer_dogs,
+        std::pmr::memory_resource* frame) const;
+
+    // Отправляет на покой собак, у которых истёк срок простоя
+    std::vector<std::uint32_t> RemoveInactiveDogs(
+        std::shared_ptr<GameSession>& session);
 
-    void RemoveInactiveDogs(std::shared_ptr<GameSession>& session);
+    // Копирует состояние сессий и игроков; сессии копируются параллельно
+    serialization::GameStateRepr CaptureState() const;
     std::chrono::milliseconds GetTestTime();
     std::chrono::milliseconds GetRealTime();
 
@@ -423,16 +1116,30 @@ private:
     MapIdToIndex map_id_to_index_;
     GAME_MODE game_mode_;
     SPAWN_MODE dog_spawn_mode_;
+    KINEMATICS_MODE kinematics_mode_{FIXED_STEP};
+    std::optional<std::int64_t> fixed_step_;
+    unsigned max_substeps_{1};
+    std::int64_t pending_step_time_{0};
     std::unique_ptr<loot_gen::LootGenerator> loot_generator_;
     std::unique_ptr<extra_data::LootTypesStorage> loot_types_storage_;
     std::string save_file_path_;
     std::chrono::milliseconds save_interval_;
     std::chrono::milliseconds save_test_timer_;
     bool save_enabled_{false};
+    serialization::StateFormat state_format_{};
+    std::unique_ptr<serialization::StateWriter> state_writer_;
     double dog_retirement_time_seconds_{DEFAULT_RETIREMENT_TIME};
     std::shared_ptr<database::ConnectionPool> pool_;
     std::chrono::steady_clock::time_point start_time_;
     std::chrono::milliseconds accumulated_time_{0};
+    std::uint32_t session_counter_{0};
+    std::shared_ptr<util::PoolResource> player_pool_;
+    size_t loot_pool_capacity_{DEFAULT_LOOT_POOL_CAPACITY};
+    std::unique_ptr<app::Players> players_;
+    TaskRunner tick_runner_;
+    unsigned tick_concurrency_{1};
+    std::uint64_t tick_{0};
+    TickListener tick_listener_;
 
     std::unordered_map<
         Map::Id,
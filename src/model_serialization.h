@@ -1,13 +1,21 @@
 // model_serialization.h
+#pragma once
+
+#include <boost/serialization/library_version_type.hpp>
 #include <boost/serialization/list.hpp>
 #include <boost/serialization/shared_ptr.hpp>
+#include <boost/serialization/string.hpp>
 #include <boost/serialization/unordered_map.hpp>
 #include <boost/serialization/utility.hpp>
 #include <boost/serialization/vector.hpp>
+#include <boost/serialization/version.hpp>
 
 #include "application.h"
 #include "model.h"
 
+#include <stdexcept>
+#include <string>
+
 namespace geom {
 
 template <typename Archive>
@@ -39,18 +47,20 @@ public:
         , id_(loot.GetId())
         , value_(loot.GetValue())
         , position_(loot.GetPosition())
-        , width_(loot.GetWidth())
-        , loot_counter_(model::Loot::GetLootCounter()) {
+        , width_(loot.GetWidth()) {
     }
 
     model::Loot Restore() const {
         model::Loot loot(type_, position_, value_);
         loot.SetId(id_);
         loot.SetWidth(width_);
-        model::Loot::SetLootCounter(loot_counter_);
         return loot;
     }
 
+    std::uint32_t GetId() const {
+        return id_;
+    }
+
     template <typename Archive>
     void serialize(Archive& ar, const unsigned version) {
         ar& type_;
@@ -58,7 +68,11 @@ public:
         ar& value_;
         ar& position_;
         ar& width_;
-        ar& loot_counter_;
+        if (version == 0) {
+            // Старый формат хранил копию глобального счётчика лута
+            std::uint32_t legacy_loot_counter = 0;
+            ar& legacy_loot_counter;
+        }
     }
 
 private:
@@ -67,7 +81,6 @@ private:
     std::uint32_t value_;
     geom::Point2D position_;
     double width_;
-    std::uint32_t loot_counter_;
 };
 
 // DogRepr (DogRepresentation) - сериализованное представление класса Dog
@@ -83,7 +96,6 @@ public:
         , direction_(dog.GetDirection())
         , width_(dog.GetWidth())
         , score_(dog.GetScore())
-        , dog_counter_(model::Dog::GetDogCounter())
     {
         for (const auto& loot_ptr : dog.GetLoot()) {
             if (loot_ptr) {
@@ -107,11 +119,18 @@ public:
 
         dog.SetWidth(width_);
         dog.SetScore(score_);
-        model::Dog::SetDogCounter(dog_counter_);
 
         return dog;
     }
 
+    std::uint32_t GetId() const {
+        return id_;
+    }
+
+    const std::vector<std::shared_ptr<LootRepr>>& GetBag() const {
+        return bag_;
+    }
+
     template <typename Archive>
     void serialize(Archive& ar, [[maybe_unused]] const unsigned version) {
         ar& id_;
@@ -122,7 +141,11 @@ public:
         ar& bag_;
         ar& width_;
         ar& score_;
-        ar& dog_counter_;
+        if (version == 0) {
+            // Старый формат хранил копию глобального счётчика собак
+            std::uint32_t legacy_dog_counter = 0;
+            ar& legacy_dog_counter;
+        }
     }
 
 private:
@@ -134,7 +157,6 @@ private:
     std::vector<std::shared_ptr<LootRepr>> bag_;
     double width_;
     std::uint32_t score_;
-    std::uint32_t dog_counter_;
 };
 
 class GameSessionRepr {
@@ -144,7 +166,8 @@ public:
     explicit GameSessionRepr(const model::GameSession& session)
         : map_id_(*session.GetMap()->GetId())
         , session_id_(session.GetId())
-        , session_counter_(model::GameSession::GetSessionCounter())
+        , dog_counter_(session.GetDogCounter())
+        , loot_counter_(session.GetLootCounter())
     {
         for (const auto& dog_ptr : session.GetDogs()) {
             if (dog_ptr) {
@@ -159,14 +182,34 @@ public:
         }
     }
 
+    const std::string& GetMapId() const {
+        return map_id_;
+    }
+
     [[nodiscard]] model::GameSession Restore(const model::Game& game) const {
         
-        model::GameSession session{game.FindMap(model::Map::Id(map_id_))};
+        model::GameSession session{
+            game.FindMap(model::Map::Id(map_id_)), session_id_,
+            game.GetLootPoolCapacity()};
+
+        // В старом формате счётчики были глобальными и не сохранялись
+        // вместе с сессией, поэтому восстанавливаем их не ниже
+        // максимального использованного идентификатора
+        std::uint32_t dog_counter = dog_counter_;
+        std::uint32_t loot_counter = loot_counter_;
 
         for (const auto& dog_repr_ptr : dogs_) {
             if (dog_repr_ptr) {
                 auto dog = dog_repr_ptr->Restore();
                 session.AddDog(std::make_shared<model::Dog>(dog));
+                dog_counter = std::max(dog_counter, dog_repr_ptr->GetId() + 1);
+
+                for (const auto& loot_repr_ptr : dog_repr_ptr->GetBag()) {
+                    if (loot_repr_ptr) {
+                        loot_counter = std::max(
+                            loot_counter, loot_repr_ptr->GetId() + 1);
+                    }
+                }
             }
         }
 
@@ -174,23 +217,29 @@ public:
             if (loot_repr_ptr) {
                 auto loot = loot_repr_ptr->Restore();
                 session.AddLoot(std::make_shared<model::Loot>(loot));
+                loot_counter = std::max(loot_counter, loot_repr_ptr->GetId() + 1);
             }
         }
 
-        session.SetId(session_id_);
-
-        model::GameSession::SetSessionCounter(session_counter_);
+        session.SetDogCounter(dog_counter);
+        session.SetLootCounter(loot_counter);
 
         return session;
     }
 
     template <typename Archive>
-    void serialize(Archive& ar, [[maybe_unused]] const unsigned version) {
+    void serialize(Archive& ar, const unsigned version) {
         ar& map_id_;
         ar& dogs_;
         ar& loot_;
         ar& session_id_;
-        ar& session_counter_;
+        if (version == 0) {
+            std::uint32_t legacy_session_counter = 0;
+            ar& legacy_session_counter;
+        } else {
+            ar& dog_counter_;
+            ar& loot_counter_;
+        }
     }
 
 private:
@@ -198,7 +247,8 @@ private:
     std::vector<std::shared_ptr<DogRepr>> dogs_;
     std::list<std::shared_ptr<LootRepr>> loot_;
     std::uint32_t session_id_;
-    std::uint32_t session_counter_;
+    std::uint32_t dog_counter_ = 0;
+    std::uint32_t loot_counter_ = 0;
 };
 
 class PlayerRepr {
@@ -207,35 +257,49 @@ public:
 
     explicit PlayerRepr(const app::Player& player) 
         : session_id_(player.GetSession()->GetId())
-        , dog_id_(player.GetDog()->GetId())
+        , dog_id_(player.GetDogId())
         , token_(*player.GetToken())
-        , id_(player.GetId())
-        , player_counter_(app::Player::GetPlayerCounter()) {
+        , id_(player.GetId()) {
     }
 
-    [[nodiscard]] app::Player Restore(const model::Game& game) const {
+    std::uint32_t GetSessionId() const {
+        return session_id_;
+    }
 
-        std::shared_ptr<model::GameSession> session_ptr =
-            game.FindSessionById(session_id_);
+    // session - восстановленная сессия с идентификатором GetSessionId().
+    // Если в ней нет собаки игрока, бросает std::runtime_error
+    [[nodiscard]] app::Player Restore(
+        const std::shared_ptr<model::GameSession>& session_ptr) const
+    {
+        if (!session_ptr || session_ptr->GetId() != session_id_) {
+            throw std::runtime_error("Unknown session of player "
+                                     + std::to_string(id_));
+        }
 
         std::shared_ptr<model::Dog> dog_ptr = session_ptr->GetDogById(dog_id_);
+        if (!dog_ptr) {
+            throw std::runtime_error("Unknown dog of player "
+                                     + std::to_string(id_));
+        }
 
         app::Player player{session_ptr, dog_ptr};
 
         player.SetToken(app::Token(token_));
         player.SetId(id_);
-        app::Player::SetPlayerCounter(player_counter_);
 
         return player;
     }
 
     template <typename Archive>
-    void serialize(Archive& ar, [[maybe_unused]] const unsigned version) {
+    void serialize(Archive& ar, const unsigned version) {
         ar& session_id_;
         ar& dog_id_;
         ar& token_;
         ar& id_;
-        ar& player_counter_;
+        if (version == 0) {
+            std::uint32_t legacy_player_counter = 0;
+            ar& legacy_player_counter;
+        }
     }
 
 private:
@@ -243,7 +307,24 @@ private:
     uint32_t dog_id_;
     std::string token_;
     uint32_t id_;
-    std::uint32_t player_counter_;
+};
+
+// Копия состояния игры. Не ссылается на объекты игры, поэтому может
+// кодироваться и декодироваться в любом потоке
+struct GameStateRepr {
+    std::vector<GameSessionRepr> sessions;
+    std::vector<PlayerRepr> players;
+    // Номер тика и накопленное время неполного шага фиксированного
+    // шага. Клиенты запрашивают изменения по номеру тика, поэтому он
+    // продолжается после перезапуска
+    std::uint64_t tick = 0;
+    std::int64_t pending_step_time = 0;
 };
 
 }  // namespace serialization
+
+// Версия 1: счётчики идентификаторов принадлежат сессиям и реестру игроков
+BOOST_CLASS_VERSION(::serialization::LootRepr, 1)
+BOOST_CLASS_VERSION(::serialization::DogRepr, 1)
+BOOST_CLASS_VERSION(::serialization::GameSessionRepr, 1)
+BOOST_CLASS_VERSION(::serialization::PlayerRepr, 1)
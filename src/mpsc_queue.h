@@ -0,0 +1,70 @@
+// mpsc_queue.h
+#pragma once
+
+#include <atomic>
+#include <utility>
+
+namespace util {
+
+/*
+ *  Неблокирующая очередь с несколькими производителями и одним потребителем.
+ *  Производители добавляют элементы из любых потоков без блокировок,
+ *  потребитель забирает сразу все накопленные элементы
+ */
+template <typename T>
+class MpscQueue {
+public:
+    MpscQueue() = default;
+
+    // Копия очереди пуста: ожидающие элементы не являются частью состояния
+    // владельца и обрабатываются только исходной очередью
+    MpscQueue(const MpscQueue&) noexcept {
+    }
+
+    MpscQueue& operator=(const MpscQueue&) noexcept {
+        return *this;
+    }
+
+    ~MpscQueue() {
+        DrainNewestFirst([](T&&) {});
+    }
+
+    void Push(T value) {
+        Node* node = new Node{
+            std::move(value),
+            head_.load(std::memory_order_relaxed)};
+        while (!head_.compare_exchange_weak(
+            node->next, node,
+            std::memory_order_release,
+            std::memory_order_relaxed))
+        {
+        }
+    }
+
+    bool Empty() const {
+        return head_.load(std::memory_order_acquire) == nullptr;
+    }
+
+    // Забирает все элементы и передаёт их в fn, начиная с добавленного
+    // последним. Вызывается только из потока-потребителя
+    template <typename Fn>
+    void DrainNewestFirst(Fn&& fn) {
+        Node* node = head_.exchange(nullptr, std::memory_order_acquire);
+        while (node) {
+            Node* next = node->next;
+            fn(std::move(node->value));
+            delete node;
+            node = next;
+        }
+    }
+
+private:
+    struct Node {
+        T value;
+        Node* next;
+    };
+
+    std::atomic<Node*> head_{nullptr};
+};
+
+}  // namespace util
@@ -0,0 +1,108 @@
+// object_pool.h
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <memory_resource>
+#include <utility>
+
+namespace util {
+
+// Размер управляющего блока std::allocate_shared сверх самого объекта:
+// счётчики ссылок, указатель на таблицу виртуальных функций и аллокатор
+constexpr size_t SHARED_CONTROL_BLOCK_SIZE = 32;
+constexpr size_t MIN_POOL_BUFFER_SIZE = 4096;
+
+/*
+ *  Пул памяти для объектов, которые часто создаются и удаляются.
+ *  Освобождённые блоки возвращаются в списки пула и используются
+ *  повторно, не обращаясь к общей куче. Первые блоки берутся из буфера,
+ *  страницы которого заполняются при создании пула, поэтому первые
+ *  объекты не вызывают страничных отказов. Когда буфер исчерпан, пул
+ *  берёт память у кучи и тоже больше её не возвращает
+ */
+class PoolResource {
+public:
+    explicit PoolResource(size_t prefault_bytes)
+        : buffer_size_{std::max(prefault_bytes, MIN_POOL_BUFFER_SIZE)}
+        , buffer_{std::make_unique_for_overwrite<std::byte[]>(buffer_size_)}
+        , arena_{Prefault(buffer_.get(), buffer_size_), buffer_size_}
+        , pool_{&arena_} {
+    }
+
+    PoolResource(const PoolResource&) = delete;
+    PoolResource& operator=(const PoolResource&) = delete;
+
+    std::pmr::memory_resource* Get() noexcept {
+        return &pool_;
+    }
+
+    // Размер буфера для count объектов T, создаваемых через MakePooled
+    template <typename T>
+    static constexpr size_t BytesFor(size_t count) noexcept {
+        return count * (sizeof(T) + SHARED_CONTROL_BLOCK_SIZE);
+    }
+
+private:
+    static std::byte* Prefault(std::byte* buffer, size_t size) noexcept {
+        std::memset(buffer, 0, size);
+        return buffer;
+    }
+
+    size_t buffer_size_;
+    std::unique_ptr<std::byte[]> buffer_;
+    std::pmr::monotonic_buffer_resource arena_;
+    // Объекты из пулов сессий могут освобождаться в потоках тика и
+    // в strand, поэтому пул синхронизирован
+    std::pmr::synchronized_pool_resource pool_;
+};
+
+// Аллокатор для std::allocate_shared. Управляющий блок хранит копию
+// аллокатора, поэтому пул живёт, пока жив хотя бы один его объект
+template <typename T>
+class PoolAllocator {
+public:
+    using value_type = T;
+
+    explicit PoolAllocator(std::shared_ptr<PoolResource> pool) noexcept
+        : pool_{std::move(pool)} {
+    }
+
+    template <typename U>
+    PoolAllocator(const PoolAllocator<U>& other) noexcept
+        : pool_{other.pool_} {
+    }
+
+    T* allocate(size_t n) {
+        return static_cast<T*>(
+            pool_->Get()->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* p, size_t n) noexcept {
+        pool_->Get()->deallocate(p, n * sizeof(T), alignof(T));
+    }
+
+    template <typename U>
+    bool operator==(const PoolAllocator<U>& other) const noexcept {
+        return pool_ == other.pool_;
+    }
+
+private:
+    template <typename U>
+    friend class PoolAllocator;
+
+    std::shared_ptr<PoolResource> pool_;
+};
+
+template <typename T, typename... Args>
+std::shared_ptr<T> MakePooled(
+    const std::shared_ptr<PoolResource>& pool,
+    Args&&... args)
+{
+    return std::allocate_shared<T>(
+        PoolAllocator<T>{pool}, std::forward<Args>(args)...);
+}
+
+}  // namespace util
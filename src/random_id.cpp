@@ -0,0 +1,128 @@
+// random_id.cpp
+#include "random_id.h"
+
+#include <algorithm>
+#include <cstring>
+#include <random>
+
+namespace util {
+
+namespace {
+
+// Идентификаторов в пакете; пакет заполняется за один проход шифра
+constexpr size_t ID_BATCH_SIZE = 256;
+
+constexpr std::uint32_t RotateLeft(std::uint32_t value, int shift) {
+    return (value << shift) | (value >> (32 - shift));
+}
+
+constexpr void QuarterRound(
+    std::uint32_t& a, std::uint32_t& b, std::uint32_t& c, std::uint32_t& d)
+{
+    a += b; d ^= a; d = RotateLeft(d, 16);
+    c += d; b ^= c; b = RotateLeft(b, 12);
+    a += b; d ^= a; d = RotateLeft(d, 8);
+    c += d; b ^= c; b = RotateLeft(b, 7);
+}
+
+/*
+ *  Поток ключей ChaCha20 (RFC 8439, вариант с 64-битным счётчиком
+ *  блоков). Ключ и одноразовое число берутся из std::random_device
+ */
+class ChaCha20 {
+public:
+    static constexpr size_t BLOCK_SIZE = 64;
+
+    ChaCha20() {
+        std::random_device device;
+        // "expand 32-byte k"
+        state_[0] = 0x61707865;
+        state_[1] = 0x3320646e;
+        state_[2] = 0x79622d32;
+        state_[3] = 0x6b206574;
+        for (size_t i = 4; i < 12; ++i) {
+            state_[i] = device();
+        }
+        state_[12] = 0;
+        state_[13] = 0;
+        state_[14] = device();
+        state_[15] = device();
+    }
+
+    // Размер out кратен BLOCK_SIZE
+    void Generate(std::span<std::uint8_t> out) {
+        for (size_t offset = 0; offset < out.size(); offset += BLOCK_SIZE) {
+            std::array<std::uint32_t, 16> block = state_;
+            for (int round = 0; round < 10; ++round) {
+                QuarterRound(block[0], block[4], block[8], block[12]);
+                QuarterRound(block[1], block[5], block[9], block[13]);
+                QuarterRound(block[2], block[6], block[10], block[14]);
+                QuarterRound(block[3], block[7], block[11], block[15]);
+                QuarterRound(block[0], block[5], block[10], block[15]);
+                QuarterRound(block[1], block[6], block[11], block[12]);
+                QuarterRound(block[2], block[7], block[8], block[13]);
+                QuarterRound(block[3], block[4], block[9], block[14]);
+            }
+            for (size_t i = 0; i < block.size(); ++i) {
+                block[i] += state_[i];
+            }
+            // Байты слов не переставляются: порядок байтов для случайных
+            // данных не важен
+            std::memcpy(out.data() + offset, block.data(), BLOCK_SIZE);
+
+            if (++state_[12] == 0) {
+                ++state_[13];
+            }
+        }
+    }
+
+private:
+    std::array<std::uint32_t, 16> state_;
+};
+
+struct IdBatch {
+    ChaCha20 cipher;
+    std::array<RandomId, ID_BATCH_SIZE> ids;
+    size_t next = ID_BATCH_SIZE;
+};
+
+static_assert(sizeof(std::array<RandomId, ID_BATCH_SIZE>) %
+              ChaCha20::BLOCK_SIZE == 0);
+
+// Пары шестнадцатеричных цифр для каждого значения байта
+constexpr auto HEX_PAIRS = [] {
+    constexpr char DIGITS[] = "0123456789abcdef";
+    std::array<std::array<char, 2>, 256> pairs{};
+    for (size_t i = 0; i < pairs.size(); ++i) {
+        pairs[i] = {DIGITS[i >> 4], DIGITS[i & 0xf]};
+    }
+    return pairs;
+}();
+
+}  // namespace
+
+RandomId NewRandomId() {
+    thread_local IdBatch batch;
+    if (batch.next == batch.ids.size()) {
+        batch.cipher.Generate(std::span{
+            reinterpret_cast<std::uint8_t*>(batch.ids.data()),
+            sizeof(batch.ids)});
+        batch.next = 0;
+    }
+
+    // Выданный идентификатор стирается из пакета
+    RandomId id = batch.ids[batch.next];
+    batch.ids[batch.next++] = {};
+    return id;
+}
+
+std::string ToHex(std::span<const std::uint8_t> bytes) {
+    std::string result(bytes.size() * 2, '\0');
+    char* out = result.data();
+    for (std::uint8_t byte : bytes) {
+        out = std::copy_n(HEX_PAIRS[byte].data(), 2, out);
+    }
+    return result;
+}
+
+}  // namespace util
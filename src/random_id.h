@@ -0,0 +1,22 @@
+// random_id.h
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <string>
+
+namespace util {
+
+using RandomId = std::array<std::uint8_t, 16>;
+
+// Криптостойкий случайный идентификатор. Каждый поток хранит своё
+// состояние ChaCha20, ключ которого читается из std::random_device при
+// первом обращении, и выдаёт идентификаторы из заранее заполненного
+// пакета. Обращения к ОС и синхронизация на выдачу не нужны
+RandomId NewRandomId();
+
+// Шестнадцатеричная запись байтов строчными цифрами
+std::string ToHex(std::span<const std::uint8_t> bytes);
+
+}  // namespace util
@@ -185,7 +185,11 @@ void RequestHandler::operator()(
     auto keep_alive = req.keep_alive();
 
     try {
-        if (target.starts_with(API_PATH)) {
+        if (target.starts_with(API_PATH) &&
+            !ApiRequestHandler::RequiresStrand(target))
+        {
+            send(api_handler_.Handle(std::forward<decltype(req)>(req)));
+        } else if (target.starts_with(API_PATH)) {
             value custom_data{
                 {"status"s, "start"},
                 {"code", 0},
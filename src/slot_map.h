@@ -0,0 +1,132 @@
+// slot_map.h
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace util {
+
+/*
+ *  Контейнер со стабильными ключами. Значения лежат в плотном массиве и
+ *  обходятся без косвенных переходов, ключ указывает на слот. Поколение
+ *  слота растёт при каждом удалении, поэтому ключ удалённого значения
+ *  не совпадает с ключом значения, занявшего тот же слот позже.
+ *  Вставка, поиск и удаление по ключу выполняются за O(1); при удалении
+ *  на место значения переносится последнее, и порядок обхода меняется
+ */
+template <typename T>
+class SlotMap {
+public:
+    struct Key {
+        std::uint32_t slot;
+        std::uint32_t generation;
+
+        bool operator==(const Key&) const = default;
+    };
+
+    Key Insert(T value) {
+        std::uint32_t slot;
+        if (!free_slots_.empty()) {
+            slot = free_slots_.back();
+            free_slots_.pop_back();
+        } else {
+            slot = static_cast<std::uint32_t>(slots_.size());
+            slots_.push_back({});
+        }
+
+        slots_[slot].dense = static_cast<std::uint32_t>(values_.size());
+        values_.push_back(std::move(value));
+        slot_by_dense_.push_back(slot);
+
+        return Key{slot, slots_[slot].generation};
+    }
+
+    bool Contains(Key key) const noexcept {
+        return key.slot < slots_.size() &&
+               slots_[key.slot].generation == key.generation &&
+               slots_[key.slot].dense != NO_VALUE;
+    }
+
+    T* Find(Key key) noexcept {
+        return Contains(key) ? &values_[slots_[key.slot].dense] : nullptr;
+    }
+
+    const T* Find(Key key) const noexcept {
+        return Contains(key) ? &values_[slots_[key.slot].dense] : nullptr;
+    }
+
+    T Erase(Key key) {
+        if (!Contains(key)) {
+            throw std::out_of_range("Invalid slot map key");
+        }
+
+        Slot& slot = slots_[key.slot];
+        const std::uint32_t dense = slot.dense;
+        T result = std::move(values_[dense]);
+
+        const std::uint32_t last =
+            static_cast<std::uint32_t>(values_.size() - 1);
+        if (dense != last) {
+            values_[dense] = std::move(values_[last]);
+            slot_by_dense_[dense] = slot_by_dense_[last];
+            slots_[slot_by_dense_[dense]].dense = dense;
+        }
+        values_.pop_back();
+        slot_by_dense_.pop_back();
+
+        slot.dense = NO_VALUE;
+        ++slot.generation;
+        free_slots_.push_back(key.slot);
+
+        return result;
+    }
+
+    // Ключ значения, стоящего на месте index при обходе
+    Key KeyAt(size_t index) const {
+        const std::uint32_t slot = slot_by_dense_.at(index);
+        return Key{slot, slots_[slot].generation};
+    }
+
+    size_t Size() const noexcept {
+        return values_.size();
+    }
+
+    bool Empty() const noexcept {
+        return values_.empty();
+    }
+
+    void Reserve(size_t size) {
+        values_.reserve(size);
+        slot_by_dense_.reserve(size);
+        slots_.reserve(size);
+    }
+
+    // Представления действительны до следующей вставки или удаления
+    std::span<T> Values() noexcept {
+        return values_;
+    }
+
+    std::span<const T> Values() const noexcept {
+        return values_;
+    }
+
+private:
+    static constexpr std::uint32_t NO_VALUE =
+        std::numeric_limits<std::uint32_t>::max();
+
+    struct Slot {
+        std::uint32_t dense{NO_VALUE};
+        std::uint32_t generation{0};
+    };
+
+    std::vector<T> values_;
+    std::vector<std::uint32_t> slot_by_dense_;
+    std::vector<Slot> slots_;
+    std::vector<std::uint32_t> free_slots_;
+};
+
+}  // namespace util
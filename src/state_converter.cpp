@@ -0,0 +1,31 @@
+// state_converter.cpp
+#include "state_writer.h"
+
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string_view>
+
+using namespace std::literals;
+
+// Переводит файл состояния игры в заданный формат:
+//     state_converter <text|binary> <входной файл> <выходной файл>
+// Формат входного файла определяется по его заголовку
+int main(int argc, const char* argv[]) {
+    if (argc != 4 || (argv[1] != "text"sv && argv[1] != "binary"sv)) {
+        std::cerr << "Usage: state_converter <text|binary> <input> <output>"
+                  << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    try {
+        const auto format = argv[1] == "binary"sv
+            ? serialization::StateFormat::BINARY
+            : serialization::StateFormat::TEXT;
+        serialization::WriteStateFile(
+            argv[3], serialization::ReadStateFile(argv[2]), format);
+    } catch (const std::exception& ex) {
+        std::cerr << ex.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+}
@@ -0,0 +1,470 @@
+// state_snapshot.cpp
+#include "state_snapshot.h"
+
+#include "binary_format.h"
+
+#include <array>
+#include <list>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+namespace serialization {
+
+namespace {
+
+constexpr auto CRC32_TABLE = [] {
+    std::array<std::uint32_t, 256> table{};
+    for (std::uint32_t i = 0; i < table.size(); ++i) {
+        std::uint32_t crc = i;
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc >> 1) ^ ((crc & 1) ? 0xEDB88320u : 0u);
+        }
+        table[i] = crc;
+    }
+    return table;
+}();
+
+std::uint32_t Crc32(std::string_view data) {
+    std::uint32_t crc = 0xFFFFFFFFu;
+    for (char c : data) {
+        crc = CRC32_TABLE[(crc ^ static_cast<std::uint8_t>(c)) & 0xFF] ^
+              (crc >> 8);
+    }
+    return ~crc;
+}
+
+// Каждая строка записывается в таблицу один раз
+class StringTable {
+public:
+    std::uint32_t Intern(const std::string& value) {
+        auto [it, inserted] = index_.try_emplace(
+            value, static_cast<std::uint32_t>(strings_.size()));
+        if (inserted) {
+            strings_.push_back(&it->first);
+        }
+        return it->second;
+    }
+
+    void Write(binary_format::Writer& writer) const {
+        writer.WriteU32(static_cast<std::uint32_t>(strings_.size()));
+        for (const std::string* value : strings_) {
+            writer.WriteString(*value);
+        }
+    }
+
+private:
+    std::unordered_map<std::string, std::uint32_t> index_;
+    std::vector<const std::string*> strings_;
+};
+
+template <typename T>
+std::uint32_t VersionOf(const ReprVersions& versions) {
+    if constexpr (std::is_same_v<T, LootRepr>) {
+        return versions.loot;
+    } else if constexpr (std::is_same_v<T, DogRepr>) {
+        return versions.dog;
+    } else if constexpr (std::is_same_v<T, GameSessionRepr>) {
+        return versions.session;
+    } else {
+        static_assert(std::is_same_v<T, PlayerRepr>);
+        return versions.player;
+    }
+}
+
+/*
+ *  Архивы записывают и читают представления через их функции serialize,
+ *  поэтому порядок полей совпадает с текстовым форматом. Представлениям
+ *  передаётся версия, записанная в секцию Section::VERSIONS
+ */
+class BinaryOArchive {
+public:
+    BinaryOArchive(
+        binary_format::Writer& writer,
+        StringTable& strings,
+        const ReprVersions& versions)
+        : writer_{writer}
+        , strings_{strings}
+        , versions_{versions} {
+    }
+
+    template <typename T>
+    BinaryOArchive& operator&(const T& value) {
+        Save(value);
+        return *this;
+    }
+
+private:
+    void Save(std::uint32_t value) {
+        writer_.WriteU32(value);
+    }
+
+    void Save(double value) {
+        writer_.WriteF64(value);
+    }
+
+    void Save(const std::string& value) {
+        writer_.WriteU32(strings_.Intern(value));
+    }
+
+    void Save(model::DIRECTION value) {
+        writer_.WriteU8(
+            static_cast<std::uint8_t>(binary_format::ToBinary(value)));
+    }
+
+    void Save(const geom::Point2D& value) {
+        writer_.WriteF64(value.x);
+        writer_.WriteF64(value.y);
+    }
+
+    void Save(const geom::Vec2D& value) {
+        writer_.WriteF64(value.x);
+        writer_.WriteF64(value.y);
+    }
+
+    template <typename T>
+    void Save(const std::shared_ptr<T>& value) {
+        if (!value) {
+            throw std::logic_error("Null pointer in game state");
+        }
+        Save(*value);
+    }
+
+    template <typename T>
+    void Save(const std::vector<T>& values) {
+        SaveItems(values);
+    }
+
+    template <typename T>
+    void Save(const std::list<T>& values) {
+        SaveItems(values);
+    }
+
+    template <typename T>
+    void Save(const T& repr) {
+        const_cast<T&>(repr).serialize(*this, VersionOf<T>(versions_));
+    }
+
+    template <typename Container>
+    void SaveItems(const Container& values) {
+        writer_.WriteU32(static_cast<std::uint32_t>(values.size()));
+        for (const auto& value : values) {
+            Save(value);
+        }
+    }
+
+    binary_format::Writer& writer_;
+    StringTable& strings_;
+    const ReprVersions& versions_;
+};
+
+class BinaryIArchive {
+public:
+    BinaryIArchive(
+        binary_format::Reader& reader,
+        const std::vector<std::string>& strings,
+        const ReprVersions& versions)
+        : reader_{reader}
+        , strings_{strings}
+        , versions_{versions} {
+    }
+
+    template <typename T>
+    BinaryIArchive& operator&(T& value) {
+        Load(value);
+        return *this;
+    }
+
+private:
+    void Load(std::uint32_t& value) {
+        value = reader_.ReadU32();
+    }
+
+    void Load(double& value) {
+        value = reader_.ReadF64();
+    }
+
+    void Load(std::string& value) {
+        const std::uint32_t index = reader_.ReadU32();
+        if (index >= strings_.size()) {
+            throw std::runtime_error("Invalid string index in game state");
+        }
+        value = strings_[index];
+    }
+
+    void Load(model::DIRECTION& value) {
+        value = binary_format::FromBinary(
+            static_cast<binary_format::Direction>(reader_.ReadU8()));
+    }
+
+    void Load(geom::Point2D& value) {
+        value.x = reader_.ReadF64();
+        value.y = reader_.ReadF64();
+    }
+
+    void Load(geom::Vec2D& value) {
+        value.x = reader_.ReadF64();
+        value.y = reader_.ReadF64();
+    }
+
+    template <typename T>
+    void Load(std::shared_ptr<T>& value) {
+        value = std::make_shared<T>();
+        Load(*value);
+    }
+
+    template <typename T>
+    void Load(std::vector<T>& values) {
+        LoadItems(values);
+    }
+
+    template <typename T>
+    void Load(std::list<T>& values) {
+        LoadItems(values);
+    }
+
+    template <typename T>
+    void Load(T& repr) {
+        repr.serialize(*this, VersionOf<T>(versions_));
+    }
+
+    // Число элементов не используется для резервирования памяти: при
+    // неверном числе чтение упирается в конец секции
+    template <typename Container>
+    void LoadItems(Container& values) {
+        const std::uint32_t size = reader_.ReadU32();
+        values.clear();
+        for (std::uint32_t i = 0; i < size; ++i) {
+            Load(values.emplace_back());
+        }
+    }
+
+    binary_format::Reader& reader_;
+    const std::vector<std::string>& strings_;
+    const ReprVersions& versions_;
+};
+
+template <typename T>
+std::string EncodeSection(
+    const T& value,
+    StringTable& strings,
+    const ReprVersions& versions)
+{
+    std::string data;
+    binary_format::Writer writer{data};
+    BinaryOArchive archive{writer, strings, versions};
+    archive & value;
+    return data;
+}
+
+template <typename T>
+void DecodeSection(
+    std::string_view data,
+    const std::vector<std::string>& strings,
+    const ReprVersions& versions,
+    T& value)
+{
+    binary_format::Reader reader{data};
+    BinaryIArchive archive{reader, strings, versions};
+    archive & value;
+    if (!reader.AtEnd()) {
+        throw std::runtime_error("Unexpected data in game state section");
+    }
+}
+
+std::vector<std::string> DecodeStrings(std::string_view data) {
+    binary_format::Reader reader{data};
+    const std::uint32_t size = reader.ReadU32();
+    std::vector<std::string> strings;
+    for (std::uint32_t i = 0; i < size; ++i) {
+        strings.push_back(reader.ReadString());
+    }
+    if (!reader.AtEnd()) {
+        throw std::runtime_error("Unexpected data in game state section");
+    }
+    return strings;
+}
+
+constexpr std::uint32_t REPR_COUNT = 4;
+
+std::string EncodeVersions(const ReprVersions& versions) {
+    std::string data;
+    binary_format::Writer writer{data};
+    writer.WriteU32(REPR_COUNT);
+    writer.WriteU32(versions.loot);
+    writer.WriteU32(versions.dog);
+    writer.WriteU32(versions.session);
+    writer.WriteU32(versions.player);
+    return data;
+}
+
+// Поля представления более новой версии неизвестны, поэтому такие
+// секции не читаются
+ReprVersions DecodeVersions(std::string_view data) {
+    binary_format::Reader reader{data};
+    if (reader.ReadU32() != REPR_COUNT) {
+        throw std::runtime_error("Unexpected game state versions count");
+    }
+    ReprVersions versions;
+    const ReprVersions current;
+    versions.loot = reader.ReadU32();
+    versions.dog = reader.ReadU32();
+    versions.session = reader.ReadU32();
+    versions.player = reader.ReadU32();
+    if (!reader.AtEnd()) {
+        throw std::runtime_error("Unexpected data in game state section");
+    }
+    if (versions.loot > current.loot || versions.dog > current.dog ||
+        versions.session > current.session ||
+        versions.player > current.player) {
+        throw std::runtime_error("Unsupported game state object version");
+    }
+    return versions;
+}
+
+std::string EncodeGame(const GameStateRepr& state) {
+    std::string data;
+    binary_format::Writer writer{data};
+    writer.WriteU64(state.tick);
+    writer.WriteU64(static_cast<std::uint64_t>(state.pending_step_time));
+    return data;
+}
+
+void DecodeGame(std::string_view data, GameStateRepr& state) {
+    binary_format::Reader reader{data};
+    state.tick = reader.ReadU64();
+    state.pending_step_time = static_cast<std::int64_t>(reader.ReadU64());
+    if (!reader.AtEnd()) {
+        throw std::runtime_error("Unexpected data in game state section");
+    }
+}
+
+}  // namespace
+
+std::string EncodeBinaryState(
+    const GameStateRepr& state, const ReprVersions& versions)
+{
+    // Таблица строк заполняется при записи остальных секций, но
+    // записывается первой, чтобы загрузчик прочитал её до них
+    StringTable strings;
+    const std::string sessions =
+        EncodeSection(state.sessions, strings, versions);
+    const std::string players =
+        EncodeSection(state.players, strings, versions);
+
+    std::string strings_data;
+    binary_format::Writer strings_writer{strings_data};
+    strings.Write(strings_writer);
+
+    const std::string versions_data = EncodeVersions(versions);
+    const std::string game_data = EncodeGame(state);
+
+    const std::array<std::pair<Section, const std::string*>, 5> sections{{
+        {Section::VERSIONS, &versions_data},
+        {Section::GAME, &game_data},
+        {Section::STRINGS, &strings_data},
+        {Section::SESSIONS, &sessions},
+        {Section::PLAYERS, &players},
+    }};
+
+    std::string body;
+    binary_format::Writer body_writer{body};
+    for (const auto& [kind, data] : sections) {
+        body_writer.WriteU16(static_cast<std::uint16_t>(kind));
+        body_writer.WriteU32(static_cast<std::uint32_t>(data->size()));
+        body_writer.WriteBytes(*data);
+    }
+
+    std::string result;
+    result.reserve(STATE_HEADER_SIZE + body.size());
+    binary_format::Writer writer{result};
+    writer.WriteU32(STATE_MAGIC);
+    writer.WriteU16(STATE_VERSION);
+    writer.WriteU16(static_cast<std::uint16_t>(sections.size()));
+    writer.WriteU64(body.size());
+    writer.WriteU32(Crc32(body));
+    writer.WriteBytes(body);
+
+    return result;
+}
+
+GameStateRepr DecodeBinaryState(std::string_view data) {
+    try {
+        binary_format::Reader header{data.substr(0, STATE_HEADER_SIZE)};
+        if (header.ReadU32() != STATE_MAGIC) {
+            throw std::runtime_error("Invalid game state signature");
+        }
+        if (header.ReadU16() != STATE_VERSION) {
+            throw std::runtime_error("Unsupported game state version");
+        }
+        const std::uint16_t section_count = header.ReadU16();
+        const std::uint64_t body_size = header.ReadU64();
+        const std::uint32_t checksum = header.ReadU32();
+
+        const std::string_view body = data.substr(STATE_HEADER_SIZE);
+        if (body.size() != body_size) {
+            throw std::runtime_error("Game state size mismatch");
+        }
+        if (Crc32(body) != checksum) {
+            throw std::runtime_error("Game state checksum mismatch");
+        }
+
+        std::optional<std::string_view> strings_data;
+        std::optional<std::string_view> sessions_data;
+        std::optional<std::string_view> players_data;
+        std::optional<std::string_view> versions_data;
+        std::optional<std::string_view> game_data;
+        binary_format::Reader reader{body};
+        for (std::uint16_t i = 0; i < section_count; ++i) {
+            const auto kind = static_cast<Section>(reader.ReadU16());
+            const std::string_view section = reader.ReadBytes(reader.ReadU32());
+            switch (kind) {
+                case Section::STRINGS:
+                    strings_data = section;
+                    break;
+                case Section::SESSIONS:
+                    sessions_data = section;
+                    break;
+                case Section::PLAYERS:
+                    players_data = section;
+                    break;
+                case Section::VERSIONS:
+                    versions_data = section;
+                    break;
+                case Section::GAME:
+                    game_data = section;
+                    break;
+            }
+        }
+        if (!reader.AtEnd()) {
+            throw std::runtime_error("Unexpected data after game state");
+        }
+        if (!strings_data || !sessions_data || !players_data ||
+            !versions_data || !game_data) {
+            throw std::runtime_error("Game state section is missing");
+        }
+
+        const ReprVersions versions = DecodeVersions(*versions_data);
+        const std::vector<std::string> strings = DecodeStrings(*strings_data);
+        GameStateRepr state;
+        DecodeSection(*sessions_data, strings, versions, state.sessions);
+        DecodeSection(*players_data, strings, versions, state.players);
+        DecodeGame(*game_data, state);
+        return state;
+    }
+    catch (const std::out_of_range&) {
+        throw std::runtime_error("Game state is truncated");
+    }
+}
+
+bool IsBinaryState(std::string_view data) {
+    if (data.size() < sizeof(STATE_MAGIC)) {
+        return false;
+    }
+    return binary_format::Reader{data}.ReadU32() == STATE_MAGIC;
+}
+
+}  // namespace serialization
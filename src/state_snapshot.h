@@ -0,0 +1,79 @@
+// state_snapshot.h
+#pragma once
+
+#include "model_serialization.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace serialization {
+
+/*
+ *  Двоичный формат файла состояния игры.
+ *  Числа записываются в порядке little-endian фиксированной ширины.
+ *  Заголовок (STATE_HEADER_SIZE байт): uint32 STATE_MAGIC,
+ *  uint16 STATE_VERSION, uint16 число секций, uint64 размер данных после
+ *  заголовка, uint32 CRC-32 этих данных.
+ *  Секция: uint16 вид (Section), uint32 размер, данные. Секции
+ *  неизвестного вида пропускаются. Строки хранятся в таблице строк,
+ *  а в остальных секциях записываются как uint32 номер в таблице.
+ *
+ *  Section::STRINGS:
+ *      uint32 число строк, для каждой: uint32 длина, байты
+ *  Section::SESSIONS: uint32 число сессий, для каждой:
+ *      строка id карты
+ *      uint32 число собак, для каждой:
+ *          uint32 id, строка имя, f64 x, y, vx, vy,
+ *          uint8 направление (binary_format::Direction),
+ *          uint32 размер рюкзака, предметы, f64 ширина, uint32 счёт
+ *      uint32 число потерянных предметов, предметы
+ *      uint32 id сессии, uint32 счётчик собак, uint32 счётчик лута
+ *  Предмет: uint32 тип, uint32 id, uint32 ценность, f64 x, y, f64 ширина
+ *  Section::PLAYERS: uint32 число игроков, для каждого:
+ *      uint32 id сессии, uint32 id собаки, строка токен, uint32 id
+ *  Section::VERSIONS: uint32 число версий (4), версии LootRepr, DogRepr,
+ *      GameSessionRepr и PlayerRepr, с которыми записаны секции.
+ *      Поля представления зависят от его версии так же, как в текстовом
+ *      формате
+ *  Section::GAME: uint64 номер тика, int64 накопленное время шага
+ */
+
+constexpr std::uint32_t STATE_MAGIC = 0x54534747;  // "GGST"
+constexpr std::uint16_t STATE_VERSION = 1;
+constexpr size_t STATE_HEADER_SIZE = 20;
+
+enum class Section : std::uint16_t {
+    STRINGS = 1,
+    SESSIONS = 2,
+    PLAYERS = 3,
+    VERSIONS = 4,
+    GAME = 5,
+};
+
+// Версии представлений. По умолчанию - текущие версии классов
+struct ReprVersions {
+    std::uint32_t loot = boost::serialization::version<LootRepr>::value;
+    std::uint32_t dog = boost::serialization::version<DogRepr>::value;
+    std::uint32_t session =
+        boost::serialization::version<GameSessionRepr>::value;
+    std::uint32_t player = boost::serialization::version<PlayerRepr>::value;
+};
+
+enum class StateFormat {
+    TEXT,
+    BINARY
+};
+
+std::string EncodeBinaryState(
+    const GameStateRepr& state, const ReprVersions& versions = {});
+
+// Заголовок, размер и контрольная сумма проверяются до разбора секций.
+// Повреждённые данные и представления версий новее текущих отвергаются
+// исключением std::runtime_error
+GameStateRepr DecodeBinaryState(std::string_view data);
+
+// Данные начинаются с сигнатуры двоичного формата
+bool IsBinaryState(std::string_view data);
+
+}  // namespace serialization
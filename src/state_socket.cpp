@@ -0,0 +1,290 @@
+// state_socket.cpp
+#include "state_socket.h"
+
+#include <boost/log/utility/manipulators/add_value.hpp>
+
+#include <sstream>
+
+namespace http_handler {
+
+namespace {
+
+void ReportSocketError(beast::error_code ec, std::string_view what) {
+    value custom_data{
+        {"code"sv, ec.value()},
+        {"text"sv, ec.message()},
+        {"where"sv, what}
+    };
+    BOOST_LOG_TRIVIAL(info)
+        << logging::add_value(my_logger::additional_data, custom_data)
+        << "error"sv;
+}
+
+std::optional<app::Token> ExtractBearerToken(
+    const StateSocket::UpgradeRequest& request)
+{
+    auto it = request.find(KEY_authorization);
+    if (it == request.end()) {
+        return std::nullopt;
+    }
+
+    std::istringstream iss(std::string(it->value()));
+    std::string bearer_type, token_str;
+    iss >> bearer_type >> token_str;
+
+    if (!ApiRequestHandler::IsValidHexToken(token_str)) {
+        return std::nullopt;
+    }
+    return app::Token(token_str);
+}
+
+}  // namespace
+
+StateSocket::StateSocket(
+    beast::tcp_stream&& stream,
+    std::shared_ptr<app::Player> player)
+    : ws_{std::move(stream)}
+    , player_{std::move(player)} {
+}
+
+void StateSocket::Run(UpgradeRequest&& request) {
+    // Таймаут HTTP-сессии заменяем таймаутами WebSocket
+    beast::get_lowest_layer(ws_).expires_never();
+    ws_.set_option(websocket::stream_base::timeout::suggested(
+        beast::role_type::server));
+    ws_.text(true);
+
+    auto self = shared_from_this();
+    ws_.async_accept(request, [self](beast::error_code ec) {
+        self->OnAccept(ec);
+    });
+}
+
+void StateSocket::Push() {
+    net::post(ws_.get_executor(), [self = shared_from_this()] {
+        self->SendLatest();
+    });
+}
+
+void StateSocket::Close() {
+    net::post(ws_.get_executor(), [self = shared_from_this()] {
+        self->close_requested_ = true;
+        if (!self->writing_) {
+            self->DoClose();
+        }
+    });
+}
+
+bool StateSocket::IsClosed() const {
+    return closed_.load(std::memory_order_acquire);
+}
+
+const app::Token StateSocket::GetToken() const {
+    return player_->GetToken();
+}
+
+void StateSocket::OnAccept(beast::error_code ec) {
+    if (ec) {
+        closed_ = true;
+        return ReportSocketError(ec, "ws accept"sv);
+    }
+    accepted_ = true;
+
+    // Закрытие, запрошенное до завершения рукопожатия, DoClose отложил
+    if (close_requested_) {
+        return DoClose();
+    }
+
+    // Первым сообщением клиент получает полное состояние
+    SendLatest();
+    Read();
+}
+
+void StateSocket::Read() {
+    ws_.async_read(read_buffer_,
+        [self = shared_from_this()](beast::error_code ec, std::size_t bytes) {
+            self->OnRead(ec, bytes);
+        });
+}
+
+void StateSocket::OnRead(
+    beast::error_code ec,
+    [[maybe_unused]] std::size_t bytes_read)
+{
+    if (ec) {
+        closed_ = true;
+        if (ec != websocket::error::closed) {
+            ReportSocketError(ec, "ws read"sv);
+        }
+        return;
+    }
+
+    std::string message = beast::buffers_to_string(read_buffer_.data());
+    read_buffer_.consume(read_buffer_.size());
+
+    error_code parse_ec;
+    value action = parse(message, parse_ec);
+
+    if (!parse_ec && action.is_object() &&
+        action.as_object().contains(KEY_move) &&
+        action.at(KEY_move).is_string() &&
+        ApiRequestHandler::IsValidAction(
+            action.at(KEY_move).as_string().c_str()))
+    {
+        player_->MakeAction(action.at(KEY_move).as_string().c_str());
+    } else {
+        value custom_data{{"message"s, message}};
+        BOOST_LOG_TRIVIAL(warning)
+            << logging::add_value(my_logger::additional_data, custom_data)
+            << "failed to parse ws action"sv;
+    }
+
+    Read();
+}
+
+void StateSocket::SendLatest() {
+    if (!accepted_ || writing_ || close_requested_ || IsClosed()) {
+        return;
+    }
+
+    auto snapshot = player_->GetSession()->GetSnapshot();
+    if (!snapshot || (last_sent_tick_ && snapshot->tick <= *last_sent_tick_)) {
+        return;
+    }
+
+    write_body_ = last_sent_tick_
+        ? ApiRequestHandler::StateSinceBody(*snapshot, *last_sent_tick_)
+        : ApiRequestHandler::FullStateSinceBody(*snapshot);
+    writing_ = true;
+
+    // Буфер принадлежит снимку и не изменяется, поэтому копия не нужна
+    ws_.async_write(net::buffer(*write_body_),
+        [self = shared_from_this(), tick = snapshot->tick](
+            beast::error_code ec, std::size_t bytes)
+        {
+            self->OnWrite(tick, ec, bytes);
+        });
+}
+
+void StateSocket::OnWrite(
+    std::uint64_t tick,
+    beast::error_code ec,
+    [[maybe_unused]] std::size_t bytes_written)
+{
+    writing_ = false;
+    write_body_.reset();
+
+    if (ec) {
+        closed_ = true;
+        return ReportSocketError(ec, "ws write"sv);
+    }
+    last_sent_tick_ = tick;
+
+    if (close_requested_) {
+        return DoClose();
+    }
+    SendLatest();
+}
+
+void StateSocket::DoClose() {
+    if (!accepted_ || IsClosed()) {
+        return;
+    }
+    closed_ = true;
+    ws_.async_close(websocket::close_code::normal,
+        [self = shared_from_this()](beast::error_code ec) {
+            if (ec) {
+                ReportSocketError(ec, "ws close"sv);
+            }
+        });
+}
+
+StateSocketHub::StateSocketHub(model::Game& game)
+    : game_{game} {
+}
+
+void StateSocketHub::Upgrade(
+    StateSocket::UpgradeRequest&& request,
+    beast::tcp_stream&& stream)
+{
+    std::string target = UrlDecode(std::string(request.target()));
+    target = target.substr(0, target.find('?'));
+
+    if (target != API_GAME_WS_PATH) {
+        return Reject(std::move(stream), request, http::status::bad_request,
+            R"({"code": "badRequest","message": "Bad request"})");
+    }
+
+    auto token = ExtractBearerToken(request);
+    if (!token) {
+        return Reject(std::move(stream), request, http::status::unauthorized,
+            R"({"code": "invalidToken","message": "Authorization header is missing"})");
+    }
+
+    auto player = game_.GetPlayers().FindPlayerByToken(*token);
+    if (!player) {
+        return Reject(std::move(stream), request, http::status::unauthorized,
+            R"({"code": "unknownToken","message": "Player token has not been found"})");
+    }
+
+    auto socket = std::make_shared<StateSocket>(std::move(stream), *player);
+    {
+        std::lock_guard lock{mutex_};
+        sockets_.push_back(socket);
+    }
+    socket->Run(std::move(request));
+}
+
+void StateSocketHub::Broadcast() {
+    std::vector<std::shared_ptr<StateSocket>> sockets;
+    {
+        std::lock_guard lock{mutex_};
+        sockets.reserve(sockets_.size());
+
+        auto live_end = std::remove_if(sockets_.begin(), sockets_.end(),
+            [&sockets](const std::weak_ptr<StateSocket>& weak) {
+                auto socket = weak.lock();
+                if (!socket || socket->IsClosed()) {
+                    return true;
+                }
+                sockets.push_back(std::move(socket));
+                return false;
+            });
+        sockets_.erase(live_end, sockets_.end());
+    }
+
+    for (auto& socket : sockets) {
+        if (game_.GetPlayers().FindPlayerByToken(socket->GetToken())) {
+            socket->Push();
+        } else {
+            socket->Close();
+        }
+    }
+}
+
+void StateSocketHub::Reject(
+    beast::tcp_stream&& stream,
+    const StateSocket::UpgradeRequest& request,
+    http::status status,
+    std::string_view body)
+{
+    auto stream_ptr = std::make_shared<beast::tcp_stream>(std::move(stream));
+    auto response = std::make_shared<StringResponse>(MakeStringResponse(
+        status,
+        body,
+        request.version(),
+        false,
+        ContentType::APP_JSON,
+        {{http::field::cache_control, "no-cache"}}));
+
+    http::async_write(*stream_ptr, *response,
+        [stream_ptr, response](beast::error_code ec, std::size_t) {
+            if (ec) {
+                return ReportSocketError(ec, "ws reject"sv);
+            }
+            stream_ptr->socket().shutdown(
+                net::ip::tcp::socket::shutdown_send, ec);
+        });
+}
+
+}  // namespace http_handler
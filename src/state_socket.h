@@ -0,0 +1,109 @@
+// state_socket.h
+#pragma once
+
+#include "api_handler.h"
+#include "application.h"
+#include "handlers_utils.h"
+#include "model.h"
+#include "my_logger.h"
+
+#include <boost/asio/post.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/beast/websocket.hpp>
+#include <boost/json.hpp>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace http_handler {
+
+constexpr char API_GAME_WS_PATH[] = "/api/v1/game/ws";
+
+namespace net = boost::asio;
+namespace websocket = beast::websocket;
+
+/*
+ *  WebSocket-соединение игрока. После каждого тика сервер отправляет
+ *  изменения состояния сессии в формате /game/state?since=, клиент
+ *  присылает действия в формате /game/player/action.
+ *  Все операции с потоком выполняются в его strand
+ */
+class StateSocket : public std::enable_shared_from_this<StateSocket> {
+public:
+    using UpgradeRequest = http::request<http::string_body>;
+
+    StateSocket(
+        beast::tcp_stream&& stream,
+        std::shared_ptr<app::Player> player);
+
+    void Run(UpgradeRequest&& request);
+
+    // Могут вызываться из любого потока
+    void Push();
+    void Close();
+
+    bool IsClosed() const;
+    const app::Token GetToken() const;
+
+private:
+    void OnAccept(beast::error_code ec);
+
+    void Read();
+    void OnRead(beast::error_code ec, std::size_t bytes_read);
+
+    // Если предыдущая отправка ещё не завершена, клиент получит изменения
+    // сразу за несколько тиков после её завершения
+    void SendLatest();
+    void OnWrite(
+        std::uint64_t tick,
+        beast::error_code ec,
+        std::size_t bytes_written);
+
+    void DoClose();
+
+    websocket::stream<beast::tcp_stream> ws_;
+    std::shared_ptr<app::Player> player_;
+    beast::flat_buffer read_buffer_;
+    std::shared_ptr<const std::string> write_body_;
+    std::optional<std::uint64_t> last_sent_tick_;
+    bool accepted_ = false;
+    bool writing_ = false;
+    bool close_requested_ = false;
+    std::atomic<bool> closed_{false};
+};
+
+// Реестр WebSocket-соединений: принимает запросы на смену протокола и
+// рассылает состояние по окончании тика
+class StateSocketHub {
+public:
+    explicit StateSocketHub(model::Game& game);
+
+    StateSocketHub(const StateSocketHub&) = delete;
+    StateSocketHub& operator=(const StateSocketHub&) = delete;
+
+    void Upgrade(
+        StateSocket::UpgradeRequest&& request,
+        beast::tcp_stream&& stream);
+
+    // Вызывается после тика; соединения вышедших из игры игроков
+    // закрываются
+    void Broadcast();
+
+private:
+    static void Reject(
+        beast::tcp_stream&& stream,
+        const StateSocket::UpgradeRequest& request,
+        http::status status,
+        std::string_view body);
+
+    model::Game& game_;
+    std::mutex mutex_;
+    std::vector<std::weak_ptr<StateSocket>> sockets_;
+};
+
+}  // namespace http_handler
@@ -0,0 +1,236 @@
+// state_writer.cpp
+#include "state_writer.h"
+
+#include <boost/archive/text_iarchive.hpp>
+#include <boost/archive/text_oarchive.hpp>
+#include <boost/log/trivial.hpp>
+#include <boost/log/utility/manipulators/add_value.hpp>
+
+#include "my_logger.h"
+
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+namespace serialization {
+
+namespace fs = std::filesystem;
+namespace logging = boost::log;
+using namespace std::literals;
+
+namespace {
+
+void WriteTextState(std::ostream& out, const GameStateRepr& state) {
+    boost::archive::text_oarchive oa{out};
+
+    oa << std::string("sessions");
+
+    size_t sessions_count = state.sessions.size();
+    oa << sessions_count;
+    oa << state.sessions;
+
+    oa << std::string("players");
+    size_t players_count = state.players.size();
+    oa << players_count;
+
+    for (const PlayerRepr& player_repr : state.players) {
+        oa << player_repr;
+    }
+
+    oa << std::string("game");
+    oa << state.tick;
+    oa << state.pending_step_time;
+}
+
+GameStateRepr ReadTextState(std::istream& in) {
+    boost::archive::text_iarchive ia{in};
+    GameStateRepr state;
+
+    std::string s_string;
+    ia >> s_string;
+
+    size_t sessions_count = 0;
+    ia >> sessions_count;
+    ia >> state.sessions;
+
+    std::string p_string;
+    ia >> p_string;
+    size_t players_count = 0;
+    ia >> players_count;
+
+    for (size_t i = 0; i < players_count; ++i) {
+        try {
+            PlayerRepr repr;
+            ia >> repr;
+            state.players.push_back(std::move(repr));
+        }
+        catch (const boost::archive::archive_exception& e) {
+            // Состояние без части игроков не загружается, как и
+            // повреждённый двоичный файл
+            boost::json::value custom_data{
+                {"player"s, i},
+                {"exception"s, e.what()}
+            };
+            BOOST_LOG_TRIVIAL(warning)
+                << logging::add_value(my_logger::additional_data, custom_data)
+                << "failed to load player from archive"sv;
+            throw std::runtime_error(
+                "Failed to load player from archive: "s + e.what());
+        }
+    }
+
+    // Файлы, записанные до сохранения номера тика, заканчиваются игроками
+    in >> std::ws;
+    if (in.peek() != std::istream::traits_type::eof()) {
+        std::string g_string;
+        ia >> g_string;
+        ia >> state.tick;
+        ia >> state.pending_step_time;
+    }
+
+    return state;
+}
+
+}  // namespace
+
+void WriteStateFile(
+    const fs::path& path,
+    const GameStateRepr& state,
+    StateFormat format)
+{
+    fs::path temp_save_path;
+
+    if (!path.parent_path().empty() && !fs::exists(path.parent_path())) {
+        try {
+            fs::create_directories(path.parent_path());
+        }
+        catch (const fs::filesystem_error& e) {
+            std::cerr << "Failed to create directory: " << e.what() << "\n";
+            throw;
+        }
+    }
+
+    try {
+        temp_save_path = path.parent_path() /
+                        (path.filename().string() + ".tmp");
+    }
+    catch (const fs::filesystem_error&) {
+        temp_save_path = path.string() + ".tmp";
+    }
+
+    try {
+        std::ofstream ofs(temp_save_path, std::ios::binary | std::ios::trunc);
+        if (!ofs.is_open()) {
+            throw std::runtime_error("Cannot open temporary file for writing: "
+                                     + temp_save_path.string());
+        }
+
+        if (format == StateFormat::BINARY) {
+            const std::string data = EncodeBinaryState(state);
+            ofs.write(data.data(), data.size());
+        } else {
+            WriteTextState(ofs, state);
+        }
+
+        ofs.close();
+        if (!ofs) {
+            throw std::runtime_error("Failed to write temporary file: "
+                                     + temp_save_path.string());
+        }
+
+        fs::rename(temp_save_path, path);
+
+        boost::json::value custom_data{path.string()};
+        BOOST_LOG_TRIVIAL(info)
+            << logging::add_value(my_logger::additional_data, custom_data)
+            << "game state successfully saved"sv;
+    }
+    catch (const std::exception& e) {
+        try {
+            if (fs::exists(temp_save_path)) {
+                fs::remove(temp_save_path);
+            }
+        }
+        catch (...) {
+            // Игнорируем ошибки при удалении временного файла
+        }
+
+        std::cerr << "Failed to save game state: " << e.what() << "\n";
+        throw;
+    }
+}
+
+GameStateRepr ReadStateFile(const fs::path& path) {
+    std::ifstream ifs(path, std::ios::binary);
+    if (!ifs.is_open()) {
+        throw std::runtime_error("Cannot open save file: " + path.string());
+    }
+    const std::string data{std::istreambuf_iterator<char>{ifs},
+                           std::istreambuf_iterator<char>{}};
+
+    if (IsBinaryState(data)) {
+        return DecodeBinaryState(data);
+    }
+    std::istringstream text{data};
+    return ReadTextState(text);
+}
+
+StateWriter::StateWriter(fs::path path, StateFormat format)
+    : path_(std::move(path))
+    , format_(format)
+    , thread_([this] { Run(); }) {
+}
+
+StateWriter::~StateWriter() {
+    {
+        std::lock_guard lock{mutex_};
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    thread_.join();
+}
+
+void StateWriter::Submit(GameStateRepr state) {
+    {
+        std::lock_guard lock{mutex_};
+        pending_ = std::move(state);
+    }
+    cv_.notify_all();
+}
+
+void StateWriter::Flush() {
+    std::unique_lock lock{mutex_};
+    cv_.wait(lock, [this] { return !pending_ && !writing_; });
+}
+
+void StateWriter::Run() {
+    std::unique_lock lock{mutex_};
+    for (;;) {
+        cv_.wait(lock, [this] { return pending_ || stopping_; });
+        if (!pending_) {
+            return;
+        }
+
+        GameStateRepr state = std::move(*pending_);
+        pending_.reset();
+        writing_ = true;
+        lock.unlock();
+
+        // Ошибка записи не останавливает игру: следующая копия будет
+        // записана в свой срок
+        try {
+            WriteStateFile(path_, state, format_);
+        }
+        catch (const std::exception&) {
+        }
+
+        lock.lock();
+        writing_ = false;
+        cv_.notify_all();
+    }
+}
+
+}  // namespace serialization
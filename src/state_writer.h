@@ -0,0 +1,57 @@
+// state_writer.h
+#pragma once
+
+#include "model_serialization.h"
+#include "state_snapshot.h"
+
+#include <condition_variable>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+namespace serialization {
+
+// Записывает состояние во временный файл рядом с path и атомарно
+// заменяет им path
+void WriteStateFile(const std::filesystem::path& path,
+                    const GameStateRepr& state,
+                    StateFormat format);
+
+// Формат файла определяется по его заголовку. Файл читается целиком,
+// поэтому ошибка обнаруживается до того, как состояние будет применено
+GameStateRepr ReadStateFile(const std::filesystem::path& path);
+
+/*
+ *  Фоновая запись состояния в файл. Тик только снимает копию состояния
+ *  и передаёт её писателю; кодирование, запись и переименование файла
+ *  выполняются в отдельном потоке. Если предыдущая копия ещё пишется,
+ *  новая ждёт своей очереди, а ещё не начатая заменяется более свежей
+ */
+class StateWriter {
+public:
+    StateWriter(std::filesystem::path path, StateFormat format);
+    StateWriter(const StateWriter&) = delete;
+    StateWriter& operator=(const StateWriter&) = delete;
+    // Дописывает ожидающую копию
+    ~StateWriter();
+
+    void Submit(GameStateRepr state);
+
+    // Дожидается, пока будут записаны все переданные копии
+    void Flush();
+
+private:
+    void Run();
+
+    std::filesystem::path path_;
+    StateFormat format_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::optional<GameStateRepr> pending_;
+    bool writing_ = false;
+    bool stopping_ = false;
+    std::thread thread_;
+};
+
+}  // namespace serialization
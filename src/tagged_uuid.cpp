@@ -1,15 +1,24 @@
 // tagged_uuid.cpp
 #include "tagged_uuid.h"
 
-#include <boost/uuid/random_generator.hpp>
+#include "random_id.h"
+
 #include <boost/uuid/string_generator.hpp>
 #include <boost/uuid/uuid_io.hpp>
 
+#include <algorithm>
+
 namespace util {
 namespace detail {
 
+// UUID версии 4 из случайного идентификатора потока
 UUIDType NewUUID() {
-    return boost::uuids::random_generator()();
+    const RandomId id = NewRandomId();
+    UUIDType uuid;
+    std::copy(id.begin(), id.end(), uuid.begin());
+    uuid.data[6] = (uuid.data[6] & 0x0f) | 0x40;
+    uuid.data[8] = (uuid.data[8] & 0x3f) | 0x80;
+    return uuid;
 }
 
 std::string UUIDToString(const UUIDType& uuid) {
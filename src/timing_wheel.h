@@ -0,0 +1,189 @@
+// timing_wheel.h
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace util {
+
+/*
+ *  Иерархическое колесо таймеров. Время целочисленное (например,
+ *  миллисекунды). Уровень L делится на 64 слота по 64^L единиц времени;
+ *  таймер кладётся на младший уровень, в диапазон которого попадает срок,
+ *  и по мере хода времени спускается на нижние уровни. Постановка таймера
+ *  выполняется за O(1), продвижение времени - за O(истёкших таймеров)
+ *  плюс число непустых слотов, через которые прошло время: пустые слоты
+ *  пропускаются по битовым маскам занятости уровней. Отмены нет:
+ *  устаревшие таймеры отбрасывает получатель
+ */
+template <typename T>
+class TimingWheel {
+public:
+    using Time = std::uint64_t;
+
+    explicit TimingWheel(Time now = 0)
+        : now_{now} {
+    }
+
+    // Таймер со сроком не позже Now() сработает при следующем Advance()
+    void Schedule(Time deadline, T value) {
+        ++size_;
+        if (deadline <= now_) {
+            due_.push_back({deadline, std::move(value)});
+            return;
+        }
+        Place({deadline, std::move(value)});
+    }
+
+    // Продвигает время до now и вызывает on_expired для каждого таймера
+    // со сроком не позже now. on_expired не должен ставить новые таймеры
+    template <typename OnExpired>
+    void Advance(Time now, OnExpired&& on_expired) {
+        Fire(due_, on_expired);
+
+        while (now_ < now) {
+            const Time next = NextEvent();
+            if (next > now) {
+                now_ = now;
+                break;
+            }
+            now_ = next;
+            Cascade();
+            Fire(levels_[0][now_ & SLOT_MASK], on_expired);
+            occupied_[0] &= ~(Mask{1} << (now_ & SLOT_MASK));
+        }
+    }
+
+    Time Now() const noexcept {
+        return now_;
+    }
+
+    // Число поставленных и ещё не сработавших таймеров
+    size_t Size() const noexcept {
+        return size_;
+    }
+
+private:
+    static constexpr size_t SLOT_BITS = 6;
+    static constexpr size_t SLOTS = size_t{1} << SLOT_BITS;
+    static constexpr Time SLOT_MASK = SLOTS - 1;
+    static constexpr size_t LEVELS = 4;
+    static constexpr Time NEVER = std::numeric_limits<Time>::max();
+
+    using Mask = std::uint64_t;
+    static_assert(SLOTS == std::numeric_limits<Mask>::digits);
+
+    struct Entry {
+        Time deadline;
+        T value;
+    };
+    using Slot = std::vector<Entry>;
+
+    // Уровень L подходит, если срок лежит в том же блоке уровня L + 1,
+    // что и текущее время: тогда его слот ещё не пройден
+    void Place(Entry entry) {
+        for (size_t level = 0; level < LEVELS; ++level) {
+            const size_t shift = SLOT_BITS * (level + 1);
+            if ((entry.deadline >> shift) == (now_ >> shift)) {
+                const size_t slot =
+                    (entry.deadline >> (SLOT_BITS * level)) & SLOT_MASK;
+                levels_[level][slot].push_back(std::move(entry));
+                occupied_[level] |= Mask{1} << slot;
+                return;
+            }
+        }
+        overflow_min_ = std::min(overflow_min_, entry.deadline);
+        overflow_.push_back(std::move(entry));
+    }
+
+    // Ближайший момент после now_, когда нужно раскладывать или запускать
+    // непустой слот. На уровне L все занятые слоты лежат правее текущего
+    // в пределах блока уровня L + 1, поэтому достаточно найти младший
+    // занятый слот правее текущего. NEVER, если таких моментов нет
+    Time NextEvent() const noexcept {
+        Time next = NEVER;
+        for (size_t level = 0; level < LEVELS; ++level) {
+            const size_t shift = SLOT_BITS * level;
+            const size_t current = (now_ >> shift) & SLOT_MASK;
+            const Mask ahead = current == SLOT_MASK
+                ? 0
+                : occupied_[level] & (~Mask{0} << (current + 1));
+            if (ahead == 0) {
+                continue;
+            }
+            const size_t block_shift = shift + SLOT_BITS;
+            const Time block = (now_ >> block_shift) << block_shift;
+            const Time slot = static_cast<Time>(std::countr_zero(ahead));
+            next = std::min(next, block + (slot << shift));
+        }
+        if (!overflow_.empty()) {
+            constexpr size_t top_shift = SLOT_BITS * LEVELS;
+            next = std::min(next, (overflow_min_ >> top_shift) << top_shift);
+        }
+        return next;
+    }
+
+    // Когда время доходит до начала слота верхнего уровня, его таймеры
+    // раскладываются по нижним уровням. Старшие уровни обрабатываются
+    // первыми, поскольку их таймеры могут попасть в текущие слоты младших
+    void Cascade() {
+        size_t aligned = 0;
+        while (aligned < LEVELS &&
+               (now_ & ((Time{1} << (SLOT_BITS * (aligned + 1))) - 1)) == 0)
+        {
+            ++aligned;
+        }
+
+        if (aligned == LEVELS) {
+            overflow_min_ = NEVER;
+            Redistribute(overflow_);
+            aligned = LEVELS - 1;
+        }
+        for (size_t level = aligned; level > 0; --level) {
+            const size_t slot = (now_ >> (SLOT_BITS * level)) & SLOT_MASK;
+            occupied_[level] &= ~(Mask{1} << slot);
+            Redistribute(levels_[level][slot]);
+        }
+    }
+
+    void Redistribute(Slot& slot) {
+        if (slot.empty()) {
+            return;
+        }
+        Slot entries = std::move(slot);
+        slot.clear();
+        for (Entry& entry : entries) {
+            Place(std::move(entry));
+        }
+        // Буфер слота сохраняется, чтобы не выделять память заново
+        entries.clear();
+        if (slot.empty()) {
+            slot = std::move(entries);
+        }
+    }
+
+    template <typename OnExpired>
+    void Fire(Slot& slot, OnExpired& on_expired) {
+        for (Entry& entry : slot) {
+            --size_;
+            on_expired(std::move(entry.value));
+        }
+        slot.clear();
+    }
+
+    std::array<std::array<Slot, SLOTS>, LEVELS> levels_;
+    std::array<Mask, LEVELS> occupied_{};
+    Slot overflow_;
+    Time overflow_min_ = NEVER;
+    Slot due_;
+    Time now_;
+    size_t size_ = 0;
+};
+
+}  // namespace util
@@ -0,0 +1,112 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/alias_table.h"
+#include "../src/application.h"
+#include "../src/model.h"
+#include "test_game.h"
+
+#include <random>
+#include <set>
+#include <vector>
+
+using namespace std::literals;
+
+SCENARIO("Alias table") {
+    GIVEN("a table with uneven and zero weights") {
+        const std::vector<double> weights{1, 3, 0, 6};
+        const util::AliasTable table{weights};
+        REQUIRE(table.Size() == weights.size());
+
+        WHEN("many indices are sampled") {
+            constexpr int SAMPLES = 100000;
+            std::mt19937_64 random{42};
+            std::vector<int> counts(weights.size());
+            for (int i = 0; i < SAMPLES; ++i) {
+                ++counts[table.Sample(random)];
+            }
+
+            THEN("frequencies follow the weights") {
+                CHECK(counts[2] == 0);
+                for (size_t i = 0; i < weights.size(); ++i) {
+                    const double expected = SAMPLES * weights[i] / 10;
+                    CHECK(std::abs(counts[i] - expected) < SAMPLES * 0.01);
+                }
+            }
+        }
+    }
+
+    GIVEN("only zero weights") {
+        const util::AliasTable table{std::vector<double>{0, 0}};
+
+        THEN("the table is empty") {
+            CHECK(table.Empty());
+        }
+    }
+}
+
+SCENARIO("Spawn points on roads") {
+    GIVEN("a map with a long road and a one-tile road") {
+        model::Map map{model::Map::Id{"map1"s}, "Map 1"s};
+        map.AddRoad({model::Road::HORIZONTAL, {0, 0}, 99});
+        map.AddRoad({model::Road::VERTICAL, {200, 0}, 0});
+        map.BuildSpawnTable();
+
+        WHEN("spawn points are sampled") {
+            std::mt19937_64 random{7};
+            int on_short_road = 0;
+            bool all_on_roads = true;
+            for (int i = 0; i < 10000; ++i) {
+                const model::Point point = map.GetRandomPointOnRoad(random);
+                if (point.x == 200 && point.y == 0) {
+                    ++on_short_road;
+                } else if (point.y != 0 || point.x < 0 || point.x > 99) {
+                    all_on_roads = false;
+                }
+            }
+
+            THEN("points lie on roads in proportion to road length") {
+                CHECK(all_on_roads);
+                CHECK(on_short_road > 50);
+                CHECK(on_short_road < 200);
+            }
+        }
+    }
+}
+
+SCENARIO("Spawned loot types") {
+    GIVEN("a map with three loot types") {
+        model::Map map{model::Map::Id{"map1"s}, "Map 1"s};
+        map.SetLootTypesCount(3);
+
+        WHEN("loot types are sampled") {
+            std::mt19937_64 random{7};
+            std::set<int> types;
+            for (int i = 0; i < 1000; ++i) {
+                types.insert(map.GetRandomLootType(random));
+            }
+
+            THEN("every type and only them are drawn") {
+                CHECK(types == std::set{0, 1, 2});
+            }
+        }
+    }
+
+    GIVEN("a game on a map without loot types and an eager loot generator") {
+        model::Map map = test_game::MakeMap();
+        map.SetLootTypesCount(0);
+        map.AddRoad({model::Road::HORIZONTAL, {0, 0}, 10});
+        model::Game game = test_game::MakeGame(std::move(map));
+        game.SetLootGenerator(std::make_unique<loot_gen::LootGenerator>(
+            std::chrono::seconds{1}, 1.0));
+        auto player = app::Application::join_game(
+            game, "Rex"s, test_game::MAP_ID);
+
+        WHEN("the game is updated") {
+            game.Update(5000);
+
+            THEN("no loot appears") {
+                CHECK(player->GetSession()->GetLoot().empty());
+            }
+        }
+    }
+}
@@ -0,0 +1,142 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+
+#include "../src/application.h"
+#include "../src/model.h"
+#include "test_game.h"
+
+#include <string>
+
+using namespace model;
+using namespace std::literals;
+using test_game::AddLoot;
+using test_game::MakeGame;
+using test_game::MakeMap;
+using test_game::MAP_ID;
+using Catch::Matchers::WithinAbs;
+
+SCENARIO("Analytic kinematics on a single road") {
+    GIVEN("a dog on a road of length 20 in analytic mode") {
+        Game game = MakeGame(20, 1, 1);
+        game.SetKinematicsMode(true);
+        auto player = app::Application::join_game(game, "Rex"s, MAP_ID);
+        auto session = player->GetSession();
+        auto dog = player->GetDog();
+
+        WHEN("the dog runs past the road end in one tick") {
+            player->MakeAction("R"s);
+            game.Update(3000);
+            const double x_on_the_way = dog->GetPosition().x;
+            game.Update(30000);
+
+            THEN("it stops at the edge of the road") {
+                CHECK_THAT(x_on_the_way, WithinAbs(3.0, 1e-9));
+                CHECK_THAT(dog->GetPosition().x, WithinAbs(20.4, 1e-9));
+                CHECK_THAT(dog->GetPosition().y, WithinAbs(0.0, 1e-9));
+                CHECK(dog->GetSpeed().x == 0);
+            }
+        }
+
+        WHEN("a command arrives before the planned contacts") {
+            auto loot = AddLoot(*session, 8);
+            player->MakeAction("R"s);
+            game.Update(5000);
+            player->MakeAction("L"s);
+            game.Update(3000);
+            const double x_after_turn = dog->GetPosition().x;
+            game.Update(30000);
+
+            THEN("the events of the previous plan are dropped") {
+                CHECK_THAT(x_after_turn, WithinAbs(2.0, 1e-9));
+                CHECK(dog->GetLoot().empty());
+                CHECK(session->FindLoot(loot->GetKey()));
+                CHECK_THAT(dog->GetPosition().x, WithinAbs(-0.4, 1e-9));
+            }
+        }
+
+        WHEN("the dog passes more loot than its bag holds") {
+            auto first = AddLoot(*session, 3);
+            auto second = AddLoot(*session, 6);
+            player->MakeAction("R"s);
+            game.Update(10000);
+
+            THEN("it picks up only the first one") {
+                const auto& bag = dog->GetLoot();
+                REQUIRE(bag.size() == 1);
+                CHECK(bag[0]->GetId() == first->GetId());
+                CHECK_FALSE(session->FindLoot(first->GetKey()));
+                CHECK(session->FindLoot(second->GetKey()));
+            }
+        }
+    }
+
+    GIVEN("a dog on a road of length 1000 in analytic mode") {
+        Game game = MakeGame(1000);
+        game.SetKinematicsMode(true);
+        auto player = app::Application::join_game(game, "Rex"s, MAP_ID);
+        auto session = player->GetSession();
+        auto dog = player->GetDog();
+        auto loot = AddLoot(*session, 500);
+        player->MakeAction("R"s);
+
+        WHEN("a single tick covers the whole run") {
+            game.Update(1'000'000);
+            const double x_after_tick = dog->GetPosition().x;
+            game.Update(1000);
+
+            THEN("the loot on the way is picked up and the dog stops "
+                 "at the road end") {
+                CHECK_THAT(x_after_tick, WithinAbs(1000.0, 1e-6));
+                REQUIRE(dog->GetLoot().size() == 1);
+                CHECK(dog->GetLoot()[0]->GetId() == loot->GetId());
+                CHECK_THAT(dog->GetPosition().x, WithinAbs(1000.4, 1e-6));
+                CHECK(game.GetTick() == 2);
+            }
+        }
+    }
+}
+
+SCENARIO("Analytic kinematics on a map with a crossing and an office") {
+    GIVEN("a horizontal road crossed by a vertical one at x = 5 "
+          "and an office at x = 10") {
+        Map map = MakeMap();
+        map.AddRoad({Road::HORIZONTAL, {0, 0}, 20});
+        map.AddRoad({Road::VERTICAL, {5, -10}, 10});
+        map.AddOffice(Office{Office::Id{"o1"s}, {10, 0}, {0, 0}});
+        Game game = MakeGame(std::move(map));
+        game.SetKinematicsMode(true);
+        auto player = app::Application::join_game(game, "Rex"s, MAP_ID);
+        auto session = player->GetSession();
+        auto dog = player->GetDog();
+
+        WHEN("the dog turns at the crossing") {
+            player->MakeAction("R"s);
+            game.Update(5000);
+            player->MakeAction("D"s);
+            game.Update(3000);
+            const geom::Point2D on_the_way = dog->GetPosition();
+            game.Update(30000);
+
+            THEN("it continues along the vertical road to its end") {
+                CHECK_THAT(on_the_way.x, WithinAbs(5.0, 1e-9));
+                CHECK_THAT(on_the_way.y, WithinAbs(3.0, 1e-9));
+                CHECK_THAT(dog->GetPosition().x, WithinAbs(5.0, 1e-9));
+                CHECK_THAT(dog->GetPosition().y, WithinAbs(10.4, 1e-9));
+            }
+        }
+
+        WHEN("the dog carries loot past the office") {
+            AddLoot(*session, 4);
+            player->MakeAction("R"s);
+            game.Update(7000);
+            const size_t carried = dog->GetLoot().size();
+            game.Update(7000);
+
+            THEN("the loot is handed in and scored") {
+                CHECK(carried == 1);
+                CHECK(dog->GetLoot().empty());
+                CHECK(dog->GetScore() == 5);
+            }
+        }
+    }
+}
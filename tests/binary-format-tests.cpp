@@ -0,0 +1,59 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/binary_format.h"
+#include "../src/model.h"
+
+using namespace model;
+using namespace std::literals;
+
+SCENARIO("Binary state encoding") {
+    GIVEN("a session snapshot with a dog and a lost object") {
+        SessionSnapshot snapshot;
+        snapshot.dogs.push_back(SessionSnapshot::DogState{
+            .player_id = 7,
+            .name = "Rex"s,
+            .position = {1.5, -2.25},
+            .speed = {0, 3},
+            .direction = DIRECTION::SOUTH,
+            .bag = {{11, 2, {0, 0}}},
+            .score = 42});
+        snapshot.loot.push_back({5, 1, {10.125, 20}});
+
+        WHEN("the snapshot is encoded") {
+            std::string data = binary_format::EncodeState(snapshot);
+
+            THEN("every field can be read back in order") {
+                binary_format::Reader reader{data};
+                CHECK(reader.ReadHeader() == binary_format::Kind::STATE);
+
+                REQUIRE(reader.ReadU32() == 1);
+                CHECK(reader.ReadU32() == 7);
+                CHECK(reader.ReadF64() == 1.5);
+                CHECK(reader.ReadF64() == -2.25);
+                CHECK(reader.ReadF64() == 0.0);
+                CHECK(reader.ReadF64() == 3.0);
+                CHECK(reader.ReadU8() ==
+                    static_cast<std::uint8_t>(binary_format::Direction::SOUTH));
+                CHECK(reader.ReadU32() == 42);
+                REQUIRE(reader.ReadU32() == 1);
+                CHECK(reader.ReadU32() == 11);
+                CHECK(reader.ReadU32() == 2);
+
+                REQUIRE(reader.ReadU32() == 1);
+                CHECK(reader.ReadU32() == 5);
+                CHECK(reader.ReadU32() == 1);
+                CHECK(reader.ReadF64() == 10.125);
+                CHECK(reader.ReadF64() == 20.0);
+
+                CHECK(reader.AtEnd());
+            }
+
+            THEN("numbers are little-endian after the magic header") {
+                REQUIRE(data.size() > 8);
+                CHECK(data.substr(0, 4) == "GBIN"sv);
+                CHECK(data[4] == binary_format::VERSION);
+                CHECK(data[5] == 0);
+            }
+        }
+    }
+}
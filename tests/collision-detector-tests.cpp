@@ -4,6 +4,8 @@
 
 #include <catch2/catch_test_macros.hpp>
 
+#include <algorithm>
+#include <random>
 #include <stdexcept>
 
 // Напишите здесь тесты для функции collision_detector::FindGatherEvents
@@ -310,4 +312,76 @@ SCENARIO("Gather Events two gatherers with same way") {
             }
         }
     }
+}
+
+SCENARIO("Gather Events match exhaustive search") {
+    GIVEN("Many gatherers moving along roads among many items") {
+        std::mt19937 gen{42};
+        std::uniform_real_distribution<double> coord{0.0, 100.0};
+        std::uniform_real_distribution<double> step{-3.0, 3.0};
+        std::uniform_int_distribution<int> axis{0, 2};
+
+        std::vector<Item> items;
+        for (int i = 0; i < 2000; ++i) {
+            // Часть предметов совпадает по координатам, чтобы были равные time
+            double x = i % 10 == 0 ? std::round(coord(gen)) : coord(gen);
+            double y = i % 10 == 0 ? std::round(coord(gen)) : coord(gen);
+            items.push_back(Item{{x, y}, i % 50 == 0 ? 0.5 : 0.0});
+        }
+
+        std::vector<Gatherer> gatherers;
+        for (int g = 0; g < 200; ++g) {
+            geom::Point2D start{std::round(coord(gen)), std::round(coord(gen))};
+            geom::Point2D end = start;
+            int direction = axis(gen);
+            if (direction == 0) {
+                end.x += step(gen);
+            } else if (direction == 1) {
+                end.y += step(gen);
+            }
+            gatherers.push_back(Gatherer{start, end, 0.6});
+        }
+        TestItemGathererProvider provider(items, gatherers);
+
+        WHEN("FindGatherEvents is called") {
+            auto result = collision_detector::FindGatherEvents(provider);
+
+            THEN("Events are the same as after checking every pair") {
+                std::vector<GatheringEvent> expected;
+                for (size_t g = 0; g < gatherers.size(); ++g) {
+                    const auto& gatherer = gatherers[g];
+                    if (gatherer.start_pos.x == gatherer.end_pos.x &&
+                        gatherer.start_pos.y == gatherer.end_pos.y)
+                    {
+                        continue;
+                    }
+                    for (size_t i = 0; i < items.size(); ++i) {
+                        auto collect_result = TryCollectPoint(
+                            gatherer.start_pos, gatherer.end_pos,
+                            items[i].position);
+                        if (collect_result.IsCollected(
+                                gatherer.width + items[i].width))
+                        {
+                            expected.push_back({i, g,
+                                collect_result.sq_distance,
+                                collect_result.proj_ratio,
+                                items[i].item_type_});
+                        }
+                    }
+                }
+                std::sort(expected.begin(), expected.end(),
+                    [](const GatheringEvent& l, const GatheringEvent& r) {
+                        return l.time < r.time;
+                    });
+
+                REQUIRE(!expected.empty());
+                REQUIRE(result.size() == expected.size());
+                for (size_t e = 0; e < result.size(); ++e) {
+                    CHECK(result[e].item_id == expected[e].item_id);
+                    CHECK(result[e].gatherer_id == expected[e].gatherer_id);
+                    CHECK(result[e].time == expected[e].time);
+                }
+            }
+        }
+    }
 }
\ No newline at end of file
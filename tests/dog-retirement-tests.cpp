@@ -0,0 +1,197 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/application.h"
+#include "../src/model.h"
+#include "test_game.h"
+
+#include <string>
+
+using namespace model;
+using namespace std::literals;
+using test_game::MakeGame;
+using test_game::MAP_ID;
+
+SCENARIO("Idle dogs retire") {
+    GIVEN("a game with 5 s retirement time and one standing player") {
+        Game game = MakeGame();
+        game.SetDogRetirementTime(5);
+        auto player = app::Application::join_game(game, "Rex"s, MAP_ID);
+        auto session = player->GetSession();
+        const auto token = player->GetToken();
+        const auto run = [&game](int seconds) {
+            for (int i = 0; i < seconds; ++i) {
+                game.Update(1000);
+            }
+        };
+        const auto is_retired = [&] {
+            return session->GetDogs().empty()
+                && !game.GetPlayers().FindPlayerByToken(token).has_value();
+        };
+
+        WHEN("the dog stands still until just before the deadline") {
+            run(4);
+            game.Update(999);
+
+            THEN("it is still in the game") {
+                CHECK(session->GetDogs().size() == 1);
+                CHECK(game.GetPlayers().FindPlayerByToken(token).has_value());
+            }
+
+            AND_WHEN("the deadline is reached") {
+                game.Update(1);
+
+                THEN("the player is removed from the session and the registry") {
+                    CHECK(is_retired());
+                    CHECK(game.GetPlayers().GetPlayers().empty());
+                    CHECK(!session->GetDogById(player->GetDogId()));
+                }
+            }
+        }
+
+        WHEN("the dog starts running before the deadline") {
+            run(4);
+            player->MakeAction("R"s);
+            run(6);
+
+            THEN("it is not retired while running") {
+                CHECK(session->GetDogs().size() == 1);
+                CHECK(game.GetPlayers().FindPlayerByToken(token).has_value());
+            }
+
+            AND_WHEN("it stops again") {
+                player->MakeAction(""s);
+                run(4);
+                game.Update(999);
+                const bool retired_early = is_retired();
+                game.Update(1);
+
+                THEN("it retires 5 s after the stop") {
+                    CHECK(!retired_early);
+                    CHECK(is_retired());
+                }
+            }
+        }
+    }
+
+    GIVEN("a dog that reaches the end of a short road in the middle of a tick") {
+        Game game = MakeGame(3);
+        game.SetDogRetirementTime(5);
+        auto player = app::Application::join_game(game, "Rex"s, MAP_ID);
+        auto session = player->GetSession();
+        player->MakeAction("R"s);
+        // Собака останавливается на краю дороги в момент 3.4 с, но
+        // простой отсчитывается с конца тика, в котором она ещё двигалась
+        game.Update(1000);
+        game.Update(1000);
+        game.Update(1000);
+        game.Update(1000);
+
+        WHEN("it stays parked for less than the retirement time") {
+            game.Update(4999);
+
+            THEN("it is still in the game") {
+                CHECK(session->GetDogs().size() == 1);
+            }
+        }
+
+        WHEN("a command wakes it in the tick after it was parked") {
+            game.Update(1000);
+            player->MakeAction("L"s);
+            game.Update(1000);
+            player->MakeAction(""s);
+            game.Update(1000);
+            game.Update(3999);
+            const size_t dogs_before_deadline = session->GetDogs().size();
+            game.Update(1);
+
+            THEN("the old deadline is ignored and the new one retires it") {
+                CHECK(dogs_before_deadline == 1);
+                CHECK(session->GetDogs().empty());
+            }
+        }
+    }
+
+    GIVEN("three players of which only the first one stands still") {
+        Game game = MakeGame();
+        game.SetDogRetirementTime(5);
+        auto standing = app::Application::join_game(game, "Rex"s, MAP_ID);
+        auto first_runner =
+            app::Application::join_game(game, "Max"s, MAP_ID);
+        auto second_runner =
+            app::Application::join_game(game, "Bim"s, MAP_ID);
+        auto session = standing->GetSession();
+        first_runner->MakeAction("R"s);
+        second_runner->MakeAction("R"s);
+
+        WHEN("the standing dog retires") {
+            for (int i = 0; i < 5; ++i) {
+                game.Update(1000);
+            }
+
+            THEN("the other dogs keep their records") {
+                REQUIRE(session->GetDogs().size() == 2);
+                CHECK(session->GetDogById(first_runner->GetDogId())
+                      == first_runner->GetDog());
+                CHECK(session->GetDogById(second_runner->GetDogId())
+                      == second_runner->GetDog());
+                CHECK(first_runner->GetDog()->GetName() == "Max"s);
+                CHECK(second_runner->GetDog()->GetName() == "Bim"s);
+                CHECK(first_runner->GetDog()->GetPosition().x == 5);
+                CHECK(second_runner->GetDog()->GetPosition().x == 5);
+            }
+
+            AND_WHEN("the remaining dogs keep running") {
+                game.Update(1000);
+
+                THEN("both of them keep moving") {
+                    CHECK(first_runner->GetDog()->GetPosition().x == 6);
+                    CHECK(second_runner->GetDog()->GetPosition().x == 6);
+                }
+            }
+        }
+    }
+}
+
+SCENARIO("Dogs stalled in a gap between roads") {
+    GIVEN("a dog stopped at the end of a road followed by a gap") {
+        // Полосы дорог (0, 0)-(10, 0) и (12, 0)-(20, 0) разделены
+        // промежутком 10.4 < x < 11.6
+        Map map = test_game::MakeMap();
+        map.AddRoad({Road::HORIZONTAL, {0, 0}, 10});
+        map.AddRoad({Road::HORIZONTAL, {12, 0}, 20});
+        Game game = MakeGame(std::move(map));
+        game.SetDogRetirementTime(5);
+        auto player = app::Application::join_game(game, "Rex"s, MAP_ID);
+        auto session = player->GetSession();
+        auto dog = player->GetDog();
+        player->MakeAction("R"s);
+        for (int i = 0; i < 11; ++i) {
+            game.Update(1000);
+        }
+        player->MakeAction("R"s);
+
+        WHEN("a short tick does not reach the next road") {
+            game.Update(100);
+            const double stalled_x = dog->GetPosition().x;
+
+            THEN("a longer tick still carries it across the gap") {
+                CHECK(stalled_x == 10.4);
+                game.Update(2000);
+                CHECK(dog->GetPosition().x == 12.4);
+            }
+        }
+
+        WHEN("short ticks never reach the next road") {
+            for (int i = 0; i < 49; ++i) {
+                game.Update(100);
+            }
+            const size_t dogs_before_deadline = session->GetDogs().size();
+            game.Update(100);
+
+            THEN("it retires 5 s after it stopped moving") {
+                CHECK(dogs_before_deadline == 1);
+                CHECK(session->GetDogs().empty());
+            }
+        }
+    }
+}
@@ -0,0 +1,58 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+
+#include "../src/application.h"
+#include "../src/model.h"
+#include "test_game.h"
+
+#include <string>
+
+using namespace model;
+using namespace std::literals;
+using test_game::MakeGame;
+using test_game::MAP_ID;
+using Catch::Matchers::WithinAbs;
+
+SCENARIO("Fixed timestep") {
+    GIVEN("a game with 10 ms steps, at most 4 per tick, and a running dog") {
+        Game game = MakeGame();
+        game.SetFixedTimestep(10, 4);
+        auto player = app::Application::join_game(game, "Rex"s, MAP_ID);
+        player->MakeAction("R"s);
+        auto session = player->GetSession();
+        const auto dog_x = [&session] {
+            return session->GetDogs().front()->GetPosition().x;
+        };
+
+        WHEN("ticks are not multiples of the step") {
+            game.Update(25);
+            const double first_x = dog_x();
+            game.Update(5);
+
+            THEN("the remainder is carried over to the next tick") {
+                CHECK_THAT(first_x, WithinAbs(0.02, 1e-9));
+                CHECK_THAT(dog_x(), WithinAbs(0.03, 1e-9));
+                CHECK(game.GetTick() == 2);
+            }
+        }
+
+        WHEN("a tick is longer than the substep limit allows") {
+            game.Update(1000);
+            game.Update(5);
+
+            THEN("the excess time is dropped") {
+                CHECK_THAT(dog_x(), WithinAbs(0.04, 1e-9));
+                CHECK(game.GetTick() == 1);
+            }
+        }
+
+        WHEN("the game is fast-forwarded") {
+            game.FastForward(500'000);
+
+            THEN("all steps are made in a single tick") {
+                CHECK_THAT(dog_x(), WithinAbs(500.0, 1e-6));
+                CHECK(game.GetTick() == 1);
+            }
+        }
+    }
+}
@@ -0,0 +1,74 @@
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/application.h"
+#include "../src/model.h"
+#include "test_game.h"
+
+#include <string>
+
+using namespace model;
+using namespace std::literals;
+using test_game::AddLoot;
+using test_game::MakeGame;
+using test_game::MAP_ID;
+
+SCENARIO("Gathering loot during a tick") {
+    GIVEN("a dog running past three lost objects with room for two") {
+        Game game = MakeGame(40, 10, 2);
+        auto player = app::Application::join_game(game, "Rex"s, MAP_ID);
+        auto session = player->GetSession();
+
+        // Идентификаторы лута не совпадают с его номерами в сессии
+        for (int i = 0; i < 5; ++i) {
+            session->NextLootId();
+        }
+        auto first = AddLoot(*session, 5);
+        auto second = AddLoot(*session, 10);
+        auto third = AddLoot(*session, 15);
+
+        player->MakeAction("R"s);
+
+        WHEN("the dog passes all of them in one tick") {
+            game.Update(2000);
+
+            THEN("it picks up the first two along its path") {
+                const auto& bag = player->GetDog()->GetLoot();
+                REQUIRE(bag.size() == 2);
+                CHECK(bag[0]->GetId() == first->GetId());
+                CHECK(bag[1]->GetId() == second->GetId());
+
+                const auto loot = session->GetLoot();
+                REQUIRE(loot.size() == 1);
+                CHECK(loot[0]->GetId() == third->GetId());
+            }
+        }
+    }
+}
+
+TEST_CASE("Gather resolution scales with loot count", "[.][benchmark]") {
+    constexpr int DOG_COUNT = 100;
+
+    for (int loot_count : {100, 1000, 10000}) {
+        BENCHMARK_ADVANCED("loot: "s + std::to_string(loot_count))(
+            Catch::Benchmark::Chronometer meter)
+        {
+            Game game = MakeGame(1000, 1, 1000000);
+            std::vector<std::shared_ptr<app::Player>> players;
+            for (int i = 0; i < DOG_COUNT; ++i) {
+                players.push_back(
+                    app::Application::join_game(game, "Rex"s, MAP_ID));
+                players.back()->MakeAction("R"s);
+            }
+
+            auto session = players.front()->GetSession();
+            for (int i = 0; i < loot_count; ++i) {
+                AddLoot(*session, 1000.0 * i / loot_count);
+            }
+
+            meter.measure([&game] {
+                game.Update(10);
+            });
+        };
+    }
+}
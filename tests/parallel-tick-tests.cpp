@@ -0,0 +1,256 @@
+#include <boost/asio/post.hpp>
+#include <boost/asio/thread_pool.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/application.h"
+#include "../src/loot_generator.h"
+#include "../src/model.h"
+#include "../src/state_snapshot.h"
+#include "../src/state_writer.h"
+#include "test_game.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace model;
+using namespace std::literals;
+namespace net = boost::asio;
+
+namespace {
+
+constexpr int MAP_COUNT = 6;
+constexpr int DOGS_PER_MAP = 4;
+constexpr unsigned CONCURRENCY = 4;
+
+Map::Id MapId(int index) {
+    return Map::Id{"map"s + std::to_string(index)};
+}
+
+// Крест из двух дорог с офисом и лутом вдоль обеих дорог. Скорость
+// собак на картах разная, чтобы сессии расходились между собой
+Map MakeCrossMap(int index) {
+    Map map{MapId(index), "Map "s + std::to_string(index)};
+    map.SetDogSpeed(1 + index * 0.5);
+    map.SetBagCapacity(3);
+    map.SetLootTypesCount(1);
+    map.AddLootValue(5);
+    map.AddRoad({Road::HORIZONTAL, {0, 0}, 40});
+    map.AddRoad({Road::VERTICAL, {20, -20}, 20});
+    map.AddOffice({Office::Id{"o1"s}, {10, 0}, {0, 0}});
+    return map;
+}
+
+Game MakeCrossGame(const std::filesystem::path& save_path) {
+    Game game;
+    game.SetLootGenerator(std::make_unique<loot_gen::LootGenerator>(
+        std::chrono::seconds{1}, 0.0));
+    game.SetDogSpawnMode(false);
+    game.SetSaveFilePath(save_path.string());
+    for (int i = 0; i < MAP_COUNT; ++i) {
+        game.AddMap(MakeCrossMap(i));
+    }
+    return game;
+}
+
+// Состояние игры без игроков: токены и id игроков случайны
+std::string EncodeSessions(
+    Game& game,
+    const std::filesystem::path& save_path,
+    serialization::StateFormat format)
+{
+    game.SetStateFormat(format);
+    game.SaveState();
+    auto state = serialization::ReadStateFile(save_path);
+    state.players.clear();
+    return serialization::EncodeBinaryState(state);
+}
+
+bool IsSameDog(
+    const SessionSnapshot::DogState& lhs,
+    const SessionSnapshot::DogState& rhs)
+{
+    return lhs.name == rhs.name
+        && lhs.position.x == rhs.position.x
+        && lhs.position.y == rhs.position.y
+        && lhs.speed.x == rhs.speed.x
+        && lhs.speed.y == rhs.speed.y
+        && lhs.direction == rhs.direction
+        && lhs.bag.size() == rhs.bag.size()
+        && lhs.score == rhs.score
+        && lhs.changed_tick == rhs.changed_tick;
+}
+
+bool IsSameSnapshot(const SessionSnapshot& lhs, const SessionSnapshot& rhs) {
+    if (lhs.tick != rhs.tick || lhs.dogs.size() != rhs.dogs.size() ||
+        lhs.loot.size() != rhs.loot.size())
+    {
+        return false;
+    }
+    for (size_t i = 0; i < lhs.dogs.size(); ++i) {
+        if (!IsSameDog(lhs.dogs[i], rhs.dogs[i])) {
+            return false;
+        }
+    }
+    for (size_t i = 0; i < lhs.loot.size(); ++i) {
+        if (lhs.loot[i].id != rhs.loot[i].id ||
+            lhs.loot[i].position.x != rhs.loot[i].position.x ||
+            lhs.loot[i].position.y != rhs.loot[i].position.y)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Игра на картах-крестах, в которой собаки бегают в разные стороны,
+// подбирают лут и сдают его в офис
+class CrossGame {
+public:
+    explicit CrossGame(const std::filesystem::path& save_path)
+        : game{MakeCrossGame(save_path)} {
+        for (int i = 0; i < MAP_COUNT; ++i) {
+            auto session = AddPlayer(i, 0)->GetSession();
+            for (int k = 1; k < 8; ++k) {
+                test_game::AddLoot(*session, k * 5.0);
+                test_game::AddLoot(*session, 20, k * 5.0 - 20);
+            }
+        }
+    }
+
+    std::shared_ptr<app::Player> AddPlayer(int map, int dog) {
+        auto player = app::Application::join_game(
+            game, "Dog "s + std::to_string(map) + "."s + std::to_string(dog),
+            MapId(map));
+        players.push_back(player);
+        return player;
+    }
+
+    void Run(int ticks) {
+        static const std::string directions[] = {"R"s, "U"s, "L"s, "D"s};
+        for (int t = 0; t < ticks; ++t) {
+            if (t % 50 == 0) {
+                for (size_t i = 0; i < players.size(); ++i) {
+                    players[i]->MakeAction(directions[(i + t / 50) % 4]);
+                }
+            }
+            game.Update(100);
+        }
+    }
+
+    Game game;
+    std::vector<std::shared_ptr<app::Player>> players;
+};
+
+}  // namespace
+
+SCENARIO("Sessions updated on a thread pool") {
+    GIVEN("two equal games on several maps, one of them on a thread pool") {
+        const auto serial_path =
+            std::filesystem::temp_directory_path() / "serial_tick_test";
+        const auto parallel_path =
+            std::filesystem::temp_directory_path() / "parallel_tick_test";
+
+        net::thread_pool pool{CONCURRENCY};
+        std::atomic<size_t> posted_tasks = 0;
+
+        CrossGame serial{serial_path};
+        CrossGame parallel{parallel_path};
+        for (int i = 0; i < MAP_COUNT; ++i) {
+            for (int dog = 1; dog < DOGS_PER_MAP; ++dog) {
+                serial.AddPlayer(i, dog);
+                parallel.AddPlayer(i, dog);
+            }
+        }
+        parallel.game.SetTickExecutor(
+            [&pool, &posted_tasks](std::function<void()> task) {
+                ++posted_tasks;
+                net::post(pool, std::move(task));
+            },
+            CONCURRENCY);
+
+        WHEN("both games run the same commands") {
+            serial.Run(400);
+            parallel.Run(400);
+
+            THEN("the sessions are updated on the pool") {
+                CHECK(posted_tasks > 0);
+            }
+
+            THEN("every session ends in the same state") {
+                REQUIRE(parallel.game.GetTick() == serial.game.GetTick());
+                REQUIRE(parallel.players.size() == serial.players.size());
+                std::uint64_t total_score = 0;
+                for (size_t i = 0; i < serial.players.size(); ++i) {
+                    const auto expected =
+                        serial.players[i]->GetSession()->GetSnapshot();
+                    const auto actual =
+                        parallel.players[i]->GetSession()->GetSnapshot();
+                    REQUIRE(expected);
+                    REQUIRE(actual);
+                    CHECK(IsSameSnapshot(*actual, *expected));
+                    for (const auto& dog : expected->dogs) {
+                        total_score += dog.score;
+                    }
+                }
+                // Собаки успели донести лут до офиса
+                CHECK(total_score > 0);
+            }
+
+            THEN("the sessions captured on the pool match the serial ones") {
+                for (const auto format : {serialization::StateFormat::TEXT,
+                                          serialization::StateFormat::BINARY})
+                {
+                    const size_t tasks_before = posted_tasks;
+                    const std::string parallel_state =
+                        EncodeSessions(parallel.game, parallel_path, format);
+                    CHECK(posted_tasks > tasks_before);
+                    CHECK(parallel_state ==
+                          EncodeSessions(serial.game, serial_path, format));
+                }
+            }
+        }
+
+        std::filesystem::remove(serial_path);
+        std::filesystem::remove(parallel_path);
+    }
+
+    GIVEN("a game on a thread pool with a session that fails to update") {
+        net::thread_pool pool{CONCURRENCY};
+
+        // Лут появляется сразу, но на карте без дорог ему негде лежать
+        Game game;
+        game.SetLootGenerator(std::make_unique<loot_gen::LootGenerator>(
+            std::chrono::seconds{1}, 1.0));
+        game.SetDogSpawnMode(false);
+        for (int i = 0; i < MAP_COUNT; ++i) {
+            game.AddMap(MakeCrossMap(i));
+        }
+        Map broken{Map::Id{"broken"s}, "Broken"s};
+        broken.SetLootTypesCount(1);
+        broken.AddLootValue(5);
+        game.AddMap(std::move(broken));
+        for (int i = 0; i < MAP_COUNT; ++i) {
+            app::Application::join_game(game, "Rex"s, MapId(i));
+        }
+        game.AddDogToSession(
+            game.MakeDog("Rin"s, {0, 0}), Map::Id{"broken"s});
+
+        game.SetTickExecutor(
+            [&pool](std::function<void()> task) {
+                net::post(pool, std::move(task));
+            },
+            CONCURRENCY);
+
+        WHEN("the game is updated") {
+            THEN("the session's exception reaches the caller") {
+                CHECK_THROWS_AS(game.Update(1000), std::logic_error);
+            }
+        }
+    }
+}
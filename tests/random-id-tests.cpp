@@ -0,0 +1,80 @@
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/application.h"
+#include "../src/random_id.h"
+#include "../src/tagged_uuid.h"
+#include "test_game.h"
+
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std::literals;
+
+SCENARIO("Random identifiers") {
+    GIVEN("a few known bytes") {
+        const std::vector<std::uint8_t> bytes{0x00, 0x0f, 0xa5, 0xff};
+
+        THEN("they are written as lowercase hex pairs") {
+            CHECK(util::ToHex(bytes) == "000fa5ff"s);
+        }
+    }
+
+    GIVEN("identifiers from several batches and threads") {
+        std::vector<util::RandomId> ids;
+        for (int i = 0; i < 1000; ++i) {
+            ids.push_back(util::NewRandomId());
+        }
+        std::thread{[&ids] {
+            for (int i = 0; i < 1000; ++i) {
+                ids.push_back(util::NewRandomId());
+            }
+        }}.join();
+
+        THEN("all of them are different") {
+            CHECK(std::set(ids.begin(), ids.end()).size() == ids.size());
+        }
+    }
+
+    GIVEN("a new UUID and a player token") {
+        const auto uuid = util::detail::UUIDToString(util::detail::NewUUID());
+        const app::Token token = app::PlayerTokens::GenerateToken();
+
+        THEN("the UUID is marked as a random (version 4) one") {
+            REQUIRE(uuid.size() == 36);
+            CHECK(uuid[14] == '4');
+            CHECK(std::string{"89ab"}.find(uuid[19]) != std::string::npos);
+        }
+
+        THEN("the token consists of 32 hex digits") {
+            REQUIRE((*token).size() == 32);
+            CHECK((*token).find_first_not_of("0123456789abcdef") ==
+                  std::string::npos);
+        }
+    }
+}
+
+TEST_CASE("Join throughput", "[.][benchmark]") {
+    BENCHMARK_ADVANCED("join")(Catch::Benchmark::Chronometer meter) {
+        model::Map map = test_game::MakeMap();
+        map.AddRoad({model::Road::HORIZONTAL, {0, 0}, 100});
+        map.AddRoad({model::Road::VERTICAL, {0, 0}, 100});
+        model::Game game = test_game::MakeGame(std::move(map));
+        game.SetDogSpawnMode(true);
+
+        meter.measure([&game] {
+            return app::Application::join_game(
+                game, "Rex"s, test_game::MAP_ID);
+        });
+    };
+
+    BENCHMARK("token") {
+        return app::PlayerTokens::GenerateToken();
+    };
+
+    BENCHMARK("uuid") {
+        return util::detail::NewUUID();
+    };
+}
@@ -0,0 +1,366 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/application.h"
+#include "../src/model.h"
+#include "test_game.h"
+
+#include <cmath>
+#include <limits>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace model;
+using namespace std::literals;
+
+namespace {
+
+constexpr double TOLERANCE = 1e-9;
+
+// Прежнее правило перемещения: дороги, габарит которых пересекает путь
+// собаки или содержит её, отбираются запросом к R-дереву
+class ReferenceMovement {
+public:
+    explicit ReferenceMovement(const Map& map) {
+        for (const Road& road : map.GetRoads()) {
+            roads_.insert(std::make_pair(road.GetBoundingBox(), road));
+        }
+    }
+
+    // При остановке на краю дороги обнуляет speed
+    geom::Point2D Move(
+        geom::Point2D position,
+        geom::Vec2D& speed,
+        DIRECTION dir,
+        double time_delta_s) const
+    {
+        const PointBG current_pos{position.x, position.y};
+        if (dir == DIRECTION::NONE ||
+            (std::abs(speed.x) < std::numeric_limits<double>::epsilon() &&
+             std::abs(speed.y) < std::numeric_limits<double>::epsilon()))
+        {
+            return position;
+        }
+
+        const PointBG target_pos{
+            position.x + speed.x * time_delta_s,
+            position.y + speed.y * time_delta_s};
+
+        Segment movement{current_pos, target_pos};
+        std::vector<std::pair<Box, Road>> relevant_roads;
+        roads_.query(
+            bgi::satisfies([&](const std::pair<Box, Road>& item) {
+                return bg::intersects(movement, item.first) ||
+                       bg::within(current_pos, item.first);
+            }),
+            std::back_inserter(relevant_roads));
+
+        if (relevant_roads.empty()) {
+            return position;
+        }
+
+        for (const auto& [box, road] : relevant_roads) {
+            if (IsPointOnRoad(target_pos, road)) {
+                return {bg::get<0>(target_pos), bg::get<1>(target_pos)};
+            }
+        }
+
+        PointBG stop_pos = current_pos;
+        double max_distance = std::numeric_limits<double>::min();
+        for (const auto& [box, road] : relevant_roads) {
+            if (IsPointOnRoad(current_pos, road)) {
+                PointBG candidate =
+                    FindStopPoint(current_pos, target_pos, road, dir);
+                double dist = bg::distance(current_pos, candidate);
+                if (dist > max_distance) {
+                    max_distance = dist;
+                    stop_pos = candidate;
+                }
+            }
+        }
+
+        speed = {0, 0};
+        return {bg::get<0>(stop_pos), bg::get<1>(stop_pos)};
+    }
+
+private:
+    static bool IsPointOnRoad(const PointBG& point, const Road& road) {
+        const double x = bg::get<0>(point);
+        const double y = bg::get<1>(point);
+        if (road.IsHorizontal()) {
+            const double min_x =
+                std::min(road.GetStart().x, road.GetEnd().x) - ROAD_HALF_WIDTH;
+            const double max_x =
+                std::max(road.GetStart().x, road.GetEnd().x) + ROAD_HALF_WIDTH;
+            return x >= min_x && x <= max_x &&
+                   y >= road.GetStart().y - ROAD_HALF_WIDTH &&
+                   y <= road.GetStart().y + ROAD_HALF_WIDTH;
+        }
+        const double min_y =
+            std::min(road.GetStart().y, road.GetEnd().y) - ROAD_HALF_WIDTH;
+        const double max_y =
+            std::max(road.GetStart().y, road.GetEnd().y) + ROAD_HALF_WIDTH;
+        return y >= min_y && y <= max_y &&
+               x >= road.GetStart().x - ROAD_HALF_WIDTH &&
+               x <= road.GetStart().x + ROAD_HALF_WIDTH;
+    }
+
+    static PointBG FindStopPoint(
+        const PointBG& from, const PointBG& to, const Road& road, DIRECTION dir)
+    {
+        const double x = bg::get<0>(from);
+        const double y = bg::get<1>(from);
+        const double min_x = std::min(road.GetStart().x, road.GetEnd().x);
+        const double max_x = std::max(road.GetStart().x, road.GetEnd().x);
+        const double min_y = std::min(road.GetStart().y, road.GetEnd().y);
+        const double max_y = std::max(road.GetStart().y, road.GetEnd().y);
+        switch (dir) {
+            case DIRECTION::EAST:
+                return {std::min(bg::get<0>(to), max_x + ROAD_HALF_WIDTH), y};
+            case DIRECTION::WEST:
+                return {std::max(bg::get<0>(to), min_x - ROAD_HALF_WIDTH), y};
+            case DIRECTION::NORTH:
+                return {x, std::max(bg::get<1>(to), min_y - ROAD_HALF_WIDTH)};
+            case DIRECTION::SOUTH:
+                return {x, std::min(bg::get<1>(to), max_y + ROAD_HALF_WIDTH)};
+            case DIRECTION::NONE:
+                break;
+        }
+        return from;
+    }
+
+    bgi::rtree<std::pair<Box, Road>, bgi::rstar<16>> roads_;
+};
+
+// Случайная сеть осевых дорог на целочисленной сетке. Дороги бывают
+// нулевой длины, перекрываются и примыкают друг к другу
+Map MakeRandomMap(std::mt19937_64& rng) {
+    std::uniform_int_distribution<Coord> coord{0, 20};
+    std::uniform_int_distribution<Coord> length{-10, 10};
+    std::uniform_int_distribution<int> road_count{1, 12};
+    std::uniform_real_distribution<double> dog_speed{0.5, 5};
+
+    Map map = test_game::MakeMap(dog_speed(rng));
+    for (int i = road_count(rng); i > 0; --i) {
+        const Point start{coord(rng), coord(rng)};
+        if (rng() % 2) {
+            map.AddRoad({Road::HORIZONTAL, start, start.x + length(rng)});
+        } else {
+            map.AddRoad({Road::VERTICAL, start, start.y + length(rng)});
+        }
+    }
+    return map;
+}
+
+// Точка на полосе случайной дороги или рядом с ней. Часть точек лежит
+// ровно на краях полос и концах дорог
+geom::Point2D RandomPointNearRoad(const Map& map, std::mt19937_64& rng) {
+    const auto& roads = map.GetRoads();
+    const Road& road = roads[rng() % roads.size()];
+    const double min_x = std::min(road.GetStart().x, road.GetEnd().x);
+    const double max_x = std::max(road.GetStart().x, road.GetEnd().x);
+    const double min_y = std::min(road.GetStart().y, road.GetEnd().y);
+    const double max_y = std::max(road.GetStart().y, road.GetEnd().y);
+
+    const auto sample = [&rng](double from, double to) {
+        switch (rng() % 4) {
+            case 0:
+                return from;
+            case 1:
+                return to;
+            case 2:
+                return std::round(std::uniform_real_distribution<double>{
+                    from, to}(rng) * 10) / 10;
+            default:
+                return std::uniform_real_distribution<double>{from, to}(rng);
+        }
+    };
+    const double margin = ROAD_HALF_WIDTH + (rng() % 8 == 0 ? 0.1 : 0);
+    return {sample(min_x - margin, max_x + margin),
+            sample(min_y - margin, max_y + margin)};
+}
+
+DIRECTION RandomDirection(std::mt19937_64& rng) {
+    constexpr DIRECTION directions[] = {
+        DIRECTION::NORTH, DIRECTION::SOUTH, DIRECTION::WEST, DIRECTION::EAST,
+        DIRECTION::NONE};
+    return directions[rng() % std::size(directions)];
+}
+
+std::string ToMove(DIRECTION dir) {
+    switch (dir) {
+        case DIRECTION::NORTH:
+            return "U"s;
+        case DIRECTION::SOUTH:
+            return "D"s;
+        case DIRECTION::WEST:
+            return "L"s;
+        case DIRECTION::EAST:
+            return "R"s;
+        case DIRECTION::NONE:
+            break;
+    }
+    return ""s;
+}
+
+geom::Vec2D SpeedFor(DIRECTION dir, double speed) {
+    switch (dir) {
+        case DIRECTION::NORTH:
+            return {0, -speed};
+        case DIRECTION::SOUTH:
+            return {0, speed};
+        case DIRECTION::WEST:
+            return {-speed, 0};
+        case DIRECTION::EAST:
+            return {speed, 0};
+        case DIRECTION::NONE:
+            break;
+    }
+    return {0, 0};
+}
+
+struct ReferenceDog {
+    std::shared_ptr<app::Player> player;
+    geom::Point2D position;
+    geom::Vec2D speed;
+    DIRECTION direction = DIRECTION::NONE;
+};
+
+bool SamePosition(const geom::Point2D& lhs, const geom::Point2D& rhs) {
+    return std::abs(lhs.x - rhs.x) <= TOLERANCE &&
+           std::abs(lhs.y - rhs.y) <= TOLERANCE;
+}
+
+}  // namespace
+
+SCENARIO("Road index movement matches the R-tree rule") {
+    GIVEN("random road networks with dogs placed anywhere near the roads") {
+        constexpr int MAPS = 40;
+        constexpr int TICKS = 100;
+        constexpr int DOGS = 16;
+
+        int moves = 0;
+        int mismatches = 0;
+        int stops = 0;
+        for (int map_index = 0; map_index < MAPS; ++map_index) {
+            std::mt19937_64 rng{static_cast<std::uint64_t>(map_index)};
+            Game game = test_game::MakeGame(MakeRandomMap(rng));
+            game.SetDogRetirementTime(1e9);
+            const Map& map = *game.FindMap(test_game::MAP_ID);
+            const ReferenceMovement reference{map};
+
+            std::vector<ReferenceDog> dogs;
+            for (int i = 0; i < DOGS; ++i) {
+                dogs.push_back({app::Application::join_game(
+                    game, "Dog"s + std::to_string(i), test_game::MAP_ID)});
+            }
+
+            for (int tick = 0; tick < TICKS; ++tick) {
+                // Каждый ход начинается из новой точки, поэтому
+                // проверяется поиск дорог индексом, а не продолжение пути
+                for (auto& dog : dogs) {
+                    dog.position = RandomPointNearRoad(map, rng);
+                    dog.direction = RandomDirection(rng);
+                    dog.speed = SpeedFor(dog.direction, map.GetDogSpeed());
+                    dog.player->GetDog()->SetPosition(dog.position);
+                    dog.player->MakeAction(ToMove(dog.direction));
+                }
+
+                const std::int64_t time_delta =
+                    std::uniform_int_distribution<std::int64_t>{1, 3000}(rng);
+                game.Update(time_delta);
+
+                for (auto& dog : dogs) {
+                    dog.position = reference.Move(
+                        dog.position, dog.speed, dog.direction,
+                        time_delta / 1000.0);
+                    const auto actual = dog.player->GetDog();
+                    ++moves;
+                    stops += dog.speed == geom::Vec2D{0, 0} &&
+                             dog.direction != DIRECTION::NONE;
+                    if (!SamePosition(actual->GetPosition(), dog.position) ||
+                        actual->GetSpeed() != dog.speed)
+                    {
+                        ++mismatches;
+                    }
+                }
+            }
+        }
+
+        THEN("every move ends at the same position with the same speed") {
+            CHECK(moves == MAPS * TICKS * DOGS);
+            CHECK(stops > 0);
+            CHECK(mismatches == 0);
+        }
+    }
+}
+
+SCENARIO("Current road tracking matches the R-tree rule along trajectories") {
+    GIVEN("random road networks with dogs running without teleports") {
+        constexpr int MAPS = 40;
+        constexpr int TICKS = 500;
+        constexpr int DOGS = 8;
+
+        int moves = 0;
+        int steps_on_roads = 0;
+        int mismatches = 0;
+        for (int map_index = 0; map_index < MAPS; ++map_index) {
+            std::mt19937_64 rng{static_cast<std::uint64_t>(1000 + map_index)};
+            Game game = test_game::MakeGame(MakeRandomMap(rng));
+            game.SetDogRetirementTime(1e9);
+            const Map& map = *game.FindMap(test_game::MAP_ID);
+            const ReferenceMovement reference{map};
+
+            std::vector<ReferenceDog> dogs;
+            for (int i = 0; i < DOGS; ++i) {
+                auto& dog = dogs.emplace_back(ReferenceDog{
+                    app::Application::join_game(
+                        game, "Dog"s + std::to_string(i), test_game::MAP_ID)});
+                dog.position = RandomPointNearRoad(map, rng);
+                dog.player->GetDog()->SetPosition(dog.position);
+            }
+
+            // Собаки продолжают путь с того места, где остановились, и
+            // переходят на пересекающие дороги, поэтому движение идёт
+            // по дороге, запомненной собакой, и по её перекрёсткам
+            for (int tick = 0; tick < TICKS; ++tick) {
+                for (auto& dog : dogs) {
+                    if (rng() % 4 == 0) {
+                        dog.direction = RandomDirection(rng);
+                        dog.speed = SpeedFor(dog.direction, map.GetDogSpeed());
+                        dog.player->MakeAction(ToMove(dog.direction));
+                    }
+                }
+
+                const std::int64_t time_delta =
+                    std::uniform_int_distribution<std::int64_t>{1, 1000}(rng);
+                game.Update(time_delta);
+
+                for (auto& dog : dogs) {
+                    const geom::Point2D from = dog.position;
+                    dog.position = reference.Move(
+                        dog.position, dog.speed, dog.direction,
+                        time_delta / 1000.0);
+                    const auto actual = dog.player->GetDog();
+                    ++moves;
+                    steps_on_roads += dog.position != from;
+                    if (!SamePosition(actual->GetPosition(), dog.position) ||
+                        actual->GetSpeed() != dog.speed)
+                    {
+                        ++mismatches;
+                        // Дальше сравнивается путь из одной точки
+                        dog.position = actual->GetPosition();
+                        dog.speed = actual->GetSpeed();
+                    }
+                }
+            }
+        }
+
+        THEN("every step ends at the same position with the same speed") {
+            CHECK(moves == MAPS * TICKS * DOGS);
+            CHECK(steps_on_roads > moves / 10);
+            CHECK(mismatches == 0);
+        }
+    }
+}
@@ -0,0 +1,113 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+
+#include "../src/application.h"
+#include "../src/model.h"
+#include "test_game.h"
+
+#include <string>
+
+using namespace model;
+using namespace std::literals;
+using test_game::MakeGame;
+using test_game::MakeMap;
+using test_game::MAP_ID;
+using Catch::Matchers::WithinAbs;
+
+namespace {
+
+// Дорога (0, 0)-(10, 0) продолжена перекрывающей её (6, 0)-(15, 0),
+// пересечена дорогой x = 5 и примыкает к дороге x = 8 снизу (T-образный
+// перекрёсток)
+Map MakeRoadsMap() {
+    Map map = MakeMap();
+    map.AddRoad({Road::HORIZONTAL, {0, 0}, 10});
+    map.AddRoad({Road::VERTICAL, {5, -5}, 5});
+    map.AddRoad({Road::VERTICAL, {8, 0}, 6});
+    map.AddRoad({Road::HORIZONTAL, {6, 0}, 15});
+    return map;
+}
+
+}  // namespace
+
+SCENARIO("Dogs move along crossing and overlapping roads") {
+    GIVEN("a dog at the start of the first road, moving in 1 s ticks") {
+        Game game = MakeGame(MakeRoadsMap());
+        auto player = app::Application::join_game(game, "Rex"s, MAP_ID);
+        auto dog = player->GetDog();
+        const auto run = [&game](int seconds) {
+            for (int i = 0; i < seconds; ++i) {
+                game.Update(1000);
+            }
+        };
+        const auto check_position = [&dog](double x, double y) {
+            CHECK_THAT(dog->GetPosition().x, WithinAbs(x, 1e-9));
+            CHECK_THAT(dog->GetPosition().y, WithinAbs(y, 1e-9));
+        };
+
+        WHEN("it runs east past the end of the first road") {
+            player->MakeAction("R"s);
+            run(20);
+
+            THEN("the overlapping road carries it to its own end") {
+                check_position(15.4, 0);
+                CHECK(dog->GetSpeed().x == 0);
+            }
+        }
+
+        WHEN("it turns north at the crossing") {
+            player->MakeAction("R"s);
+            run(5);
+            player->MakeAction("U"s);
+            run(3);
+
+            THEN("it moves along the crossing road") {
+                check_position(5, -3);
+            }
+
+            AND_WHEN("it keeps running") {
+                run(10);
+
+                THEN("it stops at the end of the crossing road") {
+                    check_position(5, -5.4);
+                }
+            }
+        }
+
+        WHEN("it turns south at the T-junction and then west") {
+            player->MakeAction("R"s);
+            run(8);
+            player->MakeAction("D"s);
+            run(3);
+            const geom::Point2D on_the_way = dog->GetPosition();
+            player->MakeAction("L"s);
+            run(2);
+
+            THEN("it moves down the joining road and stops at its edge") {
+                CHECK_THAT(on_the_way.x, WithinAbs(8, 1e-9));
+                CHECK_THAT(on_the_way.y, WithinAbs(3, 1e-9));
+                check_position(7.6, 3);
+            }
+
+            AND_WHEN("it runs south to the end of the joining road") {
+                player->MakeAction("D"s);
+                run(10);
+
+                THEN("it stops at the road end") {
+                    check_position(7.6, 6.4);
+                }
+            }
+        }
+
+        WHEN("it turns north away from any crossing") {
+            player->MakeAction("R"s);
+            run(3);
+            player->MakeAction("U"s);
+            run(2);
+
+            THEN("it only reaches the edge of its road") {
+                check_position(3, -0.4);
+            }
+        }
+    }
+}
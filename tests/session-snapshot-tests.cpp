@@ -0,0 +1,303 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/application.h"
+#include "../src/model.h"
+#include "test_game.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace model;
+using namespace std::literals;
+using test_game::MakeGame;
+using test_game::MAP_ID;
+
+namespace {
+
+SessionSnapshot::DogState MakeDog(std::uint32_t player_id, double x, double y) {
+    return {player_id, "Dog", {x, y}, {0, 0}, NORTH, {}, 0};
+}
+
+SessionSnapshot::LootState MakeLoot(std::uint32_t id, double x, double y) {
+    return {id, 0, {x, y}};
+}
+
+const SessionSnapshot::DogState* FindDog(
+    const SessionSnapshot& snapshot,
+    std::uint32_t player_id)
+{
+    auto it = std::find_if(snapshot.dogs.begin(), snapshot.dogs.end(),
+        [player_id](const auto& dog) {
+            return dog.player_id == player_id;
+        });
+    return it != snapshot.dogs.end() ? &*it : nullptr;
+}
+
+const SessionSnapshot::LootState* FindLoot(
+    const SessionSnapshot& snapshot,
+    std::uint32_t id)
+{
+    auto it = std::find_if(snapshot.loot.begin(), snapshot.loot.end(),
+        [id](const auto& item) {
+            return item.id == id;
+        });
+    return it != snapshot.loot.end() ? &*it : nullptr;
+}
+
+bool HasRemoval(
+    const SessionSnapshot::Removals& removals,
+    std::uint64_t tick,
+    std::uint32_t id)
+{
+    return std::any_of(removals.begin(), removals.end(),
+        [tick, id](const auto& removal) {
+            return removal.tick == tick && removal.id == id;
+        });
+}
+
+}  // namespace
+
+SCENARIO("Objects visible to a player") {
+    GIVEN("a snapshot with view radius 5 and the player's dog at (0, 0)") {
+        SessionSnapshot snapshot;
+        snapshot.view_radius = 5;
+        snapshot.dogs = {
+            MakeDog(1, 0, 0),
+            MakeDog(2, 3, 0),    // внутри круга
+            MakeDog(3, 4, 4),    // в описанном квадрате, но вне круга
+            MakeDog(4, 10, 0),   // вне квадрата
+        };
+        snapshot.loot = {
+            MakeLoot(10, 0, 5),    // на границе круга
+            MakeLoot(11, -3, -3),  // внутри круга
+            MakeLoot(12, -5, 5),   // в углу квадрата
+            MakeLoot(13, 0, -6),   // вне квадрата
+        };
+
+        WHEN("the player's visible objects are requested") {
+            const auto visible = snapshot.FindVisible(1);
+
+            THEN("only objects within the view radius are returned") {
+                REQUIRE(visible.has_value());
+                CHECK(visible->dogs == std::vector<size_t>{0, 1});
+                CHECK(visible->loot == std::vector<size_t>{0, 1});
+            }
+        }
+
+        WHEN("another player's visible objects are requested") {
+            const auto visible = snapshot.FindVisible(3);
+
+            THEN("the view is centered on that player's dog") {
+                REQUIRE(visible.has_value());
+                CHECK(visible->dogs == std::vector<size_t>{1, 2});
+                CHECK(visible->loot == std::vector<size_t>{0});
+            }
+        }
+
+        WHEN("a player without a dog in the snapshot is requested") {
+            THEN("nothing is returned") {
+                CHECK_FALSE(snapshot.FindVisible(99).has_value());
+            }
+        }
+    }
+}
+
+SCENARIO("Changes recorded in session snapshots") {
+    GIVEN("a game with a moving dog, an idle dog and two pieces of loot") {
+        Game game = MakeGame();
+        game.SetDogRetirementTime(5);
+        auto rex = app::Application::join_game(game, "Rex"s, MAP_ID);
+        auto session = rex->GetSession();
+        const auto near = test_game::AddLoot(*session, 3.5);
+        const auto far = test_game::AddLoot(*session, 900);
+        // Снимок со входом второго игрока включает и лут
+        auto rin = app::Application::join_game(game, "Rin"s, MAP_ID);
+        rex->MakeAction("R"s);
+
+        // Обновляет игру по секунде, пока pred не выполнится
+        const auto run_until = [&game](auto pred) {
+            for (int i = 0; i < 10 && !pred(); ++i) {
+                game.Update(1000);
+            }
+            REQUIRE(pred());
+            return game.GetTick();
+        };
+
+        WHEN("two ticks pass") {
+            game.Update(1000);
+            game.Update(1000);
+            const auto snapshot = session->GetSnapshot();
+
+            THEN("the moving dog is changed on the last tick") {
+                REQUIRE(FindDog(*snapshot, rex->GetId()));
+                CHECK(FindDog(*snapshot, rex->GetId())->changed_tick == 2);
+            }
+
+            THEN("the idle dog keeps the tick it joined on") {
+                REQUIRE(FindDog(*snapshot, rin->GetId()));
+                CHECK(FindDog(*snapshot, rin->GetId())->changed_tick == 1);
+            }
+
+            THEN("the loot keeps the tick it appeared on") {
+                REQUIRE(FindLoot(*snapshot, far->GetId()));
+                CHECK(FindLoot(*snapshot, far->GetId())->changed_tick == 1);
+                CHECK(snapshot->removed_loot->empty());
+                CHECK(snapshot->removed_players->empty());
+            }
+        }
+
+        WHEN("the moving dog collects loot") {
+            const auto tick = run_until([&] {
+                return !FindLoot(*session->GetSnapshot(), near->GetId());
+            });
+            const auto snapshot = session->GetSnapshot();
+
+            THEN("the loot removal is recorded at the tick of the change") {
+                CHECK(HasRemoval(
+                    *snapshot->removed_loot, tick, near->GetId()));
+                REQUIRE(FindLoot(*snapshot, far->GetId()));
+                CHECK(FindLoot(*snapshot, far->GetId())->changed_tick == 1);
+            }
+
+            THEN("the dog carrying it is changed at the same tick") {
+                const auto* dog = FindDog(*snapshot, rex->GetId());
+                REQUIRE(dog);
+                CHECK(dog->changed_tick == tick);
+                REQUIRE(dog->bag.size() == 1);
+                CHECK(dog->bag[0].id == near->GetId());
+            }
+        }
+
+        WHEN("the idle dog retires") {
+            const auto tick = run_until([&] {
+                return !FindDog(*session->GetSnapshot(), rin->GetId());
+            });
+
+            THEN("the player removal is recorded at the tick of the change") {
+                const auto snapshot = session->GetSnapshot();
+                CHECK(HasRemoval(
+                    *snapshot->removed_players, tick, rin->GetId()));
+                CHECK(snapshot->history_start == 0);
+                CHECK(snapshot->HasHistorySince(tick - 1));
+            }
+
+            AND_WHEN("the removal is about to leave the history") {
+                while (game.GetTick() < tick + STATE_HISTORY_TICKS - 1) {
+                    game.Update(1000);
+                }
+                const auto snapshot = session->GetSnapshot();
+
+                THEN("it is still recorded") {
+                    CHECK(HasRemoval(
+                        *snapshot->removed_players, tick, rin->GetId()));
+                    CHECK(snapshot->HasHistorySince(tick - 1));
+                }
+            }
+
+            AND_WHEN("the removal leaves the history") {
+                while (game.GetTick() < tick + STATE_HISTORY_TICKS) {
+                    game.Update(1000);
+                }
+                const auto snapshot = session->GetSnapshot();
+
+                THEN("it is dropped and older ticks need the full state") {
+                    CHECK(snapshot->history_start == tick);
+                    CHECK(snapshot->removed_players->empty());
+                    CHECK_FALSE(snapshot->HasHistorySince(tick - 1));
+                    CHECK(snapshot->HasHistorySince(tick));
+                }
+            }
+        }
+    }
+}
+
+SCENARIO("Changes since a tick that the snapshot cannot restore") {
+    GIVEN("a game that ran longer than the history") {
+        Game game = MakeGame();
+        auto rex = app::Application::join_game(game, "Rex"s, MAP_ID);
+        rex->MakeAction("R"s);
+        for (std::uint64_t i = 0; i < STATE_HISTORY_TICKS + 20; ++i) {
+            game.Update(100);
+        }
+        const auto snapshot = rex->GetSession()->GetSnapshot();
+        const std::uint64_t tick = snapshot->tick;
+        REQUIRE(tick == STATE_HISTORY_TICKS + 20);
+
+        WHEN("since is older than the history") {
+            THEN("the full state is needed") {
+                CHECK(snapshot->history_start == tick - STATE_HISTORY_TICKS);
+                CHECK_FALSE(snapshot->HasHistorySince(
+                    tick - STATE_HISTORY_TICKS - 1));
+                CHECK(snapshot->HasHistorySince(tick - STATE_HISTORY_TICKS));
+            }
+        }
+
+        WHEN("since is ahead of the snapshot") {
+            THEN("the full state is needed") {
+                CHECK(snapshot->HasHistorySince(tick));
+                CHECK_FALSE(snapshot->HasHistorySince(tick + 1));
+            }
+        }
+    }
+
+    GIVEN("a session created after the game started") {
+        Game game = MakeGame();
+        for (int i = 0; i < 5; ++i) {
+            game.Update(100);
+        }
+        auto rex = app::Application::join_game(game, "Rex"s, MAP_ID);
+
+        WHEN("its first snapshot is published") {
+            const auto snapshot = rex->GetSession()->GetSnapshot();
+
+            THEN("the history starts at that snapshot") {
+                CHECK(snapshot->tick == 5);
+                CHECK(snapshot->history_start == 5);
+                CHECK_FALSE(snapshot->HasHistorySince(4));
+                CHECK(snapshot->HasHistorySince(5));
+            }
+        }
+    }
+}
+
+SCENARIO("Snapshots published between ticks") {
+    GIVEN("a game with an idle dog after three ticks") {
+        Game game = MakeGame();
+        auto rex = app::Application::join_game(game, "Rex"s, MAP_ID);
+        for (int i = 0; i < 3; ++i) {
+            game.Update(100);
+        }
+
+        WHEN("another player joins") {
+            auto rin = app::Application::join_game(game, "Rin"s, MAP_ID);
+            const auto snapshot = rin->GetSession()->GetSnapshot();
+
+            THEN("the new dog is changed on the next tick") {
+                CHECK(snapshot->tick == 3);
+                REQUIRE(FindDog(*snapshot, rin->GetId()));
+                CHECK(FindDog(*snapshot, rin->GetId())->changed_tick == 4);
+            }
+
+            THEN("clients that received tick 3 see it in the delta") {
+                CHECK(snapshot->HasHistorySince(3));
+            }
+
+            THEN("unchanged dogs keep their tick") {
+                REQUIRE(FindDog(*snapshot, rex->GetId()));
+                CHECK(FindDog(*snapshot, rex->GetId())->changed_tick == 1);
+            }
+
+            AND_WHEN("the next tick passes") {
+                game.Update(100);
+                const auto next = rin->GetSession()->GetSnapshot();
+
+                THEN("the idle new dog keeps the tick it joined on") {
+                    REQUIRE(FindDog(*next, rin->GetId()));
+                    CHECK(FindDog(*next, rin->GetId())->changed_tick == 4);
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,61 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/slot_map.h"
+
+#include <algorithm>
+#include <string>
+
+using namespace std::literals;
+
+SCENARIO("Slot map") {
+    using Map = util::SlotMap<std::string>;
+
+    GIVEN("a slot map with three values") {
+        Map map;
+        const Map::Key a = map.Insert("a"s);
+        const Map::Key b = map.Insert("b"s);
+        const Map::Key c = map.Insert("c"s);
+
+        THEN("values are stored densely in insertion order") {
+            REQUIRE(map.Size() == 3);
+            CHECK(std::ranges::equal(map.Values(),
+                std::vector{"a"s, "b"s, "c"s}));
+            CHECK(map.KeyAt(1) == b);
+        }
+
+        WHEN("a value in the middle is erased") {
+            CHECK(map.Erase(b) == "b"s);
+
+            THEN("the last value takes its place") {
+                CHECK(std::ranges::equal(map.Values(),
+                    std::vector{"a"s, "c"s}));
+                CHECK(map.KeyAt(1) == c);
+            }
+
+            THEN("the other keys still find their values") {
+                REQUIRE(map.Find(a) != nullptr);
+                CHECK(*map.Find(a) == "a"s);
+                REQUIRE(map.Find(c) != nullptr);
+                CHECK(*map.Find(c) == "c"s);
+            }
+
+            THEN("the erased key is no longer valid") {
+                CHECK_FALSE(map.Contains(b));
+                CHECK(map.Find(b) == nullptr);
+                CHECK_THROWS_AS(map.Erase(b), std::out_of_range);
+            }
+
+            AND_WHEN("a new value reuses the freed slot") {
+                const Map::Key d = map.Insert("d"s);
+
+                THEN("the stale key does not see the new value") {
+                    CHECK(d.slot == b.slot);
+                    CHECK(d.generation != b.generation);
+                    CHECK(map.Find(b) == nullptr);
+                    REQUIRE(map.Find(d) != nullptr);
+                    CHECK(*map.Find(d) == "d"s);
+                }
+            }
+        }
+    }
+}
@@ -1,10 +1,16 @@
 #include <boost/archive/text_iarchive.hpp>
 #include <boost/archive/text_oarchive.hpp>
 #include <catch2/catch_test_macros.hpp>
+#include <filesystem>
+#include <fstream>
 #include <sstream>
 
+#include "../src/application.h"
 #include "../src/model.h"
 #include "../src/model_serialization.h"
+#include "../src/state_snapshot.h"
+#include "../src/state_writer.h"
+#include "test_game.h"
 
 using namespace model;
 using namespace std::literals;
@@ -57,7 +63,6 @@ SCENARIO_METHOD(Fixture, "Loot item serialization") {
         model::Loot item{10, {20, 30}, 40};
         item.SetId(3);
         item.SetWidth(0.0);
-        model::Loot::SetLootCounter(5);
         WHEN("loot item is serialized") {
             {
                 serialization::LootRepr repr{item};
@@ -75,7 +80,6 @@ SCENARIO_METHOD(Fixture, "Loot item serialization") {
                 CHECK(item.GetPosition() == restored.GetPosition());
                 CHECK(item.GetValue() == restored.GetValue());
                 CHECK(item.GetWidth() == restored.GetWidth());
-                CHECK(item.GetLootCounter() == restored.GetLootCounter());
             }
         }
     }
@@ -96,7 +100,6 @@ SCENARIO_METHOD(Fixture, "Dog Serialization") {
             model::Loot item_2{10, {2, 30}, 20};
             item_2.SetId(3);
             item_2.SetWidth(0.0);
-            model::Loot::SetLootCounter(5);
 
             auto item_1_ptr = std::make_shared<model::Loot>(item_1);
             auto item_2_ptr = std::make_shared<model::Loot>(item_2);
@@ -106,7 +109,6 @@ SCENARIO_METHOD(Fixture, "Dog Serialization") {
 
             dog.SetWidth(0.5);
             dog.SetScore(42);
-            model::Dog::SetDogCounter(5);
             return dog;
         }();
 
@@ -130,8 +132,313 @@ SCENARIO_METHOD(Fixture, "Dog Serialization") {
                 CHECK(dog.GetLoot().size() == restored.GetLoot().size());
                 CHECK(dog.GetWidth() == restored.GetWidth());
                 CHECK(dog.GetScore() == restored.GetScore());
-                CHECK(dog.GetDogCounter() == restored.GetDogCounter());
             }
         }
     }
-}
\ No newline at end of file
+}
+
+SCENARIO_METHOD(Fixture, "Game session serialization") {
+    GIVEN("a game session with dogs and loot") {
+        model::Game game;
+        model::Map map{model::Map::Id{"map1"s}, "Map 1"s};
+        map.AddRoad({model::Road::HORIZONTAL, {0, 0}, 10});
+        game.AddMap(std::move(map));
+        const model::Map* map_ptr = game.FindMap(model::Map::Id{"map1"s});
+
+        model::GameSession session{map_ptr, 7};
+
+        auto dog = std::make_shared<model::Dog>("Pluto"s, geom::Point2D{1, 0});
+        dog->SetId(session.NextDogId());
+        session.AddDog(dog);
+
+        auto loot = std::make_shared<model::Loot>(1, geom::Point2D{5, 0}, 10);
+        loot->SetId(session.NextLootId());
+        session.AddLoot(loot);
+        session.NextLootId();
+
+        WHEN("session is serialized") {
+            {
+                serialization::GameSessionRepr repr{session};
+                output_archive << repr;
+            }
+
+            THEN("id counters are restored together with the session") {
+                InputArchive input_archive{strm};
+                serialization::GameSessionRepr repr;
+                input_archive >> repr;
+                const auto restored = repr.Restore(game);
+
+                CHECK(restored.GetId() == session.GetId());
+                CHECK(restored.GetMap() == map_ptr);
+                CHECK(restored.GetDogs().size() == session.GetDogs().size());
+                CHECK(restored.GetLoot().size() == session.GetLoot().size());
+                CHECK(restored.GetDogCounter() == session.GetDogCounter());
+                CHECK(restored.GetLootCounter() == session.GetLootCounter());
+            }
+        }
+    }
+}
+
+SCENARIO("Background state saves") {
+    GIVEN("a game that saves its state on every tick") {
+        const auto path =
+            std::filesystem::temp_directory_path() / "background_save_test";
+        std::filesystem::remove(path);
+
+        const auto make_game = [&path] {
+            model::Game game = test_game::MakeGame(10);
+            game.SetSaveFilePath(path.string());
+            return game;
+        };
+
+        WHEN("the game stops right after a periodic save") {
+            {
+                model::Game game = make_game();
+                game.SetSavePeriod(50);
+                app::Application::join_game(
+                    game, "Rex"s, test_game::MAP_ID);
+                game.Update(50);
+                app::Application::join_game(
+                    game, "Rin"s, test_game::MAP_ID);
+                game.Update(50);
+            }
+
+            THEN("the last captured state is written before exit") {
+                model::Game restored = make_game();
+                restored.LoadState();
+                CHECK(restored.GetPlayers().GetPlayers().size() == 2);
+            }
+        }
+
+        std::filesystem::remove(path);
+    }
+}
+
+SCENARIO("Tick counter in saved state") {
+    GIVEN("fixed-step games with part of a step accumulated") {
+        const auto path =
+            std::filesystem::temp_directory_path() / "tick_state_test";
+        const auto make_game = [&path] {
+            model::Game game = test_game::MakeGame(10);
+            game.SetFixedTimestep(10, 4);
+            game.SetSaveFilePath(path.string());
+            return game;
+        };
+
+        WHEN("the state is saved and loaded into a new game") {
+            THEN("the tick counter and the remainder continue") {
+                for (const auto format : {serialization::StateFormat::TEXT,
+                                          serialization::StateFormat::BINARY})
+                {
+                    model::Game game = make_game();
+                    app::Application::join_game(
+                        game, "Rex"s, test_game::MAP_ID);
+                    game.Update(25);
+                    game.Update(20);
+                    game.SetStateFormat(format);
+                    game.SaveState();
+
+                    model::Game restored = make_game();
+                    restored.LoadState();
+                    CHECK(restored.GetTick() == game.GetTick());
+                    restored.Update(5);
+                    game.Update(5);
+                    CHECK(restored.GetTick() == game.GetTick());
+                    CHECK(restored.GetTick() == 3);
+                }
+            }
+        }
+        std::filesystem::remove(path);
+    }
+}
+
+SCENARIO("Binary state snapshots") {
+    GIVEN("a game with players, a moving dog and lost objects") {
+        model::Game game = test_game::MakeGame(10);
+        auto rex = app::Application::join_game(
+            game, "Rex"s, test_game::MAP_ID);
+        app::Application::join_game(game, "Rin"s, test_game::MAP_ID);
+        rex->MakeAction("R"s);
+        game.Update(1500);
+        auto session = rex->GetSession();
+        auto loot = std::make_shared<model::Loot>(
+            0, geom::Point2D{5, 0.25}, 7);
+        loot->SetId(session->NextLootId());
+        session->AddLoot(loot);
+
+        serialization::GameStateRepr state;
+        state.sessions.emplace_back(*session);
+        for (const auto& player : game.GetPlayers().GetPlayers()) {
+            state.players.emplace_back(*player);
+        }
+        const std::string data = serialization::EncodeBinaryState(state);
+
+        WHEN("the snapshot is decoded and restored") {
+            const auto decoded = serialization::DecodeBinaryState(data);
+            model::Game other = test_game::MakeGame(10);
+            const auto restored = decoded.sessions.at(0).Restore(other);
+
+            THEN("sessions, dogs and loot match the original") {
+                REQUIRE(decoded.players.size() == 2);
+                REQUIRE(restored.GetDogs().size() == 2);
+                for (size_t i = 0; i < 2; ++i) {
+                    const auto& dog = *session->GetDogs()[i];
+                    const auto& copy = *restored.GetDogs()[i];
+                    CHECK(copy.GetName() == dog.GetName());
+                    CHECK(copy.GetPosition() == dog.GetPosition());
+                    CHECK(copy.GetSpeed() == dog.GetSpeed());
+                    CHECK(copy.GetDirection() == dog.GetDirection());
+                }
+                REQUIRE(restored.GetLoot().size() == 1);
+                CHECK(restored.GetLoot().front()->GetPosition() ==
+                      loot->GetPosition());
+                CHECK(restored.GetLootCounter() == session->GetLootCounter());
+            }
+        }
+
+        WHEN("the snapshot is truncated or a byte is changed") {
+            std::string damaged = data;
+            damaged[damaged.size() / 2] ^= 0x20;
+
+            THEN("it is rejected") {
+                CHECK_THROWS_AS(
+                    serialization::DecodeBinaryState(
+                        std::string_view{data}.substr(0, data.size() - 1)),
+                    std::runtime_error);
+                CHECK_THROWS_AS(serialization::DecodeBinaryState(damaged),
+                                std::runtime_error);
+            }
+        }
+
+        WHEN("the snapshot is written with older object versions") {
+            const auto decoded = serialization::DecodeBinaryState(
+                serialization::EncodeBinaryState(
+                    state, serialization::ReprVersions{0, 0, 0, 0}));
+
+            THEN("they are read with the versions stored in the file") {
+                REQUIRE(decoded.players.size() == 2);
+                model::Game other = test_game::MakeGame(10);
+                const auto restored = decoded.sessions.at(0).Restore(other);
+                REQUIRE(restored.GetDogs().size() == 2);
+                CHECK(restored.GetDogs()[0]->GetPosition() ==
+                      session->GetDogs()[0]->GetPosition());
+                REQUIRE(restored.GetLoot().size() == 1);
+                CHECK(restored.GetLoot().front()->GetValue() == 7);
+            }
+        }
+
+        WHEN("an object version is newer than the current one") {
+            serialization::ReprVersions versions;
+            ++versions.player;
+            const std::string newer =
+                serialization::EncodeBinaryState(state, versions);
+
+            THEN("the snapshot is rejected") {
+                CHECK_THROWS_AS(serialization::DecodeBinaryState(newer),
+                                std::runtime_error);
+            }
+        }
+
+        WHEN("a damaged file is loaded into a running game") {
+            const auto path =
+                std::filesystem::temp_directory_path() / "damaged_state_test";
+            {
+                std::string damaged = data;
+                damaged.back() ^= 0x01;
+                std::ofstream{path, std::ios::binary} << damaged;
+            }
+            model::Game other = test_game::MakeGame(10);
+            other.SetSaveFilePath(path.string());
+            auto ace = app::Application::join_game(
+                other, "Ace"s, test_game::MAP_ID);
+
+            THEN("loading fails before the game is changed") {
+                CHECK_THROWS(other.LoadState());
+                CHECK(other.GetPlayers().GetPlayers().size() == 1);
+                CHECK(other.FindSessionById(ace->GetSession()->GetId()) ==
+                      ace->GetSession());
+            }
+            std::filesystem::remove(path);
+        }
+
+        WHEN("a player refers to a missing dog or session") {
+            const auto path =
+                std::filesystem::temp_directory_path() / "dangling_state_test";
+            serialization::GameStateRepr dangling;
+            dangling.players = state.players;
+            dangling.sessions.emplace_back(*session);
+            auto late = app::Application::join_game(
+                game, "Late"s, test_game::MAP_ID);
+            dangling.players.emplace_back(*late);
+
+            model::Game other = test_game::MakeGame(10);
+            other.SetSaveFilePath(path.string());
+            auto ace = app::Application::join_game(
+                other, "Ace"s, test_game::MAP_ID);
+
+            THEN("loading fails before the game is changed") {
+                serialization::WriteStateFile(
+                    path, dangling, serialization::StateFormat::BINARY);
+                CHECK_THROWS_AS(other.LoadState(), std::runtime_error);
+
+                dangling.sessions.clear();
+                dangling.players.pop_back();
+                serialization::WriteStateFile(
+                    path, dangling, serialization::StateFormat::BINARY);
+                CHECK_THROWS_AS(other.LoadState(), std::runtime_error);
+
+                CHECK(other.GetPlayers().GetPlayers().size() == 1);
+                CHECK(other.FindSessionById(ace->GetSession()->GetId()) ==
+                      ace->GetSession());
+            }
+            std::filesystem::remove(path);
+        }
+
+        WHEN("the players of a text file are truncated") {
+            const auto path =
+                std::filesystem::temp_directory_path() / "truncated_text_test";
+            serialization::WriteStateFile(
+                path, state, serialization::StateFormat::TEXT);
+            std::string text;
+            {
+                std::ifstream in{path, std::ios::binary};
+                text.assign(std::istreambuf_iterator<char>{in},
+                            std::istreambuf_iterator<char>{});
+            }
+            // Последнему игроку не хватает идентификатора
+            text.resize(text.rfind(" 4 game"));
+            text.resize(text.rfind(' '));
+            std::ofstream{path, std::ios::binary | std::ios::trunc} << text;
+
+            THEN("reading fails instead of returning part of the players") {
+                CHECK_THROWS_AS(serialization::ReadStateFile(path),
+                                std::runtime_error);
+            }
+            std::filesystem::remove(path);
+        }
+
+        WHEN("a text file is converted to the binary format") {
+            const auto text_path =
+                std::filesystem::temp_directory_path() / "text_state_test";
+            const auto binary_path =
+                std::filesystem::temp_directory_path() / "binary_state_test";
+            serialization::WriteStateFile(
+                text_path, state, serialization::StateFormat::TEXT);
+            serialization::WriteStateFile(
+                binary_path,
+                serialization::ReadStateFile(text_path),
+                serialization::StateFormat::BINARY);
+
+            THEN("the binary file is smaller and holds the same state") {
+                CHECK(std::filesystem::file_size(binary_path) <
+                      std::filesystem::file_size(text_path));
+                model::Game other = test_game::MakeGame(10);
+                other.SetSaveFilePath(binary_path.string());
+                other.LoadState();
+                CHECK(other.GetPlayers().GetPlayers().size() == 2);
+            }
+            std::filesystem::remove(text_path);
+            std::filesystem::remove(binary_path);
+        }
+    }
+}
@@ -0,0 +1,61 @@
+// test_game.h
+#pragma once
+
+#include "../src/loot_generator.h"
+#include "../src/model.h"
+
+#include <chrono>
+#include <memory>
+#include <string>
+
+namespace test_game {
+
+inline const model::Map::Id MAP_ID{std::string{"map1"}};
+
+// Карта MAP_ID без дорог с одним типом лута ценностью 5
+inline model::Map MakeMap(
+    double dog_speed = 1,
+    std::uint32_t bag_capacity = 3)
+{
+    model::Map map{MAP_ID, std::string{"Map 1"}};
+    map.SetDogSpeed(dog_speed);
+    map.SetBagCapacity(bag_capacity);
+    map.SetLootTypesCount(1);
+    map.AddLootValue(5);
+    return map;
+}
+
+// Собаки появляются в начале первой дороги, лут сам не появляется
+inline model::Game MakeGame(model::Map map) {
+    model::Game game;
+    game.SetLootGenerator(std::make_unique<loot_gen::LootGenerator>(
+        std::chrono::seconds{1}, 0.0));
+    game.SetDogSpawnMode(false);
+    game.AddMap(std::move(map));
+    return game;
+}
+
+// Игра с горизонтальной дорогой длиной length из (0, 0)
+inline model::Game MakeGame(
+    model::Coord length = 1000,
+    double dog_speed = 1,
+    std::uint32_t bag_capacity = 3)
+{
+    model::Map map = MakeMap(dog_speed, bag_capacity);
+    map.AddRoad({model::Road::HORIZONTAL, {0, 0}, length});
+    return MakeGame(std::move(map));
+}
+
+// Кладёт на карту сессии лут типа 0 ценностью 5 в точке (x, y)
+inline std::shared_ptr<model::Loot> AddLoot(
+    model::GameSession& session,
+    double x,
+    double y = 0)
+{
+    auto loot = std::make_shared<model::Loot>(0, geom::Point2D{x, y}, 5);
+    loot->SetId(session.NextLootId());
+    session.AddLoot(loot);
+    return loot;
+}
+
+}  // namespace test_game
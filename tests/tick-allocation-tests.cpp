@@ -0,0 +1,229 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/application.h"
+#include "../src/frame_arena.h"
+#include "../src/model.h"
+#include "test_game.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+using namespace model;
+using namespace std::literals;
+using test_game::MakeGame;
+using test_game::MAP_ID;
+
+namespace {
+
+// Считаются только выделения потока, в котором включён подсчёт
+thread_local bool count_allocations = false;
+thread_local size_t allocation_count = 0;
+
+class AllocationCounter {
+public:
+    AllocationCounter() {
+        allocation_count = 0;
+        count_allocations = true;
+    }
+
+    ~AllocationCounter() {
+        count_allocations = false;
+    }
+
+    // Проверки Catch сами выделяют память, поэтому подсчёт нужно
+    // остановить до них
+    size_t Stop() {
+        count_allocations = false;
+        return allocation_count;
+    }
+};
+
+constexpr std::int64_t TICK_MS = 100;
+constexpr model::Coord ROAD_LENGTH = 40;
+
+// Лут появляется, как только его становится меньше, чем собак,
+// а офисы стоят на пути собак
+Game MakeBusyGame() {
+    Map map = test_game::MakeMap(4, 3);
+    map.AddRoad({Road::HORIZONTAL, {0, 0}, ROAD_LENGTH});
+    map.AddOffice({Office::Id{"o1"s}, {10, 0}, {0, 0}});
+    map.AddOffice({Office::Id{"o2"s}, {30, 0}, {0, 0}});
+    Game game = MakeGame(std::move(map));
+    game.SetLootGenerator(std::make_unique<loot_gen::LootGenerator>(
+        std::chrono::seconds{1}, 1.0));
+    return game;
+}
+
+// Собаки сессии с одинаковым зерном генератора лута
+std::vector<std::shared_ptr<app::Player>> JoinRunners(Game& game) {
+    std::vector<std::shared_ptr<app::Player>> players;
+    for (int i = 0; i < 8; ++i) {
+        players.push_back(
+            app::Application::join_game(game, "Rex"s, MAP_ID));
+        players.back()->MakeAction(i % 2 ? "R"s : "L"s);
+    }
+    players.front()->GetSession()->GetRandom().seed(42);
+    return players;
+}
+
+// Собаки разворачиваются, не доходя до края дороги, поэтому не
+// останавливаются и не паркуются
+void Steer(const std::vector<std::shared_ptr<app::Player>>& players) {
+    for (const auto& player : players) {
+        const auto dog = player->GetDog();
+        const double x = dog->GetPosition().x;
+        if (dog->GetSpeed().x >= 0 && x >= ROAD_LENGTH - 1) {
+            player->MakeAction("L"s);
+        } else if (dog->GetSpeed().x <= 0 && x <= 1) {
+            player->MakeAction("R"s);
+        }
+    }
+}
+
+std::uint32_t TotalScore(
+    const std::vector<std::shared_ptr<app::Player>>& players)
+{
+    std::uint32_t score = 0;
+    for (const auto& player : players) {
+        score += player->GetDog()->GetScore();
+    }
+    return score;
+}
+
+}  // namespace
+
+void* operator new(size_t size) {
+    if (count_allocations) {
+        ++allocation_count;
+    }
+    if (void* ptr = std::malloc(size == 0 ? 1 : size)) {
+        return ptr;
+    }
+    throw std::bad_alloc{};
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    std::free(ptr);
+}
+
+SCENARIO("Frame arena") {
+    GIVEN("an arena that has grown during a frame") {
+        util::FrameArena arena{256};
+        {
+            util::FrameArena::Scope frame{arena};
+            std::pmr::vector<int> values{&arena};
+            values.resize(1000);
+        }
+        const size_t capacity = arena.Capacity();
+        REQUIRE(capacity >= 1000 * sizeof(int));
+
+        WHEN("a nested scope ends inside a frame") {
+            util::FrameArena::Scope frame{arena};
+            std::pmr::vector<int> outer{&arena};
+            outer.assign(100, 7);
+            {
+                util::FrameArena::Scope nested{arena};
+                std::pmr::vector<int> inner{&arena};
+                inner.assign(100, 9);
+            }
+            std::pmr::vector<int> next{&arena};
+            next.assign(100, 9);
+
+            THEN("only the memory of the nested scope is reused") {
+                CHECK(std::count(outer.begin(), outer.end(), 7) == 100);
+            }
+        }
+
+        WHEN("the next frame needs the same amount of memory") {
+            AllocationCounter counter;
+            {
+                util::FrameArena::Scope frame{arena};
+                std::pmr::vector<int> values{&arena};
+                values.resize(1000);
+            }
+            const size_t allocations = counter.Stop();
+
+            THEN("it reuses the memory without growing") {
+                CHECK(allocations == 0);
+                CHECK(arena.Capacity() == capacity);
+            }
+        }
+    }
+}
+
+SCENARIO("Steady-state ticks") {
+    GIVEN("two identical games with dogs running over loot and offices") {
+        Game updated = MakeBusyGame();
+        Game simulated = MakeBusyGame();
+        const auto updated_players = JoinRunners(updated);
+        const auto simulated_players = JoinRunners(simulated);
+        auto session = simulated_players.front()->GetSession();
+
+        // Второй игре снимки публикуются отдельно от моделирования, с теми
+        // же номерами тиков, что и при Game::Update
+        std::uint64_t tick = 0;
+        const auto player_ids = [&simulated, &session] {
+            return std::move(simulated.GetPlayers()
+                .GetPlayerIdsBySession()[session->GetId()]);
+        };
+
+        // Первые тики наращивают арену, пулы и внутренние буферы
+        for (int i = 0; i < 100; ++i) {
+            Steer(updated_players);
+            Steer(simulated_players);
+            updated.Update(TICK_MS);
+            simulated.Simulate(session, TICK_MS);
+            ++tick;
+            session->PublishSnapshot(player_ids(), tick, tick);
+        }
+        const std::uint32_t loot_spawned = session->GetLootCounter();
+
+        WHEN("one game is updated and the other is simulated") {
+            size_t update_allocations = 0;
+            size_t simulate_allocations = 0;
+            size_t publish_allocations = 0;
+            for (int i = 0; i < 200; ++i) {
+                Steer(updated_players);
+                Steer(simulated_players);
+                const auto ids = player_ids();
+                ++tick;
+                {
+                    AllocationCounter counter;
+                    updated.Update(TICK_MS);
+                    update_allocations += counter.Stop();
+                }
+                {
+                    AllocationCounter counter;
+                    simulated.Simulate(session, TICK_MS);
+                    simulate_allocations += counter.Stop();
+                }
+                {
+                    AllocationCounter counter;
+                    session->PublishSnapshot(ids, tick, tick);
+                    publish_allocations += counter.Stop();
+                }
+            }
+
+            THEN("only snapshot publication touches the heap") {
+                CHECK(simulate_allocations == 0);
+                CHECK(update_allocations == publish_allocations);
+            }
+
+            THEN("loot keeps spawning and is gathered and delivered") {
+                CHECK(session->GetLootCounter() > loot_spawned);
+                CHECK(TotalScore(simulated_players) > 0);
+                CHECK(TotalScore(updated_players) ==
+                      TotalScore(simulated_players));
+                CHECK(updated_players.front()->GetSession()->GetLootCounter()
+                      == session->GetLootCounter());
+            }
+        }
+    }
+}
@@ -0,0 +1,85 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/timing_wheel.h"
+
+#include <vector>
+
+SCENARIO("Timing wheel") {
+    using Wheel = util::TimingWheel<int>;
+
+    GIVEN("timers on every level of the wheel and beyond it") {
+        Wheel wheel{10};
+        const std::vector<Wheel::Time> deadlines{
+            11, 70, 75, 4000, 300000, 20000000, 70000000};
+        for (size_t i = 0; i < deadlines.size(); ++i) {
+            wheel.Schedule(deadlines[i], static_cast<int>(i));
+        }
+        REQUIRE(wheel.Size() == deadlines.size());
+
+        WHEN("time advances in uneven steps") {
+            std::vector<std::pair<Wheel::Time, int>> fired;
+            Wheel::Time now = 10;
+            for (Wheel::Time step : {1, 50, 13, 1, 4000, 400000, 70000000}) {
+                now += step;
+                wheel.Advance(now, [&](int value) {
+                    fired.emplace_back(now, value);
+                });
+            }
+
+            THEN("each timer fires at the first advance past its deadline") {
+                CHECK(fired == std::vector<std::pair<Wheel::Time, int>>{
+                    {11, 0}, {74, 1}, {75, 2}, {4075, 3}, {404075, 4},
+                    {70404075, 5}, {70404075, 6}});
+                CHECK(wheel.Size() == 0);
+            }
+        }
+    }
+
+    GIVEN("a timer whose deadline has already passed") {
+        Wheel wheel{100};
+        wheel.Schedule(40, 1);
+
+        THEN("it fires on the next advance without moving time") {
+            std::vector<int> fired;
+            wheel.Advance(100, [&](int value) {
+                fired.push_back(value);
+            });
+            CHECK(fired == std::vector{1});
+            CHECK(wheel.Now() == 100);
+        }
+    }
+
+    GIVEN("one timer far beyond every level of the wheel") {
+        Wheel wheel{0};
+        wheel.Schedule(999'999'999, 7);
+
+        WHEN("time jumps by a billion units in one advance") {
+            std::vector<int> fired;
+            wheel.Advance(1'000'000'000, [&](int value) {
+                fired.push_back(value);
+            });
+
+            THEN("the timer fires exactly once") {
+                CHECK(fired == std::vector{7});
+                CHECK(wheel.Size() == 0);
+                CHECK(wheel.Now() == 1'000'000'000);
+            }
+        }
+
+        WHEN("time stops just short of the deadline") {
+            std::vector<int> fired;
+            wheel.Advance(999'999'998, [&](int value) {
+                fired.push_back(value);
+            });
+
+            THEN("the timer stays pending until the deadline is reached") {
+                CHECK(fired.empty());
+                CHECK(wheel.Size() == 1);
+                wheel.Advance(999'999'999, [&](int value) {
+                    fired.push_back(value);
+                });
+                CHECK(fired == std::vector{7});
+            }
+        }
+    }
+}